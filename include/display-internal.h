@@ -51,7 +51,7 @@ typedef struct _display_proxy {
   char *(*get_clipboard_data)(int type);
   void (*set_fullscreen_mode)();
 
-  guint (*scale)(void);
+  double (*scale)(void);
 
   const struct _view_proxy *(*view)(void);
 } display_proxy;
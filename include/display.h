@@ -120,7 +120,7 @@ void display_startup_notification(RofiHelperExecuteContext *context,
 void display_set_input_focus(guint w);
 void display_revert_input_focus(void);
 
-guint display_scale(void);
+double display_scale(void);
 
 enum clipboard_type {
   CLIPBOARD_DEFAULT,
@@ -70,6 +70,66 @@ rofi_int_matcher **helper_tokenize(const char *input, int case_sensitive);
  */
 void helper_tokenize_free(rofi_int_matcher **tokens);
 
+/**
+ * Create an empty prefix index.
+ * The index holds every word boundary of the strings added to it, sorted on
+ * their case folded text. It lets prefix matching (MM_PREFIX) find the
+ * entries that can match with a binary search instead of a scan.
+ *
+ * @returns a newly allocated index, free with rofi_prefix_index_free().
+ */
+RofiPrefixIndex *rofi_prefix_index_new(void);
+
+/**
+ * @param index The index.
+ * @param entry The entry the text belongs to.
+ * @param text The text to index.
+ *
+ * Add one of the strings an entry is matched against to the index.
+ */
+void rofi_prefix_index_add(RofiPrefixIndex *index, unsigned int entry,
+                           const char *text);
+
+/**
+ * @param index The index.
+ * @param num_entries The number of entries that were added.
+ *
+ * Sort the index after all strings are added. Entries below num_entries
+ * without any text are known not to match.
+ */
+void rofi_prefix_index_build(RofiPrefixIndex *index, unsigned int num_entries);
+
+/**
+ * @param index The index.
+ *
+ * @returns the number of entries covered by the index.
+ */
+unsigned int rofi_prefix_index_get_length(const RofiPrefixIndex *index);
+
+/**
+ * @param index The index.
+ * @param input The user input, tokenized like helper_tokenize().
+ * @param entries Set to the sorted array of entries that can match, free with
+ * g_free().
+ * @param length Set to the length of entries.
+ *
+ * Find the entries that have a word boundary starting with each (non
+ * negated) token. The result can contain entries that do not match, but
+ * never misses one.
+ *
+ * @returns FALSE if the input has nothing the index can narrow down on.
+ */
+gboolean rofi_prefix_index_lookup(const RofiPrefixIndex *index,
+                                  const char *input, unsigned int **entries,
+                                  unsigned int *length);
+
+/**
+ * @param index The index to free (or NULL).
+ *
+ * Free the prefix index.
+ */
+void rofi_prefix_index_free(RofiPrefixIndex *index);
+
 /**
  * @param key The key to search for
  * @param val Pointer to the string to set to the key value (if found)
@@ -364,6 +424,7 @@ void parse_ranges(char *input, rofi_range_pair **list, unsigned int *length);
  *   * i: Print the index (0-(N-1))
  *   * d: Print the index (1-N)
  *   * s: Print input string.
+ *   * p: Print input string stripped from pango markup.
  *   * q: Print quoted input string.
  *   * f: Print the entered filter.
  *   * F: Print the entered filter, quoted
@@ -374,6 +435,52 @@ void parse_ranges(char *input, rofi_range_pair **list, unsigned int *length);
 void rofi_output_formatted_line(const char *format, const char *string,
                                 int selected_line, const char *filter);
 
+/**
+ * Buffered writer for formatted output lines.
+ */
+typedef struct _RofiOutputBuffer RofiOutputBuffer;
+
+/**
+ * @param fd The file descriptor to write to.
+ * @param threshold Flush when this many bytes are pending, 0 to flush every
+ * line.
+ *
+ * Create a buffered writer for formatted output lines. Lines are formatted
+ * into a reusable buffer and written with writev().
+ *
+ * @returns a new output buffer, free with rofi_output_buffer_free().
+ */
+RofiOutputBuffer *rofi_output_buffer_new(int fd, gsize threshold);
+
+/**
+ * @param ob The output buffer.
+ * @param format The format string used. See below for possible syntax.
+ * @param string The selected entry.
+ * @param selected_line The selected line index.
+ * @param filter The entered filter.
+ *
+ * Add a line formatted as rofi_output_formatted_line() does. The string and
+ * filter can be referenced until the next flush, and must remain valid until
+ * then.
+ */
+void rofi_output_buffer_add_line(RofiOutputBuffer *ob, const char *format,
+                                 const char *string, int selected_line,
+                                 const char *filter);
+
+/**
+ * @param ob The output buffer.
+ *
+ * Write out all pending data.
+ */
+void rofi_output_buffer_flush(RofiOutputBuffer *ob);
+
+/**
+ * @param ob The output buffer.
+ *
+ * Flush and free the output buffer.
+ */
+void rofi_output_buffer_free(RofiOutputBuffer *ob);
+
 /**
  * @param string The string with elements to be replaced
  * @param ...    Set of {key}, value that will be replaced, terminated by  a
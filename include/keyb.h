@@ -145,6 +145,10 @@ typedef enum {
   SELECT_ELEMENT_10,
   ENTRY_HISTORY_UP,
   ENTRY_HISTORY_DOWN,
+  /** Select all filtered rows (multi-select) */
+  SELECT_ALL,
+  /** Invert the selection of the filtered rows (multi-select) */
+  SELECT_INVERT,
 } KeyBindingAction;
 
 /**
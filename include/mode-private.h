@@ -32,7 +32,7 @@
 G_BEGIN_DECLS
 
 /** ABI version to check if loaded plugin is compatible. */
-#define ABI_VERSION 7u
+#define ABI_VERSION 8u
 
 /**
  * Indicator what type of mode this is.
@@ -189,6 +189,41 @@ typedef ModeMode (*_mode_completer_result)(Mode *sw, int menu_retv,
                                            char **input,
                                            unsigned int selected_line,
                                            char **path);
+/**
+ * @param sw The #Mode pointer
+ *
+ * Get the prefix index over the strings the entries are matched against.
+ * Every entry that _token_match accepts in prefix matching mode must be
+ * found through the index. Entries beyond the length of the index are
+ * always matched.
+ *
+ * @returns the index, or NULL if the mode has none.
+ */
+typedef RofiPrefixIndex *(*_mode_get_prefix_index)(Mode *sw);
+
+/**
+ * @param sw The #Mode pointer
+ * @param selected_line The entry to get the icon name of.
+ *
+ * Get the name the icon of the entry is looked up by, as passed to
+ * rofi_icon_fetcher_query().
+ *
+ * @returns the icon name (free with g_free()), or NULL if the entry has none.
+ */
+typedef char *(*_mode_get_icon_name)(const Mode *sw,
+                                     unsigned int selected_line);
+
+/**
+ * @param sw The #Mode pointer
+ * @param selected_line The entry to get the identity of.
+ *
+ * Get a string that identifies the entry between runs, e.g. to find it again
+ * after the list changed. Entries that act differently must not share it.
+ *
+ * @returns the identity (free with g_free()), or NULL if the entry has none.
+ */
+typedef char *(*_mode_get_identity)(const Mode *sw, unsigned int selected_line);
+
 /**
  * Structure defining a switcher.
  * It consists of a name, callback and if enabled
@@ -258,6 +293,15 @@ struct rofi_mode {
 
   /** type */
   ModeType type;
+
+  /** Get the prefix index (optional). */
+  _mode_get_prefix_index _get_prefix_index;
+
+  /** Get the icon name of an entry (optional). */
+  _mode_get_icon_name _get_icon_name;
+
+  /** Get the identity of an entry (optional). */
+  _mode_get_identity _get_identity;
 };
 G_END_DECLS
 #endif // ROFI_MODE_PRIVATE_H
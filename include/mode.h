@@ -81,6 +81,10 @@ typedef enum {
   MENU_PREVIOUS = 0x00400000,
   /** Go to the complete. */
   MENU_COMPLETE = 0x01000000,
+  /** Select all filtered entries. */
+  MENU_SELECT_ALL = 0x02000000,
+  /** Invert the selection of the filtered entries. */
+  MENU_SELECT_INVERT = 0x04000000,
   /** Bindings specifics */
   MENU_CUSTOM_ACTION = 0x10000000,
   /** Mask */
@@ -177,6 +181,38 @@ ModeMode mode_result(Mode *mode, int menu_retv, char **input,
 int mode_token_match(const Mode *mode, rofi_int_matcher **tokens,
                      unsigned int selected_line);
 
+/**
+ * @param mode The mode to query
+ *
+ * Get the prefix index of the mode, used to narrow down the entries to match
+ * in prefix matching mode.
+ *
+ * @returns the index, or NULL if the mode does not provide one.
+ */
+RofiPrefixIndex *mode_get_prefix_index(Mode *mode);
+
+/**
+ * @param mode The mode to query
+ * @param selected_line The entry to query
+ *
+ * Get the name the icon of the entry is looked up by.
+ *
+ * @returns the icon name (free with g_free()), or NULL if the entry has none
+ * or the mode does not provide it.
+ */
+char *mode_get_icon_name(const Mode *mode, unsigned int selected_line);
+
+/**
+ * @param mode The mode to query
+ * @param selected_line The entry to query
+ *
+ * Get the string that identifies the entry between runs. Modes that do not
+ * provide one are identified by the completion string.
+ *
+ * @returns the identity (free with g_free()), or NULL if the entry has none.
+ */
+char *mode_get_identity(const Mode *mode, unsigned int selected_line);
+
 /**
  * @param mode The mode to query
  *
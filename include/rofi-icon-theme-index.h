@@ -0,0 +1,62 @@
+#ifndef ROFI_ICON_THEME_INDEX_H
+#define ROFI_ICON_THEME_INDEX_H
+
+#include <glib.h>
+
+/**
+ * @defgroup ICONTHEMEINDEX IconThemeIndex
+ * @ingroup HELPERS
+ *
+ * Index of the icons in the XDG icon themes, used by the icon fetcher.
+ *
+ * For each theme directory the GTK icon-theme.cache is memory mapped when it
+ * is up to date. Themes without one are scanned once and an index in the same
+ * format is stored in the cache directory. Looking up an icon is then a hash
+ * probe per theme, the filesystem is not touched.
+ *
+ * The index is immutable after creation and can be used from multiple
+ * threads.
+ * @{
+ */
+
+/**
+ * Opaque handle to the icon theme index.
+ */
+typedef struct _RofiIconThemeIndex RofiIconThemeIndex;
+
+/**
+ * @param themes NULL terminated list of theme names to search, in order.
+ * @param persist_dir Directory to store indexes of themes without a cache, or
+ * NULL to keep them in memory only.
+ *
+ * Load the themes, the themes they inherit from and hicolor.
+ *
+ * @returns a new index, free with rofi_icon_theme_index_free().
+ */
+RofiIconThemeIndex *rofi_icon_theme_index_new(const char *const *themes,
+                                              const char *persist_dir);
+
+/**
+ * @param index The icon theme index.
+ * @param name The name of the icon.
+ * @param size The requested size.
+ * @param scale The requested scale.
+ *
+ * Find the icon following the XDG icon theme specification: the first theme
+ * that has the icon wins, within that theme an exact size match is preferred
+ * over the closest size. Icons outside of a theme are used as last resort.
+ *
+ * @returns the path of the icon, or NULL if not found. free with g_free().
+ */
+char *rofi_icon_theme_index_lookup(const RofiIconThemeIndex *index,
+                                   const char *name, int size, int scale);
+
+/**
+ * @param index The icon theme index to free.
+ *
+ * Free the index and unmap the caches.
+ */
+void rofi_icon_theme_index_free(RofiIconThemeIndex *index);
+
+/** @} */
+#endif // ROFI_ICON_THEME_INDEX_H
@@ -362,8 +362,16 @@ typedef struct rofi_range_pair {
 typedef struct rofi_int_matcher_t {
   GRegex *regex;
   gboolean invert;
+  /** Same pattern compiled by PCRE2 (pcre2_code), used for plain matching. */
+  gpointer code;
 } rofi_int_matcher;
 
+/**
+ * Sorted index of the word boundaries in the strings entries are matched
+ * against, see rofi_prefix_index_new().
+ */
+typedef struct _RofiPrefixIndex RofiPrefixIndex;
+
 /**
  * Structure with data to process by each worker thread.
  * TODO: Make this more generic wrapper.
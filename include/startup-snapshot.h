@@ -0,0 +1,96 @@
+/*
+ * rofi
+ *
+ * MIT/X11 License
+ * Copyright © 2013-2023 Qball Cow <qball@gmpclient.org>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#ifndef ROFI_STARTUP_SNAPSHOT_H
+#define ROFI_STARTUP_SNAPSHOT_H
+
+#include "mode.h"
+
+/**
+ * @defgroup STARTUPSNAPSHOT StartupSnapshot
+ * @ingroup HELPERS
+ *
+ * Keeps the first unfiltered page of a mode between runs, so the window can
+ * show rows before the mode has loaded its data.
+ *
+ * A row is stored with its display string, state, icon name, completion
+ * string and identity (see mode_get_identity()). The identity finds the row
+ * again when the snapshot is replaced by the live mode.
+ *
+ * Snapshots are enabled per mode with the 'startup-snapshot' option. By
+ * default only modes that implement _get_identity (run and drun) use them.
+ *
+ * @{
+ */
+
+/**
+ * @param mode The mode to check.
+ *
+ * @returns TRUE if snapshots are enabled for the mode.
+ */
+gboolean startup_snapshot_enabled(const Mode *mode);
+
+/**
+ * @param mode The (initialized) mode.
+ * @param rows The number of rows on a page.
+ *
+ * Store the first @p rows rows of @p mode in the cache directory.
+ */
+void startup_snapshot_save(Mode *mode, unsigned int rows);
+
+/**
+ * @param mode The mode to load the snapshot of.
+ *
+ * The returned mode is initialized, it shows the stored rows under the name
+ * of @p mode and returns #MODE_EXIT on any result.
+ *
+ * @returns a new mode, or NULL if there is no snapshot. Free with
+ * startup_snapshot_free().
+ */
+Mode *startup_snapshot_load(const Mode *mode);
+
+/**
+ * @param snapshot The mode returned by startup_snapshot_load().
+ * @param mode The initialized mode the snapshot was made of.
+ * @param selected_line A row of @p snapshot.
+ *
+ * Find the row of @p mode that @p selected_line of the snapshot showed.
+ *
+ * @returns the row in @p mode, or UINT32_MAX if it is gone.
+ */
+unsigned int startup_snapshot_map_line(const Mode *snapshot, const Mode *mode,
+                                       unsigned int selected_line);
+
+/**
+ * @param snapshot The mode returned by startup_snapshot_load().
+ *
+ * Free the snapshot mode.
+ */
+void startup_snapshot_free(Mode *snapshot);
+
+/** @} */
+#endif // ROFI_STARTUP_SNAPSHOT_H
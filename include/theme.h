@@ -406,7 +406,7 @@ GList *rofi_theme_get_list_strings(const widget *widget, const char *property);
 /**
  * Display scale function type
  */
-typedef guint (*disp_scale_func)(void);
+typedef double (*disp_scale_func)(void);
 
 /**
  * @param func The function pointer to scale getter.
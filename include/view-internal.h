@@ -87,6 +87,17 @@ struct RofiViewState {
 
   /** number of (filtered) elements to show. */
   unsigned int filtered_lines;
+  /**
+   * Unsorted filtering stops once the first pages are filled, the rows from
+   * filter_scan_pos to filter_scan_end are tested in the background.
+   */
+  unsigned int filter_scan_pos;
+  /** End of the rows to test, see #filter_scan_pos. */
+  unsigned int filter_scan_end;
+  /** If set, the rows still to test are listed in line_map. */
+  gboolean filter_scan_candidates;
+  /** Source testing the remaining rows. */
+  guint filter_scan_source;
 
   /** Previously called key action. */
   KeyBindingAction prev_action;
@@ -157,6 +168,13 @@ struct RofiViewState {
 
   /** Regexs used for matching */
   rofi_int_matcher **tokens;
+
+  /** Input the current filter result was computed for. */
+  char *filter_text;
+  /** #CacheState data_generation the current filter result was computed at. */
+  gint filter_generation;
+  /** Filter results of modes switched away from, keyed on #Mode. */
+  GHashTable *mode_snapshots;
 };
 /** @} */
 
@@ -228,6 +246,20 @@ struct _rofi_view_cache_state {
   gssize entry_history_length;
   /** The current index being viewed. */
   gssize entry_history_index;
+  /** Bumped by rofi_view_data_changed(), invalidates retained filter results.
+   */
+  gint data_generation;
+  /** Pointer motion that is not handled yet. */
+  struct {
+    /** X position */
+    int x;
+    /** Y position */
+    int y;
+    /** If the motion should look for a new hover target. */
+    gboolean find_mouse_target;
+    /** Idle source that handles the motion, 0 if nothing is pending. */
+    guint source;
+  } pending_motion;
 };
 extern struct _rofi_view_cache_state CacheState;
 
@@ -60,6 +60,8 @@ typedef enum {
   MENU_NORMAL_WINDOW = 2,
   /** ERROR dialog */
   MENU_ERROR_DIALOG = 4,
+  /** Mode supports selecting multiple entries. */
+  MENU_MULTI_SELECT = 8,
 } MenuFlags;
 
 /**
@@ -116,6 +118,21 @@ void rofi_view_handle_text(RofiViewState *state, char *text);
  */
 void rofi_view_handle_mouse_motion(RofiViewState *state, gint x, gint y,
                                    gboolean find_mouse_target);
+/**
+ * @param x The X coordinates of the motion
+ * @param y The Y coordinates of the motion
+ * @param find_mouse_target if we should handle pure mouse motion
+ *
+ * Queue pointer motion for the active view. Motion is handled once all
+ * pending input is processed, and before the next repaint, so only the last
+ * position of a burst of motion events is handled.
+ */
+void rofi_view_queue_mouse_motion(gint x, gint y, gboolean find_mouse_target);
+/**
+ * Handle queued pointer motion now, so it is handled before the input that
+ * follows it.
+ */
+void rofi_view_flush_mouse_motion(void);
 /**
  * @param state the Menu handle
  *
@@ -159,6 +176,17 @@ void rofi_view_set_selected_line(RofiViewState *state,
  * @returns the selected line or UINT32_MAX if none selected.
  */
 unsigned int rofi_view_get_selected_line(const RofiViewState *state);
+
+/**
+ * @param state The Menu Handle
+ * @param length [out] The number of filtered lines.
+ *
+ * Get the mapping from the filtered (visible) lines to the mode lines.
+ *
+ * @returns the line map, owned by the view.
+ */
+const unsigned int *rofi_view_get_filtered_line_map(const RofiViewState *state,
+                                                    unsigned int *length);
 /**
  * @param state The Menu Handle
  *
@@ -270,6 +298,14 @@ void rofi_view_hide(void);
  */
 void rofi_view_reload(void);
 
+/**
+ * Indicate the entries of a mode changed, and reload the current view.
+ * Unlike rofi_view_reload() this drops the filter results retained for
+ * switching between modes, use rofi_view_reload() when only the rendering
+ * (e.g. an icon) changed.
+ */
+void rofi_view_data_changed(void);
+
 /**
  * @param state The handle to the view
  * @param mode The new mode to display
@@ -278,6 +314,15 @@ void rofi_view_reload(void);
  */
 void rofi_view_switch_mode(RofiViewState *state, Mode *mode);
 
+/**
+ * @param state The handle to the view
+ * @param mode The mode to display
+ *
+ * Replace a mode that stood in for @p mode, like rofi_view_switch_mode() but
+ * nothing of the old mode is kept for switching back.
+ */
+void rofi_view_replace_mode(RofiViewState *state, Mode *mode);
+
 /**
  * @param state The handle to the view
  * @param text An UTF-8 encoded character array with the text to overlay.
@@ -45,6 +45,9 @@ typedef struct {
 
   struct zwlr_layer_shell_v1 *layer_shell;
 
+  struct wp_viewporter *viewporter;
+  struct wp_fractional_scale_manager_v1 *fractional_scale_manager;
+
   struct wl_shm *shm;
   size_t buffer_count;
   struct {
@@ -66,7 +69,19 @@ typedef struct {
   struct wl_callback *frame_cb;
   size_t scales[3];
   int32_t scale;
+  /* Set when the compositor supports fractional scales. */
+  struct wp_viewport *viewport;
+  struct wp_fractional_scale_v1 *fractional_scale;
+  /* Preferred scale in 120ths, 0 until the compositor sent one. */
+  uint32_t preferred_scale;
   NkBindingsSeat *bindings_seat;
+  /* Last compiled keymap, reused when the compositor sends the same text. */
+  struct {
+    guint hash;
+    uint32_t size;
+    char *text;
+    struct xkb_keymap *keymap;
+  } keymap;
 
   char *clipboard_default_data;
   char *clipboard_primary_data;
@@ -107,6 +122,8 @@ struct _wayland_seat {
 #define WL_SEAT_INTERFACE_VERSION 5
 #define WL_OUTPUT_INTERFACE_VERSION 2
 #define WL_LAYER_SHELL_INTERFACE_VERSION 1
+#define WP_VIEWPORTER_INTERFACE_VERSION 1
+#define WP_FRACTIONAL_SCALE_MANAGER_INTERFACE_VERSION 1
 
 extern wayland_stuff *wayland;
 
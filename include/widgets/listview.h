@@ -242,6 +242,16 @@ void listview_set_mouse_activated_cb(listview *lv,
  */
 gboolean listview_get_fixed_num_lines(listview *lv);
 
+/**
+ * @param lv Handler to the listview object.
+ *
+ * Get the number of elements a full page shows, from the configured lines and
+ * columns.
+ *
+ * @returns the page size.
+ */
+unsigned int listview_get_page_size(listview *lv);
+
 /**
  * @param lv Handler to the listview object.
  *
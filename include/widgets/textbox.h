@@ -53,6 +53,26 @@ typedef struct TBFontConfig {
   /** height */
   double height;
 } TBFontConfig;
+/**
+ * Text of a textbox, stored as a gap buffer. Edits happen at the gap, so
+ * typing or pasting at the cursor does not move the rest of the string.
+ * Use textbox_peek_text() or textbox_get_text() to read it.
+ */
+typedef struct {
+  /** Text before the gap, the gap and the text after the gap. */
+  char *data;
+  /** Allocated size of data. */
+  size_t size;
+  /** Byte offset of the start of the gap. */
+  size_t gap_start;
+  /** Byte offset of the end of the gap. */
+  size_t gap_end;
+  /** Character offset of the start of the gap. */
+  int gap_chars;
+  /** Length of the text in characters. */
+  int length;
+} TBText;
+
 /**
  * Internal structure of a textbox widget.
  * TODO make this internal to textbox
@@ -60,8 +80,8 @@ typedef struct TBFontConfig {
 typedef struct {
   widget widget;
   unsigned long flags;
-  short cursor;
-  char *text;
+  int cursor;
+  TBText text;
   char *placeholder;
   int show_placeholder;
   PangoLayout *layout;
@@ -168,8 +188,11 @@ int textbox_keybinding(textbox *tb, KeyBindingAction action);
  * @param pad The text to insert
  * @param pad_len the length of the text
  *
- * The text should be one insert from a keypress..  the first gunichar is
- * validated to be (or not) control return TRUE if inserted
+ * Insert text typed or pasted by the user at the cursor. Whitespace is
+ * replaced by a space and control characters are dropped, the rest is
+ * inserted in one go and the cursor is moved after it.
+ *
+ * @returns TRUE if anything was inserted.
  */
 gboolean textbox_append_text(textbox *tb, const char *pad, const int pad_len);
 
@@ -289,6 +312,20 @@ int textbox_get_estimated_height(const textbox *tb, int eh);
  * Set the default pango context (with font description) for all textboxes.
  */
 void textbox_set_pango_context(const char *font, PangoContext *p);
+
+/**
+ * Draw textboxes on the calling thread with a PangoContext owned by that
+ * thread, until textbox_thread_draw_end() is called. The context is created
+ * on first use with the settings of the default context.
+ *
+ * The textboxes drawn must not be modified while this is active.
+ */
+void textbox_thread_draw_begin(void);
+
+/**
+ * Go back to drawing textboxes with the default PangoContext.
+ */
+void textbox_thread_draw_end(void);
 /**
  * @param tb Handle to the textbox
  * @param list New pango attributes
@@ -352,6 +389,14 @@ int textbox_get_cursor_x_pos(const textbox *tb);
  */
 char *textbox_get_text(const textbox *tb);
 
+/**
+ * @param tb Handle to the textbox
+ *
+ * @returns the content of the entrybox, owned by the textbox and valid until
+ * it is modified.
+ */
+const char *textbox_peek_text(textbox *tb);
+
 /**
  * @param tb Handle to the textbox
  *
@@ -62,11 +62,19 @@ struct _xcb_stuff {
     /** Keyboard device id */
     int32_t device_id;
   } xkb;
+  /** Major opcode of the Present extension, 0 if it is not available. */
+  uint8_t present_opcode;
   xcb_timestamp_t last_timestamp;
   NkBindingsSeat *bindings_seat;
   gboolean mouse_seen;
   xcb_window_t focus_revert;
   char *clipboard;
+  /** Keyboard grabbed before the view was set up. */
+  gboolean keyboard_grabbed;
+  /** Pointer grabbed before the view was set up. */
+  gboolean pointer_grabbed;
+  /** Key (and keyboard state) events received before there was a view. */
+  GQueue pending_key_events;
 };
 
 #endif
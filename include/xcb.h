@@ -224,4 +224,12 @@ void x11_event_handler_fowarding(xcb_xim_t *im, xcb_xic_t ic,
  * @returns NULL when non found, otherwise a string (free with g_free)
  */
 char *x11_helper_get_window_manager(void);
+
+/**
+ * @param serial The serial of the Present MSC notification.
+ *
+ * The frame with @p serial reached the screen, the next one can be drawn.
+ * Notifications of older frames (e.g. after a timeout) are ignored.
+ */
+void xcb_rofi_view_present_complete(uint32_t serial);
 #endif
@@ -39,7 +39,7 @@ void display_startup_notification(RofiHelperExecuteContext *context,
   proxy->startup_notification(context, child_setup, user_data);
 }
 
-guint display_scale(void) { return proxy->scale(); }
+double display_scale(void) { return proxy->scale(); }
 
 char *display_get_clipboard_data(enum clipboard_type type) {
   return proxy->get_clipboard_data(type);
@@ -44,6 +44,7 @@
 #include <pango/pango-fontmap.h>
 #include <pango/pango.h>
 #include <pango/pangocairo.h>
+#include <poll.h>
 #include <pwd.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -51,7 +52,12 @@
 #include <sys/file.h>
 #include <sys/stat.h>
 #include <sys/types.h>
+#include <sys/uio.h>
 #include <unistd.h>
+#ifdef HAVE_PCRE2
+#define PCRE2_CODE_UNIT_WIDTH 8
+#include <pcre2.h>
+#endif
 
 /**
  * Textual description of positioning rofi.
@@ -118,6 +124,9 @@ int helper_parse_setup(char *string, char ***output, int *length, ...) {
 void helper_tokenize_free(rofi_int_matcher **tokens) {
   for (size_t i = 0; tokens && tokens[i]; i++) {
     g_regex_unref((GRegex *)tokens[i]->regex);
+#ifdef HAVE_PCRE2
+    pcre2_code_free((pcre2_code *)tokens[i]->code);
+#endif
     g_free(tokens[i]);
   }
   g_free(tokens);
@@ -198,24 +207,108 @@ static char *utf8_helper_simplify_string(const char *os) {
   return str;
 }
 
-// Macro for quickly generating regex for matching.
-static inline GRegex *R(const char *s, int case_sensitive) {
-  if (config.normalize_match) {
-    char *str = utf8_helper_simplify_string(s);
+#ifdef HAVE_PCRE2
+/**
+ * Per thread PCRE2 match state, so matching does not allocate.
+ */
+typedef struct {
+  pcre2_match_data *match_data;
+  pcre2_match_context *match_context;
+  pcre2_jit_stack *jit_stack;
+} RofiMatchThreadData;
+
+static void rofi_match_thread_data_free(gpointer data) {
+  RofiMatchThreadData *td = (RofiMatchThreadData *)data;
+  pcre2_match_data_free(td->match_data);
+  pcre2_match_context_free(td->match_context);
+  pcre2_jit_stack_free(td->jit_stack);
+  g_free(td);
+}
+
+static GPrivate rofi_match_thread_data =
+    G_PRIVATE_INIT(rofi_match_thread_data_free);
+
+static RofiMatchThreadData *rofi_match_thread_data_get(void) {
+  RofiMatchThreadData *td = g_private_get(&rofi_match_thread_data);
+  if (td == NULL) {
+    td = g_malloc0(sizeof(*td));
+    // Only a yes/no answer is needed, one pair is enough.
+    td->match_data = pcre2_match_data_create(1, NULL);
+    td->match_context = pcre2_match_context_create(NULL);
+    td->jit_stack = pcre2_jit_stack_create(32 * 1024, 512 * 1024, NULL);
+    pcre2_jit_stack_assign(td->match_context, NULL, td->jit_stack);
+    g_private_set(&rofi_match_thread_data, td);
+  }
+  return td;
+}
 
-    GRegex *r = g_regex_new(
-        str, G_REGEX_OPTIMIZE | ((case_sensitive) ? 0 : G_REGEX_CASELESS), 0,
-        NULL);
+/**
+ * Compile with the options GRegex uses (UTF-8, unicode properties), so both
+ * agree on what matches. Returns NULL if PCRE2 rejects the pattern.
+ */
+static pcre2_code *rofi_pcre2_compile(const char *s, int case_sensitive) {
+  int errcode = 0;
+  PCRE2_SIZE erroffset = 0;
+  uint32_t options =
+      PCRE2_UTF | PCRE2_UCP | ((case_sensitive) ? 0 : PCRE2_CASELESS);
+  pcre2_code *code = pcre2_compile((PCRE2_SPTR)s, PCRE2_ZERO_TERMINATED,
+                                   options, &errcode, &erroffset, NULL);
+  if (code != NULL) {
+    // Falls back to the interpreter when JIT is not available.
+    pcre2_jit_compile(code, PCRE2_JIT_COMPLETE);
+  }
+  return code;
+}
+#endif
 
-    g_free(str);
-    return r;
+/**
+ * @param rv The matcher to fill in.
+ * @param s The regex.
+ * @param case_sensitive Whether the match is case sensitive.
+ *
+ * Compile @p s into @p rv, with a PCRE2 code next to the GRegex when
+ * available.
+ *
+ * @returns TRUE if the regex compiled.
+ */
+static inline gboolean R(rofi_int_matcher *rv, const char *s,
+                         int case_sensitive) {
+  char *str = NULL;
+  if (config.normalize_match) {
+    str = utf8_helper_simplify_string(s);
+    s = str;
   }
-  return g_regex_new(
+  rv->regex = g_regex_new(
       s, G_REGEX_OPTIMIZE | ((case_sensitive) ? 0 : G_REGEX_CASELESS), 0, NULL);
+#ifdef HAVE_PCRE2
+  if (rv->regex != NULL) {
+    rv->code = rofi_pcre2_compile(s, case_sensitive);
+  }
+#endif
+  g_free(str);
+  return rv->regex != NULL;
+}
+
+/**
+ * @param matcher The token to match.
+ * @param input The string to match against.
+ *
+ * @returns TRUE when matcher matches input (ignoring invert).
+ */
+static inline gboolean rofi_int_matcher_match(const rofi_int_matcher *matcher,
+                                              const char *input) {
+#ifdef HAVE_PCRE2
+  if (matcher->code != NULL) {
+    RofiMatchThreadData *td = rofi_match_thread_data_get();
+    return pcre2_match((const pcre2_code *)matcher->code, (PCRE2_SPTR)input,
+                       PCRE2_ZERO_TERMINATED, 0, 0, td->match_data,
+                       td->match_context) >= 0;
+  }
+#endif
+  return g_regex_match(matcher->regex, input, 0, NULL);
 }
 
 static rofi_int_matcher *create_regex(const char *input, int case_sensitive) {
-  GRegex *retv = NULL;
   gchar *r;
   rofi_int_matcher *rv = g_malloc0(sizeof(rofi_int_matcher));
   if (input && input[0] == config.matching_negate_char) {
@@ -225,34 +318,32 @@ static rofi_int_matcher *create_regex(const char *input, int case_sensitive) {
   switch (config.matching_method) {
   case MM_GLOB:
     r = glob_to_regex(input);
-    retv = R(r, case_sensitive);
+    R(rv, r, case_sensitive);
     g_free(r);
     break;
   case MM_REGEX:
-    retv = R(input, case_sensitive);
-    if (retv == NULL) {
+    if (!R(rv, input, case_sensitive)) {
       r = g_regex_escape_string(input, -1);
-      retv = R(r, case_sensitive);
+      R(rv, r, case_sensitive);
       g_free(r);
     }
     break;
   case MM_FUZZY:
     r = fuzzy_to_regex(input);
-    retv = R(r, case_sensitive);
+    R(rv, r, case_sensitive);
     g_free(r);
     break;
   case MM_PREFIX:
     r = prefix_regex(input);
-    retv = R(r, case_sensitive);
+    R(rv, r, case_sensitive);
     g_free(r);
     break;
   default:
     r = g_regex_escape_string(input, -1);
-    retv = R(r, case_sensitive);
+    R(rv, r, case_sensitive);
     g_free(r);
     break;
   }
-  rv->regex = retv;
   return rv;
 }
 rofi_int_matcher **helper_tokenize(const char *input, int case_sensitive) {
@@ -293,6 +384,240 @@ rofi_int_matcher **helper_tokenize(const char *input, int case_sensitive) {
   return retv;
 }
 
+/** A word boundary in the prefix index. */
+typedef struct {
+  /** Offset of the boundary in the folded text. */
+  uint32_t offset;
+  /** Entry the text belongs to. */
+  uint32_t entry;
+} RofiPrefixIndexSuffix;
+
+struct _RofiPrefixIndex {
+  /** Case folded text of all strings, '\0' separated. */
+  GString *text;
+  /** Word boundaries, sorted on the text that follows them. */
+  GArray *suffixes;
+  /** Number of entries covered. */
+  unsigned int num_entries;
+};
+
+/** Classes used to find the word boundaries a '\b' in a regex can match. */
+typedef enum {
+  PREFIX_CLASS_OTHER,
+  PREFIX_CLASS_WORD,
+  /** Depends on the regex engine, boundary on both sides. */
+  PREFIX_CLASS_UNSURE,
+} RofiPrefixClass;
+
+static RofiPrefixClass rofi_prefix_class(gunichar c) {
+  if (c == '_' || g_unichar_isalnum(c)) {
+    return PREFIX_CLASS_WORD;
+  }
+  switch (g_unichar_type(c)) {
+  case G_UNICODE_SPACING_MARK:
+  case G_UNICODE_ENCLOSING_MARK:
+  case G_UNICODE_NON_SPACING_MARK:
+  case G_UNICODE_CONNECT_PUNCTUATION:
+    return PREFIX_CLASS_UNSURE;
+  default:
+    return PREFIX_CLASS_OTHER;
+  }
+}
+
+RofiPrefixIndex *rofi_prefix_index_new(void) {
+  RofiPrefixIndex *index = g_malloc0(sizeof(RofiPrefixIndex));
+  index->text = g_string_new(NULL);
+  index->suffixes = g_array_new(FALSE, FALSE, sizeof(RofiPrefixIndexSuffix));
+  return index;
+}
+
+void rofi_prefix_index_add(RofiPrefixIndex *index, unsigned int entry,
+                           const char *text) {
+  if (text == NULL || text[0] == '\0') {
+    return;
+  }
+  char *folded = g_utf8_casefold(text, -1);
+  uint32_t base = index->text->len;
+  g_string_append_len(index->text, folded, strlen(folded) + 1);
+
+  RofiPrefixClass prev = PREFIX_CLASS_OTHER;
+  for (const char *iter = folded; *iter; iter = g_utf8_next_char(iter)) {
+    RofiPrefixClass cur = rofi_prefix_class(g_utf8_get_char(iter));
+    if (cur != prev || cur == PREFIX_CLASS_UNSURE) {
+      RofiPrefixIndexSuffix s = {.offset = base + (iter - folded),
+                                 .entry = entry};
+      g_array_append_val(index->suffixes, s);
+    }
+    prev = cur;
+  }
+  g_free(folded);
+}
+
+static int rofi_prefix_index_sort(gconstpointer a, gconstpointer b,
+                                  gpointer data) {
+  const char *text = (const char *)data;
+  const RofiPrefixIndexSuffix *sa = (const RofiPrefixIndexSuffix *)a;
+  const RofiPrefixIndexSuffix *sb = (const RofiPrefixIndexSuffix *)b;
+  int retv = strcmp(text + sa->offset, text + sb->offset);
+  if (retv == 0) {
+    retv = (sa->entry > sb->entry) - (sa->entry < sb->entry);
+  }
+  return retv;
+}
+
+void rofi_prefix_index_build(RofiPrefixIndex *index, unsigned int num_entries) {
+  g_qsort_with_data(index->suffixes->data, index->suffixes->len,
+                    sizeof(RofiPrefixIndexSuffix), rofi_prefix_index_sort,
+                    index->text->str);
+  index->num_entries = num_entries;
+}
+
+unsigned int rofi_prefix_index_get_length(const RofiPrefixIndex *index) {
+  return index ? index->num_entries : 0;
+}
+
+/**
+ * @param index The index.
+ * @param prefix The case folded prefix.
+ * @param first Set to the first matching suffix.
+ *
+ * @returns the number of suffixes starting with prefix.
+ */
+static unsigned int rofi_prefix_index_range(const RofiPrefixIndex *index,
+                                            const char *prefix,
+                                            unsigned int *first) {
+  const RofiPrefixIndexSuffix *s =
+      (const RofiPrefixIndexSuffix *)index->suffixes->data;
+  const char *text = index->text->str;
+  size_t plen = strlen(prefix);
+  // Lower bound: first suffix >= prefix.
+  unsigned int lo = 0, hi = index->suffixes->len;
+  while (lo < hi) {
+    unsigned int mid = lo + (hi - lo) / 2;
+    if (strcmp(text + s[mid].offset, prefix) < 0) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  *first = lo;
+  // Upper bound: first suffix that does not start with prefix.
+  hi = index->suffixes->len;
+  while (lo < hi) {
+    unsigned int mid = lo + (hi - lo) / 2;
+    if (strncmp(text + s[mid].offset, prefix, plen) == 0) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  return lo - *first;
+}
+
+static int rofi_prefix_index_cmp_entry(const void *a, const void *b) {
+  unsigned int ea = *(const unsigned int *)a;
+  unsigned int eb = *(const unsigned int *)b;
+  return (ea > eb) - (ea < eb);
+}
+
+/**
+ * @param index The index.
+ * @param first The first suffix of the range.
+ * @param num The number of suffixes in the range.
+ * @param entries Filled with the sorted, unique, entries of the range.
+ *
+ * @returns the number of entries.
+ */
+static unsigned int rofi_prefix_index_entries(const RofiPrefixIndex *index,
+                                              unsigned int first,
+                                              unsigned int num,
+                                              unsigned int *entries) {
+  const RofiPrefixIndexSuffix *s =
+      (const RofiPrefixIndexSuffix *)index->suffixes->data;
+  for (unsigned int i = 0; i < num; i++) {
+    entries[i] = s[first + i].entry;
+  }
+  qsort(entries, num, sizeof(unsigned int), rofi_prefix_index_cmp_entry);
+  unsigned int length = 0;
+  for (unsigned int i = 0; i < num; i++) {
+    if (length == 0 || entries[length - 1] != entries[i]) {
+      entries[length++] = entries[i];
+    }
+  }
+  return length;
+}
+
+gboolean rofi_prefix_index_lookup(const RofiPrefixIndex *index,
+                                  const char *input, unsigned int **entries,
+                                  unsigned int *length) {
+  if (index == NULL || input == NULL) {
+    return FALSE;
+  }
+  gchar **tokens = NULL;
+  if (config.tokenize) {
+    tokens = g_strsplit(input, " ", -1);
+  } else {
+    tokens = g_new0(gchar *, 2);
+    tokens[0] = g_strdup(input);
+  }
+  unsigned int *result = NULL;
+  unsigned int num_result = 0;
+  gboolean narrowed = FALSE;
+  for (gchar **token = tokens; *token != NULL; token++) {
+    // Negated tokens do not narrow down the set.
+    if ((*token)[0] == '\0' || (*token)[0] == config.matching_negate_char) {
+      continue;
+    }
+    char *folded = g_utf8_casefold(*token, -1);
+    unsigned int first = 0;
+    unsigned int num = rofi_prefix_index_range(index, folded, &first);
+    g_free(folded);
+
+    unsigned int *set = g_malloc(MAX(num, 1) * sizeof(unsigned int));
+    unsigned int num_set = rofi_prefix_index_entries(index, first, num, set);
+    if (!narrowed) {
+      result = set;
+      num_result = num_set;
+      narrowed = TRUE;
+    } else {
+      // Intersect the two sorted sets.
+      unsigned int i = 0, j = 0, k = 0;
+      while (i < num_result && j < num_set) {
+        if (result[i] < set[j]) {
+          i++;
+        } else if (result[i] > set[j]) {
+          j++;
+        } else {
+          result[k++] = result[i];
+          i++;
+          j++;
+        }
+      }
+      num_result = k;
+      g_free(set);
+    }
+    if (num_result == 0) {
+      break;
+    }
+  }
+  g_strfreev(tokens);
+  if (!narrowed) {
+    return FALSE;
+  }
+  *entries = result;
+  *length = num_result;
+  return TRUE;
+}
+
+void rofi_prefix_index_free(RofiPrefixIndex *index) {
+  if (index == NULL) {
+    return;
+  }
+  g_string_free(index->text, TRUE);
+  g_array_free(index->suffixes, TRUE);
+  g_free(index);
+}
+
 // cli arg handling
 int find_arg(const char *const key) {
   int i;
@@ -517,13 +842,13 @@ int helper_token_match(rofi_int_matcher *const *tokens, const char *input) {
     if (config.normalize_match) {
       char *r = utf8_helper_simplify_string(input);
       for (int j = 0; match && tokens[j]; j++) {
-        match = g_regex_match(tokens[j]->regex, r, 0, NULL);
+        match = rofi_int_matcher_match(tokens[j], r);
         match ^= tokens[j]->invert;
       }
       g_free(r);
     } else {
       for (int j = 0; match && tokens[j]; j++) {
-        match = g_regex_match(tokens[j]->regex, input, 0, NULL);
+        match = rofi_int_matcher_match(tokens[j], input);
         match ^= tokens[j]->invert;
       }
     }
@@ -1232,44 +1557,217 @@ void parse_ranges(char *input, rofi_range_pair **list, unsigned int *length) {
     }
   }
 }
-void rofi_output_formatted_line(const char *format, const char *string,
-                                int selected_line, const char *filter) {
+/** Strings shorter than this are copied into the output buffer. */
+#define OUTPUT_BUFFER_COPY_LIMIT 256
+/** Maximum number of segments passed to a single writev call. */
+#define OUTPUT_BUFFER_MAX_IOV 1024
+
+/**
+ * Segment of pending output.
+ */
+typedef struct {
+  /** External data, or NULL when the data lives in the scratch buffer. */
+  const char *data;
+  /** Offset in the scratch buffer, if data is NULL. */
+  gsize offset;
+  /** Length of the segment. */
+  gsize length;
+} RofiOutputSegment;
+
+struct _RofiOutputBuffer {
+  /** File descriptor to write to. */
+  int fd;
+  /** Flush when this many bytes are pending. */
+  gsize threshold;
+  /** Number of bytes pending. */
+  gsize pending;
+  /** Formatted data. */
+  GString *scratch;
+  /** List of segments to write, in order. */
+  GArray *segments;
+};
+
+RofiOutputBuffer *rofi_output_buffer_new(int fd, gsize threshold) {
+  RofiOutputBuffer *ob = g_malloc0(sizeof(RofiOutputBuffer));
+  ob->fd = fd;
+  ob->threshold = threshold;
+  ob->scratch = g_string_sized_new(MAX(threshold, 4096));
+  ob->segments = g_array_new(FALSE, FALSE, sizeof(RofiOutputSegment));
+  return ob;
+}
+
+/**
+ * @param ob The output buffer.
+ * @param data The data to add.
+ * @param length The length of data.
+ * @param copy If the data should always be copied.
+ *
+ * Queue data for writing. Short or transient data is copied into the scratch
+ * buffer, long strings are referenced.
+ */
+static void rofi_output_buffer_append(RofiOutputBuffer *ob, const char *data,
+                                      gsize length, gboolean copy) {
+  if (length == 0) {
+    return;
+  }
+  ob->pending += length;
+  if (!copy && length >= OUTPUT_BUFFER_COPY_LIMIT) {
+    RofiOutputSegment seg = {.data = data, .offset = 0, .length = length};
+    g_array_append_val(ob->segments, seg);
+    return;
+  }
+  // Extend the last segment if it ends at the end of the scratch buffer.
+  if (ob->segments->len > 0) {
+    RofiOutputSegment *last = &g_array_index(
+        ob->segments, RofiOutputSegment, ob->segments->len - 1);
+    if (last->data == NULL &&
+        (last->offset + last->length) == ob->scratch->len) {
+      g_string_append_len(ob->scratch, data, length);
+      last->length += length;
+      return;
+    }
+  }
+  RofiOutputSegment seg = {
+      .data = NULL, .offset = ob->scratch->len, .length = length};
+  g_string_append_len(ob->scratch, data, length);
+  g_array_append_val(ob->segments, seg);
+}
+
+static void rofi_output_buffer_append_quoted(RofiOutputBuffer *ob,
+                                             const char *string) {
+  // Same quoting as g_shell_quote, without the allocation.
+  rofi_output_buffer_append(ob, "'", 1, TRUE);
+  const char *start = string;
+  for (const char *iter = string; *iter != '\0'; iter++) {
+    if (*iter == '\'') {
+      rofi_output_buffer_append(ob, start, iter - start, FALSE);
+      rofi_output_buffer_append(ob, "'\\''", 4, TRUE);
+      start = iter + 1;
+    }
+  }
+  rofi_output_buffer_append(ob, start, strlen(start), FALSE);
+  rofi_output_buffer_append(ob, "'", 1, TRUE);
+}
+
+static void rofi_output_buffer_append_int(RofiOutputBuffer *ob, int value) {
+  char buffer[32];
+  int length = g_snprintf(buffer, sizeof(buffer), "%d", value);
+  rofi_output_buffer_append(ob, buffer, length, TRUE);
+}
+
+void rofi_output_buffer_add_line(RofiOutputBuffer *ob, const char *format,
+                                 const char *string, int selected_line,
+                                 const char *filter) {
   for (int i = 0; format && format[i]; i++) {
     if (format[i] == 'i') {
-      fprintf(stdout, "%d", selected_line);
+      rofi_output_buffer_append_int(ob, selected_line);
     } else if (format[i] == 'd') {
-      fprintf(stdout, "%d", (selected_line + 1));
+      rofi_output_buffer_append_int(ob, selected_line + 1);
     } else if (format[i] == 's') {
-      fputs(string, stdout);
+      rofi_output_buffer_append(ob, string, strlen(string), FALSE);
     } else if (format[i] == 'p') {
       char *esc = NULL;
       pango_parse_markup(string, -1, 0, NULL, &esc, NULL, NULL);
       if (esc) {
-        fputs(esc, stdout);
+        rofi_output_buffer_append(ob, esc, strlen(esc), TRUE);
         g_free(esc);
       } else {
-        fputs("invalid string", stdout);
+        rofi_output_buffer_append(ob, "invalid string", 14, TRUE);
       }
     } else if (format[i] == 'q') {
-      char *quote = g_shell_quote(string);
-      fputs(quote, stdout);
-      g_free(quote);
+      rofi_output_buffer_append_quoted(ob, string);
     } else if (format[i] == 'f') {
       if (filter) {
-        fputs(filter, stdout);
+        rofi_output_buffer_append(ob, filter, strlen(filter), FALSE);
       }
     } else if (format[i] == 'F') {
       if (filter) {
-        char *quote = g_shell_quote(filter);
-        fputs(quote, stdout);
-        g_free(quote);
+        rofi_output_buffer_append_quoted(ob, filter);
       }
     } else {
-      fputc(format[i], stdout);
+      rofi_output_buffer_append(ob, &format[i], 1, TRUE);
     }
   }
-  fputc('\n', stdout);
+  rofi_output_buffer_append(ob, "\n", 1, TRUE);
+  if (ob->pending >= ob->threshold) {
+    rofi_output_buffer_flush(ob);
+  }
+}
+
+void rofi_output_buffer_flush(RofiOutputBuffer *ob) {
+  if (ob->segments->len == 0) {
+    return;
+  }
+  // Anything written through stdio should go out first.
   fflush(stdout);
+  struct iovec iov[OUTPUT_BUFFER_MAX_IOV];
+  guint index = 0;
+  while (index < ob->segments->len) {
+    int niov = 0;
+    for (; niov < OUTPUT_BUFFER_MAX_IOV && (index + niov) < ob->segments->len;
+         niov++) {
+      RofiOutputSegment *seg =
+          &g_array_index(ob->segments, RofiOutputSegment, index + niov);
+      iov[niov].iov_base = (void *)(seg->data != NULL
+                                        ? seg->data
+                                        : ob->scratch->str + seg->offset);
+      iov[niov].iov_len = seg->length;
+    }
+    index += niov;
+    struct iovec *cur = iov;
+    while (niov > 0) {
+      ssize_t written = writev(ob->fd, cur, niov);
+      if (written < 0) {
+        if (errno == EINTR) {
+          continue;
+        }
+        if (errno == EAGAIN || errno == EWOULDBLOCK) {
+          // Non-blocking output that is full, wait until it drains.
+          struct pollfd pfd = {.fd = ob->fd, .events = POLLOUT};
+          int ready;
+          do {
+            ready = poll(&pfd, 1, -1);
+          } while (ready < 0 && errno == EINTR);
+          if (ready > 0) {
+            continue;
+          }
+        }
+        g_warning("Failed to write output: %s", g_strerror(errno));
+        index = ob->segments->len;
+        break;
+      }
+      // Skip the parts that got written.
+      while (niov > 0 && (size_t)written >= cur->iov_len) {
+        written -= cur->iov_len;
+        cur++;
+        niov--;
+      }
+      if (niov > 0) {
+        cur->iov_base = (char *)cur->iov_base + written;
+        cur->iov_len -= written;
+      }
+    }
+  }
+  g_array_set_size(ob->segments, 0);
+  g_string_truncate(ob->scratch, 0);
+  ob->pending = 0;
+}
+
+void rofi_output_buffer_free(RofiOutputBuffer *ob) {
+  if (ob == NULL) {
+    return;
+  }
+  rofi_output_buffer_flush(ob);
+  g_string_free(ob->scratch, TRUE);
+  g_array_free(ob->segments, TRUE);
+  g_free(ob);
+}
+
+void rofi_output_formatted_line(const char *format, const char *string,
+                                int selected_line, const char *filter) {
+  RofiOutputBuffer *ob = rofi_output_buffer_new(STDOUT_FILENO, 0);
+  rofi_output_buffer_add_line(ob, format, string, selected_line, filter);
+  rofi_output_buffer_free(ob);
 }
 
 static gboolean helper_eval_cb2(const GMatchInfo *info, GString *res,
@@ -332,6 +332,14 @@ ActionBindingEntry rofi_bindings[] = {
      .name = "kb-entry-history-down",
      .binding = "Control+Down",
      .comment = "Go down in the history of the entry box"},
+    {.id = SELECT_ALL,
+     .name = "kb-select-all",
+     .binding = "",
+     .comment = "Select all filtered rows (multi-select)"},
+    {.id = SELECT_INVERT,
+     .name = "kb-select-invert",
+     .binding = "",
+     .comment = "Invert selection of the filtered rows (multi-select)"},
 
     /* Mouse-aware bindings */
 
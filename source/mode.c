@@ -154,6 +154,30 @@ int mode_token_match(const Mode *mode, rofi_int_matcher **tokens,
   return mode->_token_match(mode, tokens, selected_line);
 }
 
+RofiPrefixIndex *mode_get_prefix_index(Mode *mode) {
+  g_assert(mode != NULL);
+  if (mode->_get_prefix_index != NULL) {
+    return mode->_get_prefix_index(mode);
+  }
+  return NULL;
+}
+
+char *mode_get_icon_name(const Mode *mode, unsigned int selected_line) {
+  g_assert(mode != NULL);
+  if (mode->_get_icon_name != NULL) {
+    return mode->_get_icon_name(mode, selected_line);
+  }
+  return NULL;
+}
+
+char *mode_get_identity(const Mode *mode, unsigned int selected_line) {
+  g_assert(mode != NULL);
+  if (mode->_get_identity != NULL) {
+    return mode->_get_identity(mode, selected_line);
+  }
+  return mode_get_completion(mode, selected_line);
+}
+
 const char *mode_get_name(const Mode *mode) {
   g_assert(mode != NULL);
   return mode->name;
@@ -52,6 +52,9 @@
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <unistd.h>
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
 
 #include "modes/dmenuscriptshared.h"
 
@@ -61,6 +64,7 @@ static int dmenu_token_match(const Mode *sw, rofi_int_matcher **tokens,
 static cairo_surface_t *
 dmenu_get_icon(const Mode *sw, unsigned int selected_line, unsigned int height);
 static char *dmenu_get_message(const Mode *sw);
+static RofiPrefixIndex *dmenu_get_prefix_index(Mode *sw);
 
 static inline unsigned int bitget(uint32_t const *const array,
                                   unsigned int index) {
@@ -75,6 +79,77 @@ static inline void bittoggle(uint32_t *const array, unsigned int index) {
   *v ^= 1 << bit;
 }
 
+/**
+ * @param array The bitmap.
+ * @param words The number of words in the bitmap.
+ *
+ * @returns the number of bits set.
+ */
+static inline unsigned int bitcount(uint32_t const *const array,
+                                    unsigned int words) {
+  unsigned int count = 0;
+  for (unsigned int i = 0; i < words; i++) {
+    count += __builtin_popcount(array[i]);
+  }
+  return count;
+}
+
+/**
+ * @param array The bitmap to update.
+ * @param start The first index to set.
+ * @param stop The last index to set (inclusive).
+ *
+ * Set all bits in the range [start, stop], a word at the time where possible.
+ */
+static void bitset_range(uint32_t *const array, unsigned int start,
+                         unsigned int stop) {
+  while (start <= stop && (start % 32) != 0) {
+    array[start / 32] |= 1u << (start % 32);
+    start++;
+  }
+  while (start <= stop && (stop - start) >= 31) {
+    array[start / 32] = UINT32_MAX;
+    start += 32;
+  }
+  while (start <= stop) {
+    array[start / 32] |= 1u << (start % 32);
+    start++;
+  }
+}
+
+/** Row has an entry in the extras side table. */
+#define DMENU_ROW_EXTRAS (1u << 0)
+/** Row is marked urgent by its options. */
+#define DMENU_ROW_URGENT (1u << 1)
+/** Row is marked active by its options. */
+#define DMENU_ROW_ACTIVE (1u << 2)
+/** Row is marked nonselectable by its options. */
+#define DMENU_ROW_NONSELECTABLE (1u << 3)
+
+/**
+ * A single input row.
+ * Most input has no row options, so only the text and a set of flags are
+ * kept per row. Icon, meta and info are stored in a side table that only
+ * holds the rows that have them.
+ */
+typedef struct {
+  /** Entry content. (visible part) */
+  char *entry;
+  /** DMENU_ROW_* flags. */
+  uint8_t flags;
+} DmenuRow;
+
+/**
+ * Options of a row that are kept in the extras side table.
+ * The entry and flag fields of the DmenuScriptEntry are not used.
+ */
+typedef struct {
+  /** Index of the row, relative to the block while reading. */
+  unsigned int index;
+  /** The parsed options. */
+  DmenuScriptEntry *extras;
+} DmenuRowExtras;
+
 typedef struct {
   /** Settings */
   // Separator.
@@ -87,13 +162,25 @@ typedef struct {
   unsigned int num_urgent_list;
   struct rofi_range_pair *active_list;
   unsigned int num_active_list;
+  /** Bitmap with the rows marked urgent by urgent_list. */
+  uint32_t *urgent_rows;
+  /** Bitmap with the rows marked active by active_list. */
+  uint32_t *active_rows;
+  /** Number of rows the urgent/active bitmaps are resolved for. */
+  unsigned int row_state_length;
   uint32_t *selected_list;
   unsigned int num_selected_list;
+  /** Number of words allocated for selected_list. */
+  unsigned int selected_list_words;
   unsigned int do_markup;
   // List with entries.
-  DmenuScriptEntry *cmd_list;
+  DmenuRow *cmd_list;
   unsigned int cmd_list_real_length;
   unsigned int cmd_list_length;
+  /** Row options keyed by row index, only for rows with DMENU_ROW_EXTRAS. */
+  GHashTable *cmd_extras;
+  /** Prefix index over the rows, built on first use. */
+  RofiPrefixIndex *prefix_index;
   unsigned int only_selected;
   unsigned int selected_count;
 
@@ -113,17 +200,222 @@ typedef struct {
 
   char *ballot_selected;
   char *ballot_unselected;
+
+  /** Flush result output when this many bytes are buffered. */
+  unsigned int output_flush_threshold;
 } DmenuModePrivateData;
 
+/** Default amount of result output buffered before it is written. */
+#define DMENU_OUTPUT_FLUSH_THRESHOLD (1024 * 1024)
+
+static inline unsigned int get_index(unsigned int length, int index) {
+  if (index >= 0) {
+    return index;
+  }
+  if (((unsigned int)-index) <= length) {
+    return length + index;
+  }
+  // Out of range.
+  return UINT_MAX;
+}
+
+/**
+ * @param bitmap The bitmap to fill, sized for length rows.
+ * @param list The list of ranges.
+ * @param num The number of ranges in list.
+ * @param length The number of rows.
+ *
+ * Resolve the (possibly negative) ranges into the bitmap.
+ */
+static void dmenu_resolve_ranges(uint32_t *bitmap, const rofi_range_pair *list,
+                                 unsigned int num, unsigned int length) {
+  for (unsigned int i = 0; i < num; i++) {
+    unsigned int start = get_index(length, list[i].start);
+    unsigned int stop = get_index(length, list[i].stop);
+    if (start == UINT_MAX) {
+      continue;
+    }
+    stop = MIN(stop, length - 1);
+    if (start > stop) {
+      continue;
+    }
+    bitset_range(bitmap, start, stop);
+  }
+}
+
+/**
+ * @param pd The dmenu private data.
+ *
+ * Resolve the urgent and active ranges into bitmaps for the current rows.
+ * Ranges can be relative to the end of the list, so the bitmaps are rebuilt
+ * each time rows are appended.
+ */
+static void dmenu_update_row_state(DmenuModePrivateData *pd) {
+  unsigned int length = pd->cmd_list_length;
+  if (length == pd->row_state_length) {
+    return;
+  }
+  pd->row_state_length = length;
+  if (length == 0) {
+    return;
+  }
+  size_t words = length / 32 + 1;
+  if (pd->num_urgent_list > 0) {
+    pd->urgent_rows = g_realloc(pd->urgent_rows, words * sizeof(uint32_t));
+    memset(pd->urgent_rows, 0, words * sizeof(uint32_t));
+    dmenu_resolve_ranges(pd->urgent_rows, pd->urgent_list, pd->num_urgent_list,
+                         length);
+  }
+  if (pd->num_active_list > 0) {
+    pd->active_rows = g_realloc(pd->active_rows, words * sizeof(uint32_t));
+    memset(pd->active_rows, 0, words * sizeof(uint32_t));
+    dmenu_resolve_ranges(pd->active_rows, pd->active_list, pd->num_active_list,
+                         length);
+  }
+}
+
+/**
+ * @param pd The dmenu private data.
+ * @param index The row to get the state for.
+ *
+ * @returns the URGENT/ACTIVE state of the row.
+ */
+static inline int dmenu_get_row_state(const DmenuModePrivateData *pd,
+                                      unsigned int index) {
+  int state = 0;
+  if (index < pd->row_state_length) {
+    if (pd->urgent_rows && bitget(pd->urgent_rows, index)) {
+      state |= URGENT;
+    }
+    if (pd->active_rows && bitget(pd->active_rows, index)) {
+      state |= ACTIVE;
+    }
+  }
+  if (pd->cmd_list[index].flags & DMENU_ROW_URGENT) {
+    state |= URGENT;
+  }
+  if (pd->cmd_list[index].flags & DMENU_ROW_ACTIVE) {
+    state |= ACTIVE;
+  }
+  return state;
+}
+
+/**
+ * @param extras The row options to free.
+ *
+ * Free the options of a row in the extras side table.
+ */
+static void dmenu_row_extras_free(DmenuScriptEntry *extras) {
+  g_free(extras->icon_name);
+  g_free(extras->meta);
+  g_free(extras->info);
+  g_free(extras);
+}
+
+/**
+ * @param pd The dmenu private data.
+ * @param index The row to get the options for.
+ *
+ * @returns the options of the row, or NULL if it has none.
+ */
+static inline DmenuScriptEntry *dmenu_row_extras(const DmenuModePrivateData *pd,
+                                                 unsigned int index) {
+  if ((pd->cmd_list[index].flags & DMENU_ROW_EXTRAS) == 0) {
+    return NULL;
+  }
+  return g_hash_table_lookup(pd->cmd_extras, GUINT_TO_POINTER(index));
+}
+
+/**
+ * @param pd The dmenu private data.
+ * @param index The row to store the options for.
+ * @param extras The options, ownership is transferred.
+ *
+ * Store the options of a row in the extras side table.
+ */
+static void dmenu_row_extras_set(DmenuModePrivateData *pd, unsigned int index,
+                                 DmenuScriptEntry *extras) {
+  if (pd->cmd_extras == NULL) {
+    pd->cmd_extras = g_hash_table_new_full(
+        g_direct_hash, g_direct_equal, NULL,
+        (GDestroyNotify)dmenu_row_extras_free);
+  }
+  g_hash_table_replace(pd->cmd_extras, GUINT_TO_POINTER(index), extras);
+  pd->cmd_list[index].flags |= DMENU_ROW_EXTRAS;
+}
+
+/**
+ * @param row The row to fill.
+ * @param data The input line, options separated by a '\0'.
+ * @param len The length of data.
+ *
+ * Parse a line of input into row.
+ *
+ * @returns the options that go into the side table, or NULL if there are
+ * none.
+ */
+static DmenuScriptEntry *dmenu_parse_row(DmenuRow *row, char *data,
+                                         gsize len) {
+  DmenuScriptEntry *retv = NULL;
+  gsize data_len = len;
+  row->flags = 0;
+  char *end = data;
+  while (end < data + len && *end != '\0') {
+    end++;
+  }
+  if (end != data + len) {
+    DmenuScriptEntry extras = {0};
+    data_len = end - data;
+    dmenuscript_parse_entry_extras(NULL, &extras, end + 1, len - data_len);
+    if (extras.urgent) {
+      row->flags |= DMENU_ROW_URGENT;
+    }
+    if (extras.active) {
+      row->flags |= DMENU_ROW_ACTIVE;
+    }
+    if (extras.nonselectable) {
+      row->flags |= DMENU_ROW_NONSELECTABLE;
+    }
+    if (extras.icon_name != NULL || extras.meta != NULL ||
+        extras.info != NULL) {
+      retv = g_malloc(sizeof(DmenuScriptEntry));
+      memcpy(retv, &extras, sizeof(DmenuScriptEntry));
+    }
+  }
+  row->entry = rofi_force_utf8(data, data_len);
+  return retv;
+}
+
 /** Maximum number of lines rofi parses async before it pushes it to the main
  * thread. */
 #define BLOCK_LINES_SIZE 2048
 typedef struct {
   unsigned int length;
-  DmenuScriptEntry values[BLOCK_LINES_SIZE];
+  DmenuRow values[BLOCK_LINES_SIZE];
+  /** Options of the rows in this block, NULL if there are none. */
+  GArray *extras;
   DmenuModePrivateData *pd;
 } Block;
 
+/**
+ * @param block The block to free.
+ *
+ * Free a block that was not merged into the list.
+ */
+static void dmenu_block_free(Block *block) {
+  for (unsigned int i = 0; i < block->length; i++) {
+    g_free(block->values[i].entry);
+  }
+  if (block->extras != NULL) {
+    for (guint i = 0; i < block->extras->len; i++) {
+      dmenu_row_extras_free(
+          g_array_index(block->extras, DmenuRowExtras, i).extras);
+    }
+    g_array_free(block->extras, TRUE);
+  }
+  g_free(block);
+}
+
 static void read_add_block(DmenuModePrivateData *pd, Block **block, char *data,
                            gsize len) {
 
@@ -132,59 +424,30 @@ static void read_add_block(DmenuModePrivateData *pd, Block **block, char *data,
     (*block)->pd = pd;
     (*block)->length = 0;
   }
-  gsize data_len = len;
-  // Init.
-  (*block)->values[(*block)->length].icon_fetch_uid = 0;
-  (*block)->values[(*block)->length].icon_fetch_size = 0;
-  (*block)->values[(*block)->length].icon_fetch_scale = 0;
-  (*block)->values[(*block)->length].icon_name = NULL;
-  (*block)->values[(*block)->length].meta = NULL;
-  (*block)->values[(*block)->length].info = NULL;
-  (*block)->values[(*block)->length].nonselectable = FALSE;
-  char *end = data;
-  while (end < data + len && *end != '\0') {
-    end++;
-  }
-  if (end != data + len) {
-    data_len = end - data;
-    dmenuscript_parse_entry_extras(NULL, &((*block)->values[(*block)->length]),
-                                   end + 1, len - data_len);
+  DmenuScriptEntry *extras =
+      dmenu_parse_row(&((*block)->values[(*block)->length]), data, len);
+  if (extras != NULL) {
+    if ((*block)->extras == NULL) {
+      (*block)->extras = g_array_new(FALSE, FALSE, sizeof(DmenuRowExtras));
+    }
+    DmenuRowExtras re = {.index = (*block)->length, .extras = extras};
+    g_array_append_val((*block)->extras, re);
   }
-  char *utfstr = rofi_force_utf8(data, data_len);
-  (*block)->values[(*block)->length].entry = utfstr;
-  (*block)->values[(*block)->length + 1].entry = NULL;
 
   (*block)->length++;
 }
 
 static void read_add(DmenuModePrivateData *pd, char *data, gsize len) {
-  gsize data_len = len;
   if ((pd->cmd_list_length + 2) > pd->cmd_list_real_length) {
     pd->cmd_list_real_length = MAX(pd->cmd_list_real_length * 2, 512);
-    pd->cmd_list = g_realloc(pd->cmd_list, (pd->cmd_list_real_length) *
-                                               sizeof(DmenuScriptEntry));
-  }
-  // Init.
-  pd->cmd_list[pd->cmd_list_length].icon_fetch_uid = 0;
-  pd->cmd_list[pd->cmd_list_length].icon_fetch_size = 0;
-  pd->cmd_list[pd->cmd_list_length].icon_fetch_scale = 0;
-  pd->cmd_list[pd->cmd_list_length].icon_name = NULL;
-  pd->cmd_list[pd->cmd_list_length].meta = NULL;
-  pd->cmd_list[pd->cmd_list_length].info = NULL;
-  pd->cmd_list[pd->cmd_list_length].active = FALSE;
-  pd->cmd_list[pd->cmd_list_length].urgent = FALSE;
-  pd->cmd_list[pd->cmd_list_length].nonselectable = FALSE;
-  char *end = data;
-  while (end < data + len && *end != '\0') {
-    end++;
+    pd->cmd_list =
+        g_realloc(pd->cmd_list, (pd->cmd_list_real_length) * sizeof(DmenuRow));
   }
-  if (end != data + len) {
-    data_len = end - data;
-    dmenuscript_parse_entry_extras(NULL, &(pd->cmd_list[pd->cmd_list_length]),
-                                   end + 1, len - data_len);
+  DmenuScriptEntry *extras =
+      dmenu_parse_row(&(pd->cmd_list[pd->cmd_list_length]), data, len);
+  if (extras != NULL) {
+    dmenu_row_extras_set(pd, pd->cmd_list_length, extras);
   }
-  char *utfstr = rofi_force_utf8(data, data_len);
-  pd->cmd_list[pd->cmd_list_length].entry = utfstr;
   pd->cmd_list[pd->cmd_list_length + 1].entry = NULL;
 
   pd->cmd_list_length++;
@@ -218,17 +481,27 @@ static gboolean dmenu_async_read_proc(gint fd, GIOCondition condition,
 
         if (pd->cmd_list_real_length < (pd->cmd_list_length + block->length)) {
           pd->cmd_list_real_length = MAX(pd->cmd_list_real_length * 2, 4096);
-          pd->cmd_list = g_realloc(pd->cmd_list, sizeof(DmenuScriptEntry) *
-                                                     pd->cmd_list_real_length);
+          pd->cmd_list = g_realloc(pd->cmd_list,
+                                   sizeof(DmenuRow) * pd->cmd_list_real_length);
         }
         memcpy(&(pd->cmd_list[pd->cmd_list_length]), &(block->values[0]),
-               sizeof(DmenuScriptEntry) * block->length);
+               sizeof(DmenuRow) * block->length);
+        if (block->extras != NULL) {
+          for (guint i = 0; i < block->extras->len; i++) {
+            DmenuRowExtras *re =
+                &g_array_index(block->extras, DmenuRowExtras, i);
+            dmenu_row_extras_set(pd, pd->cmd_list_length + re->index,
+                                 re->extras);
+          }
+          g_array_free(block->extras, TRUE);
+        }
         pd->cmd_list_length += block->length;
         g_free(block);
         changed = TRUE;
       }
       if (changed) {
-        rofi_view_reload();
+        dmenu_update_row_state(pd);
+        rofi_view_data_changed();
       }
     } else if (command == 'q') {
       if (pd->loading) {
@@ -239,30 +512,349 @@ static gboolean dmenu_async_read_proc(gint fd, GIOCondition condition,
   return G_SOURCE_CONTINUE;
 }
 
-static void read_input_sync(DmenuModePrivateData *pd, unsigned int pre_read) {
-  ssize_t nread = 0;
-  size_t len = 0;
-  char *line = NULL;
-  while (pre_read > 0 &&
-         (nread = getdelim(&line, &len, pd->separator, pd->fd_file)) != -1) {
-    if (line[nread - 1] == pd->separator) {
-      nread--;
-      line[nread] = '\0';
+/** Number of bytes read from the input at the time. */
+#define DMENU_READ_SIZE (64 * 1024)
+/** Number of bytes needed to detect compressed input. */
+#define DMENU_INPUT_MAGIC_SIZE 4
+
+/** Compression of the input, detected from its first bytes. */
+typedef enum {
+  DMENU_INPUT_PLAIN,
+  DMENU_INPUT_GZIP,
+  DMENU_INPUT_ZSTD,
+} DmenuInputCompression;
+
+typedef void (*DmenuAddLineFunc)(DmenuModePrivateData *pd, char *data,
+                                 gsize len, gpointer user_data);
+
+/**
+ * Splits the input into lines, decompressing it first if it is gzip or zstd
+ * compressed.
+ */
+typedef struct {
+  DmenuModePrivateData *pd;
+  /** Called for every complete line. */
+  DmenuAddLineFunc add_line;
+  gpointer user_data;
+
+  /** Set once the compression is known. */
+  gboolean detected;
+  DmenuInputCompression compression;
+  /** First bytes of the input, kept until the compression is known. */
+  char magic[DMENU_INPUT_MAGIC_SIZE];
+  gsize magic_len;
+  /** gzip decompressor. */
+  GConverter *gzip;
+#ifdef HAVE_ZSTD
+  /** zstd decompression stream. */
+  ZSTD_DStream *zstd;
+#endif
+
+  /** (Decompressed) data not yet split into lines. */
+  char *buffer;
+  gsize length;
+  gsize size;
+} DmenuInput;
+
+static void dmenu_input_init(DmenuInput *input, DmenuModePrivateData *pd,
+                             DmenuAddLineFunc add_line, gpointer user_data) {
+  memset(input, 0, sizeof(DmenuInput));
+  input->pd = pd;
+  input->add_line = add_line;
+  input->user_data = user_data;
+}
+
+static void dmenu_input_clear(DmenuInput *input) {
+  if (input->gzip != NULL) {
+    g_object_unref(input->gzip);
+  }
+#ifdef HAVE_ZSTD
+  if (input->zstd != NULL) {
+    ZSTD_freeDStream(input->zstd);
+  }
+#endif
+  g_free(input->buffer);
+  memset(input, 0, sizeof(DmenuInput));
+}
+
+/**
+ * @param input The input.
+ * @param space The number of bytes needed.
+ *
+ * Make sure there are space bytes free at the end of the buffer, one byte
+ * is always kept free for a terminating '\0'.
+ */
+static void dmenu_input_reserve(DmenuInput *input, gsize space) {
+  if ((input->length + space + 1) > input->size) {
+    input->size = MAX(input->size * 2, input->length + space + 1);
+    input->buffer = g_realloc(input->buffer, input->size);
+  }
+}
+
+/**
+ * @param input The input.
+ *
+ * Pick the decompressor based on the magic bytes at the start of the input.
+ */
+static void dmenu_input_detect(DmenuInput *input) {
+  const unsigned char *m = (const unsigned char *)input->magic;
+  input->detected = TRUE;
+  input->compression = DMENU_INPUT_PLAIN;
+  if (input->magic_len >= 2 && m[0] == 0x1f && m[1] == 0x8b) {
+    input->compression = DMENU_INPUT_GZIP;
+    input->gzip =
+        G_CONVERTER(g_zlib_decompressor_new(G_ZLIB_COMPRESSOR_FORMAT_GZIP));
+  } else if (input->magic_len >= 4 && m[0] == 0x28 && m[1] == 0xb5 &&
+             m[2] == 0x2f && m[3] == 0xfd) {
+#ifdef HAVE_ZSTD
+    input->compression = DMENU_INPUT_ZSTD;
+    input->zstd = ZSTD_createDStream();
+    ZSTD_initDStream(input->zstd);
+#else
+    g_warning("Input is zstd compressed, but rofi is built without zstd "
+              "support.");
+#endif
+  }
+  g_debug("Input compression: %d", input->compression);
+}
+
+static gboolean dmenu_input_decode_gzip(DmenuInput *input, const char *data,
+                                        gsize len, gboolean at_end) {
+  GConverterFlags flags =
+      at_end ? G_CONVERTER_INPUT_AT_END : G_CONVERTER_NO_FLAGS;
+  while (TRUE) {
+    gsize bytes_read = 0, bytes_written = 0;
+    GError *error = NULL;
+    dmenu_input_reserve(input, DMENU_READ_SIZE);
+    GConverterResult res = g_converter_convert(
+        input->gzip, data, len, input->buffer + input->length,
+        input->size - input->length - 1, flags, &bytes_read, &bytes_written,
+        &error);
+    data += bytes_read;
+    len -= bytes_read;
+    input->length += bytes_written;
+    if (res == G_CONVERTER_ERROR) {
+      if (g_error_matches(error, G_IO_ERROR, G_IO_ERROR_PARTIAL_INPUT)) {
+        // Needs more input.
+        g_error_free(error);
+        return TRUE;
+      }
+      if (g_error_matches(error, G_IO_ERROR, G_IO_ERROR_NO_SPACE)) {
+        g_error_free(error);
+        dmenu_input_reserve(input, input->size);
+        continue;
+      }
+      g_warning("Failed to decompress input: %s", error->message);
+      g_error_free(error);
+      return FALSE;
+    }
+    if (res == G_CONVERTER_FINISHED) {
+      // gzip files can consist of multiple members.
+      g_converter_reset(input->gzip);
+      if (len == 0) {
+        return TRUE;
+      }
+      continue;
+    }
+    if (len == 0 && (at_end == FALSE || bytes_written == 0)) {
+      return TRUE;
+    }
+  }
+}
+
+#ifdef HAVE_ZSTD
+static gboolean dmenu_input_decode_zstd(DmenuInput *input, const char *data,
+                                        gsize len) {
+  ZSTD_inBuffer in = {.src = data, .size = len, .pos = 0};
+  gboolean full = FALSE;
+  do {
+    dmenu_input_reserve(input, DMENU_READ_SIZE);
+    ZSTD_outBuffer out = {.dst = input->buffer + input->length,
+                          .size = input->size - input->length - 1,
+                          .pos = 0};
+    size_t res = ZSTD_decompressStream(input->zstd, &out, &in);
+    if (ZSTD_isError(res)) {
+      g_warning("Failed to decompress input: %s", ZSTD_getErrorName(res));
+      return FALSE;
+    }
+    input->length += out.pos;
+    // A full output buffer can mean there is more output pending.
+    full = (out.pos == out.size);
+  } while (in.pos < in.size || full);
+  return TRUE;
+}
+#endif
+
+/**
+ * @param input The input.
+ * @param data The (possibly compressed) data.
+ * @param len The length of data.
+ * @param at_end If this is the end of the input.
+ *
+ * Append data to the buffer, decompressing it if needed.
+ *
+ * @returns FALSE if the input cannot be decompressed.
+ */
+static gboolean dmenu_input_append(DmenuInput *input, const char *data,
+                                   gsize len, gboolean at_end) {
+  switch (input->compression) {
+  case DMENU_INPUT_GZIP:
+    return dmenu_input_decode_gzip(input, data, len, at_end);
+  case DMENU_INPUT_ZSTD:
+#ifdef HAVE_ZSTD
+    return dmenu_input_decode_zstd(input, data, len);
+#endif
+  case DMENU_INPUT_PLAIN:
+  default:
+    dmenu_input_reserve(input, len);
+    memcpy(input->buffer + input->length, data, len);
+    input->length += len;
+    return TRUE;
+  }
+}
+
+/**
+ * @param input The input.
+ *
+ * Hand all complete lines to the add_line callback and move the remainder to
+ * the start of the buffer.
+ */
+static void dmenu_input_split(DmenuInput *input) {
+  char *start = input->buffer;
+  char *end = input->buffer + input->length;
+  char *sep = NULL;
+  while ((sep = memchr(start, input->pd->separator, end - start)) != NULL) {
+    *sep = '\0';
+    input->add_line(input->pd, start, sep - start, input->user_data);
+    start = sep + 1;
+  }
+  input->length = end - start;
+  if (input->length > 0 && start != input->buffer) {
+    memmove(input->buffer, start, input->length);
+  }
+}
+
+/**
+ * @param input The input.
+ * @param data The data read.
+ * @param len The length of data.
+ *
+ * Process a chunk of the input.
+ *
+ * @returns FALSE if the input cannot be decompressed.
+ */
+static gboolean dmenu_input_push(DmenuInput *input, const char *data,
+                                 gsize len) {
+  if (!input->detected) {
+    gsize n = MIN(len, DMENU_INPUT_MAGIC_SIZE - input->magic_len);
+    memcpy(input->magic + input->magic_len, data, n);
+    input->magic_len += n;
+    data += n;
+    len -= n;
+    if (input->magic_len < DMENU_INPUT_MAGIC_SIZE) {
+      return TRUE;
+    }
+    dmenu_input_detect(input);
+    if (!dmenu_input_append(input, input->magic, input->magic_len, FALSE)) {
+      return FALSE;
     }
-    read_add(pd, line, nread);
-    pre_read--;
   }
-  free(line);
-  return;
+  if (!dmenu_input_append(input, data, len, FALSE)) {
+    return FALSE;
+  }
+  dmenu_input_split(input);
+  return TRUE;
+}
+
+/**
+ * @param input The input.
+ *
+ * Hand the data after the last separator to the add_line callback as a line.
+ */
+static void dmenu_input_flush(DmenuInput *input) {
+  if (input->length > 0) {
+    input->buffer[input->length] = '\0';
+    input->add_line(input->pd, input->buffer, input->length, input->user_data);
+    input->length = 0;
+  }
+}
+
+/**
+ * @param input The input.
+ *
+ * Process the end of the input.
+ */
+static void dmenu_input_finish(DmenuInput *input) {
+  gboolean ok = TRUE;
+  if (!input->detected) {
+    dmenu_input_detect(input);
+    ok = dmenu_input_append(input, input->magic, input->magic_len, TRUE);
+  } else {
+    ok = dmenu_input_append(input, NULL, 0, TRUE);
+  }
+  if (ok) {
+    dmenu_input_split(input);
+    dmenu_input_flush(input);
+  }
+}
+
+static void read_input_sync_add_line(DmenuModePrivateData *pd, char *data,
+                                     gsize len,
+                                     G_GNUC_UNUSED gpointer user_data) {
+  read_add(pd, data, len);
+}
+
+static void read_input_sync(DmenuModePrivateData *pd) {
+  DmenuInput input;
+  dmenu_input_init(&input, pd, read_input_sync_add_line, NULL);
+  char *raw = g_malloc(DMENU_READ_SIZE);
+  size_t nread = 0;
+  gboolean ok = TRUE;
+  while (ok && (nread = fread(raw, 1, DMENU_READ_SIZE, pd->fd_file)) > 0) {
+    ok = dmenu_input_push(&input, raw, nread);
+  }
+  if (ok) {
+    dmenu_input_finish(&input);
+  }
+  dmenu_input_clear(&input);
+  g_free(raw);
+}
+
+/** State of the reading thread. */
+typedef struct {
+  /** Block being filled. */
+  Block *block;
+  /** Time since the last block was handed over. */
+  GTimer *tim;
+} DmenuReadThreadState;
+
+static void read_input_thread_push(DmenuModePrivateData *pd,
+                                   DmenuReadThreadState *ts) {
+  if (ts->block) {
+    g_timer_start(ts->tim);
+    g_async_queue_push(pd->async_queue, ts->block);
+    ts->block = NULL;
+    write(pd->pipefd2[1], "r", 1);
+  }
 }
+
+static void read_input_thread_add_line(DmenuModePrivateData *pd, char *data,
+                                       gsize len, gpointer user_data) {
+  DmenuReadThreadState *ts = (DmenuReadThreadState *)user_data;
+  read_add_block(pd, &(ts->block), data, len);
+  double elapsed = g_timer_elapsed(ts->tim, NULL);
+  if (elapsed >= 0.1 || ts->block->length == BLOCK_LINES_SIZE) {
+    read_input_thread_push(pd, ts);
+  }
+}
+
 static gpointer read_input_thread(gpointer userdata) {
   DmenuModePrivateData *pd = (DmenuModePrivateData *)userdata;
-  ssize_t nread = 0;
-  ssize_t len = 0;
-  char *line = NULL;
-  Block *block = NULL;
+  DmenuReadThreadState ts = {.block = NULL, .tim = g_timer_new()};
+  DmenuInput input;
+  dmenu_input_init(&input, pd, read_input_thread_add_line, &ts);
+  char *raw = g_malloc(DMENU_READ_SIZE);
 
-  GTimer *tim = g_timer_new();
   int fd = pd->fd;
   while (1) {
     // Wait for input from the input or from the main thread.
@@ -285,68 +877,31 @@ static gpointer read_input_thread(gpointer userdata) {
       }
       //  Input data is available.
       if (FD_ISSET(fd, &rfds)) {
-        ssize_t readbytes = 0;
-        if ((nread + 1024) > len) {
-          line = g_realloc(line, (nread + 1024));
-          len = nread + 1024;
-        }
-        readbytes = read(fd, &line[nread], 1023);
+        ssize_t readbytes = read(fd, raw, DMENU_READ_SIZE);
         if (readbytes > 0) {
-          nread += readbytes;
-          line[nread] = '\0';
-          ssize_t i = 0;
-          while (i < nread) {
-            if (line[i] == pd->separator) {
-              line[i] = '\0';
-              read_add_block(pd, &block, line, i);
-              memmove(&line[0], &line[i + 1], nread - (i + 1));
-              nread -= (i + 1);
-              i = 0;
-              if (block) {
-                double elapsed = g_timer_elapsed(tim, NULL);
-                if (elapsed >= 0.1 || block->length == BLOCK_LINES_SIZE) {
-                  g_timer_start(tim);
-                  g_async_queue_push(pd->async_queue, block);
-                  block = NULL;
-                  write(pd->pipefd2[1], "r", 1);
-                }
-              }
-            } else {
-              i++;
-            }
+          if (!dmenu_input_push(&input, raw, readbytes)) {
+            read_input_thread_push(pd, &ts);
+            break;
           }
         } else {
           // remainder in buffer, then quit.
-          if (nread > 0) {
-            line[nread] = '\0';
-            read_add_block(pd, &block, line, nread);
-          }
-          if (block) {
-            g_timer_start(tim);
-            g_async_queue_push(pd->async_queue, block);
-            block = NULL;
-            write(pd->pipefd2[1], "r", 1);
-          }
+          dmenu_input_finish(&input);
+          read_input_thread_push(pd, &ts);
           break;
         }
       }
     } else {
       // Timeout, pushout remainder data.
-      if (nread > 0) {
-        line[nread] = '\0';
-        read_add_block(pd, &block, line, nread);
-        nread = 0;
-      }
-      if (block) {
-        g_timer_start(tim);
-        g_async_queue_push(pd->async_queue, block);
-        block = NULL;
-        write(pd->pipefd2[1], "r", 1);
-      }
+      dmenu_input_flush(&input);
+      read_input_thread_push(pd, &ts);
     }
   }
-  g_timer_destroy(tim);
-  free(line);
+  if (ts.block != NULL) {
+    dmenu_block_free(ts.block);
+  }
+  g_timer_destroy(ts.tim);
+  dmenu_input_clear(&input);
+  g_free(raw);
   write(pd->pipefd2[1], "q", 1);
   return NULL;
 }
@@ -358,13 +913,28 @@ static unsigned int dmenu_mode_get_num_entries(const Mode *sw) {
   return retv;
 }
 
+/**
+ * @param pd The dmenu private data.
+ * @param index The row.
+ *
+ * Rows that came in after the selection bitmap was last grown are not
+ * selected.
+ *
+ * @returns TRUE if row @p index is selected.
+ */
+static gboolean dmenu_row_selected(const DmenuModePrivateData *pd,
+                                   unsigned int index) {
+  return index / 32 < pd->selected_list_words &&
+         bitget(pd->selected_list, index) == TRUE;
+}
+
 static gchar *dmenu_format_output_string(const DmenuModePrivateData *pd,
                                          const char *input,
                                          const unsigned int index,
                                          gboolean multi_select) {
   if (pd->columns == NULL) {
     if (multi_select) {
-      if (pd->selected_list && bitget(pd->selected_list, index) == TRUE) {
+      if (dmenu_row_selected(pd, index)) {
         return g_strdup_printf("%s%s", pd->ballot_selected, input);
       } else {
         return g_strdup_printf("%s%s", pd->ballot_unselected, input);
@@ -382,7 +952,7 @@ static gchar *dmenu_format_output_string(const DmenuModePrivateData *pd,
   GString *str_retv = g_string_new("");
 
   if (multi_select) {
-    if (pd->selected_list && bitget(pd->selected_list, index) == TRUE) {
+    if (dmenu_row_selected(pd, index)) {
       g_string_append(str_retv, pd->ballot_selected);
     } else {
       g_string_append(str_retv, pd->ballot_unselected);
@@ -406,21 +976,10 @@ static gchar *dmenu_format_output_string(const DmenuModePrivateData *pd,
   return retv;
 }
 
-static inline unsigned int get_index(unsigned int length, int index) {
-  if (index >= 0) {
-    return index;
-  }
-  if (((unsigned int)-index) <= length) {
-    return length + index;
-  }
-  // Out of range.
-  return UINT_MAX;
-}
-
 static char *dmenu_get_completion_data(const Mode *data, unsigned int index) {
   Mode *sw = (Mode *)data;
   DmenuModePrivateData *pd = (DmenuModePrivateData *)mode_get_private_data(sw);
-  DmenuScriptEntry *retv = (DmenuScriptEntry *)pd->cmd_list;
+  DmenuRow *retv = pd->cmd_list;
   return dmenu_format_output_string(pd, retv[index].entry, index, FALSE);
 }
 
@@ -428,35 +987,14 @@ static char *get_display_data(const Mode *data, unsigned int index, int *state,
                               G_GNUC_UNUSED GList **list, int get_entry) {
   Mode *sw = (Mode *)data;
   DmenuModePrivateData *pd = (DmenuModePrivateData *)mode_get_private_data(sw);
-  DmenuScriptEntry *retv = (DmenuScriptEntry *)pd->cmd_list;
-  for (unsigned int i = 0; i < pd->num_active_list; i++) {
-    unsigned int start =
-        get_index(pd->cmd_list_length, pd->active_list[i].start);
-    unsigned int stop = get_index(pd->cmd_list_length, pd->active_list[i].stop);
-    if (index >= start && index <= stop) {
-      *state |= ACTIVE;
-    }
-  }
-  for (unsigned int i = 0; i < pd->num_urgent_list; i++) {
-    unsigned int start =
-        get_index(pd->cmd_list_length, pd->urgent_list[i].start);
-    unsigned int stop = get_index(pd->cmd_list_length, pd->urgent_list[i].stop);
-    if (index >= start && index <= stop) {
-      *state |= URGENT;
-    }
-  }
-  if (pd->selected_list && bitget(pd->selected_list, index) == TRUE) {
+  DmenuRow *retv = pd->cmd_list;
+  *state |= dmenu_get_row_state(pd, index);
+  if (dmenu_row_selected(pd, index)) {
     *state |= SELECTED;
   }
   if (pd->do_markup) {
     *state |= MARKUP;
   }
-  if (pd->cmd_list[index].urgent) {
-    *state |= URGENT;
-  }
-  if (pd->cmd_list[index].active) {
-    *state |= ACTIVE;
-  }
   char *my_retv =
       (get_entry ? dmenu_format_output_string(pd, retv[index].entry, index,
                                               pd->multi_select)
@@ -472,16 +1010,17 @@ static void dmenu_mode_free(Mode *sw) {
   if (pd != NULL) {
 
     for (size_t i = 0; i < pd->cmd_list_length; i++) {
-      if (pd->cmd_list[i].entry) {
-        g_free(pd->cmd_list[i].entry);
-        g_free(pd->cmd_list[i].icon_name);
-        g_free(pd->cmd_list[i].meta);
-        g_free(pd->cmd_list[i].info);
-      }
+      g_free(pd->cmd_list[i].entry);
     }
     g_free(pd->cmd_list);
+    if (pd->cmd_extras != NULL) {
+      g_hash_table_destroy(pd->cmd_extras);
+    }
+    rofi_prefix_index_free(pd->prefix_index);
     g_free(pd->urgent_list);
     g_free(pd->active_list);
+    g_free(pd->urgent_rows);
+    g_free(pd->active_rows);
     g_free(pd->selected_list);
 
     g_free(pd);
@@ -506,7 +1045,8 @@ Mode dmenu_mode = {.name = "dmenu",
                    .private_data = NULL,
                    .free = NULL,
                    .display_name = "dmenu",
-                   .type = MODE_TYPE_DMENU};
+                   .type = MODE_TYPE_DMENU,
+                   ._get_prefix_index = dmenu_get_prefix_index};
 
 static int dmenu_mode_init(Mode *sw) {
   if (mode_get_private_data(sw) != NULL) {
@@ -544,6 +1084,8 @@ static int dmenu_mode_init(Mode *sw) {
 
   // Allow user to override the output format.
   find_arg_str("-format", &(pd->format));
+  pd->output_flush_threshold = DMENU_OUTPUT_FLUSH_THRESHOLD;
+  find_arg_uint("-flush-threshold", &(pd->output_flush_threshold));
   // Urgent.
   char *str = NULL;
   find_arg_str("-u", &str);
@@ -641,7 +1183,8 @@ static int dmenu_mode_init(Mode *sw) {
       g_free(estr);
     }
 
-    read_input_sync(pd, -1);
+    read_input_sync(pd);
+    dmenu_update_row_state(pd);
   }
   gchar *columns = NULL;
   if (find_arg_str("-display-columns", &columns)) {
@@ -666,6 +1209,7 @@ static int dmenu_token_match(const Mode *sw, rofi_int_matcher **tokens,
     esc = rmpd->cmd_list[index].entry;
   }
   if (esc) {
+    const DmenuScriptEntry *extras = dmenu_row_extras(rmpd, index);
     //        int retv = helper_token_match ( tokens, esc );
     int match = 1;
     if (tokens) {
@@ -673,8 +1217,8 @@ static int dmenu_token_match(const Mode *sw, rofi_int_matcher **tokens,
         rofi_int_matcher *ftokens[2] = {tokens[j], NULL};
         int test = 0;
         test = helper_token_match(ftokens, esc);
-        if (test == tokens[j]->invert && rmpd->cmd_list[index].meta) {
-          test = helper_token_match(ftokens, rmpd->cmd_list[index].meta);
+        if (test == tokens[j]->invert && extras && extras->meta) {
+          test = helper_token_match(ftokens, extras->meta);
         }
 
         if (test == 0) {
@@ -689,6 +1233,34 @@ static int dmenu_token_match(const Mode *sw, rofi_int_matcher **tokens,
   }
   return FALSE;
 }
+static RofiPrefixIndex *dmenu_get_prefix_index(Mode *sw) {
+  DmenuModePrivateData *pd = (DmenuModePrivateData *)mode_get_private_data(sw);
+  unsigned int covered = rofi_prefix_index_get_length(pd->prefix_index);
+  // Rows are only appended, the view tests the rows the index does not cover.
+  // Rebuild once that tail gets too long.
+  if (pd->prefix_index != NULL && (pd->cmd_list_length - covered) <= covered) {
+    return pd->prefix_index;
+  }
+  rofi_prefix_index_free(pd->prefix_index);
+  pd->prefix_index = rofi_prefix_index_new();
+  for (unsigned int i = 0; i < pd->cmd_list_length; i++) {
+    if (pd->do_markup) {
+      char *esc = NULL;
+      pango_parse_markup(pd->cmd_list[i].entry, -1, 0, NULL, &esc, NULL, NULL);
+      rofi_prefix_index_add(pd->prefix_index, i, esc);
+      g_free(esc);
+    } else {
+      rofi_prefix_index_add(pd->prefix_index, i, pd->cmd_list[i].entry);
+    }
+    const DmenuScriptEntry *extras = dmenu_row_extras(pd, i);
+    if (extras != NULL && extras->meta != NULL) {
+      rofi_prefix_index_add(pd->prefix_index, i, extras->meta);
+    }
+  }
+  rofi_prefix_index_build(pd->prefix_index, pd->cmd_list_length);
+  return pd->prefix_index;
+}
+
 static char *dmenu_get_message(const Mode *sw) {
   DmenuModePrivateData *pd = (DmenuModePrivateData *)mode_get_private_data(sw);
   if (pd->message) {
@@ -700,11 +1272,11 @@ static cairo_surface_t *dmenu_get_icon(const Mode *sw,
                                        unsigned int selected_line,
                                        unsigned int height) {
   DmenuModePrivateData *pd = (DmenuModePrivateData *)mode_get_private_data(sw);
-  const guint scale = display_scale();
+  const double scale = display_scale();
 
   g_return_val_if_fail(pd->cmd_list != NULL, NULL);
-  DmenuScriptEntry *dr = &(pd->cmd_list[selected_line]);
-  if (dr->icon_name == NULL) {
+  DmenuScriptEntry *dr = dmenu_row_extras(pd, selected_line);
+  if (dr == NULL || dr->icon_name == NULL) {
     return NULL;
   }
   if (dr->icon_fetch_uid > 0 && dr->icon_fetch_size == height &&
@@ -719,6 +1291,97 @@ static cairo_surface_t *dmenu_get_icon(const Mode *sw,
   return rofi_icon_fetcher_get(uid);
 }
 
+/**
+ * @param pd The dmenu private data.
+ *
+ * Allocate the selection bitmap on first use, and grow it with the list when
+ * rows keep coming in asynchronously.
+ *
+ * @returns the number of words in the bitmap.
+ */
+static unsigned int dmenu_selected_list_ensure(DmenuModePrivateData *pd) {
+  unsigned int words = pd->cmd_list_length / 32 + 1;
+  if (words > pd->selected_list_words) {
+    pd->selected_list = g_realloc(pd->selected_list, sizeof(uint32_t) * words);
+    memset(pd->selected_list + pd->selected_list_words, 0,
+           sizeof(uint32_t) * (words - pd->selected_list_words));
+    pd->selected_list_words = words;
+  }
+  return words;
+}
+
+/**
+ * @param pd The dmenu private data.
+ * @param state The view state.
+ *
+ * Show the number of selected rows in the overlay.
+ */
+static void dmenu_selection_update_overlay(DmenuModePrivateData *pd,
+                                           RofiViewState *state) {
+  if (pd->selected_count > 0) {
+    char *str =
+        g_strdup_printf("%u/%u", pd->selected_count, pd->cmd_list_length);
+    rofi_view_set_overlay(state, str);
+    g_free(str);
+  } else {
+    rofi_view_set_overlay(state, NULL);
+  }
+}
+
+/**
+ * @param pd The dmenu private data.
+ * @param index The row to toggle.
+ *
+ * Toggle the selection state of a single row.
+ */
+static void dmenu_selection_toggle(DmenuModePrivateData *pd,
+                                   unsigned int index) {
+  dmenu_selected_list_ensure(pd);
+  pd->selected_count += (bitget(pd->selected_list, index) ? (-1) : (1));
+  bittoggle(pd->selected_list, index);
+}
+
+/**
+ * @param pd The dmenu private data.
+ * @param state The view state.
+ * @param invert Invert the selection instead of selecting.
+ *
+ * Select, or invert the selection of, all rows that pass the current filter.
+ * The filtered rows are turned into a mask that is applied a word at the time.
+ */
+static void dmenu_selection_bulk(DmenuModePrivateData *pd,
+                                 RofiViewState *state, gboolean invert) {
+  if (pd->cmd_list_length == 0) {
+    return;
+  }
+  unsigned int words = dmenu_selected_list_ensure(pd);
+  unsigned int filtered = 0;
+  const unsigned int *line_map =
+      rofi_view_get_filtered_line_map(state, &filtered);
+
+  uint32_t *mask = g_malloc0(sizeof(uint32_t) * words);
+  if (filtered == pd->cmd_list_length) {
+    // Nothing filtered out.
+    bitset_range(mask, 0, pd->cmd_list_length - 1);
+  } else {
+    for (unsigned int i = 0; i < filtered; i++) {
+      mask[line_map[i] / 32] |= 1u << (line_map[i] % 32);
+    }
+  }
+  uint32_t *const sl = pd->selected_list;
+  if (invert) {
+    for (unsigned int i = 0; i < words; i++) {
+      sl[i] ^= mask[i];
+    }
+  } else {
+    for (unsigned int i = 0; i < words; i++) {
+      sl[i] |= mask[i];
+    }
+  }
+  g_free(mask);
+  pd->selected_count = bitcount(sl, words);
+}
+
 static void dmenu_finish(DmenuModePrivateData *pd, RofiViewState *state,
                          int retv) {
 
@@ -735,7 +1398,7 @@ static void dmenu_finish(DmenuModePrivateData *pd, RofiViewState *state,
     g_async_queue_lock(pd->async_queue);
     Block *block = NULL;
     while ((block = g_async_queue_try_pop_unlocked(pd->async_queue)) != NULL) {
-      g_free(block);
+      dmenu_block_free(block);
     }
     g_async_queue_unlock(pd->async_queue);
     g_async_queue_unref(pd->async_queue);
@@ -761,13 +1424,21 @@ static void dmenu_finish(DmenuModePrivateData *pd, RofiViewState *state,
 }
 
 static void dmenu_print_results(DmenuModePrivateData *pd, const char *input) {
-  DmenuScriptEntry *cmd_list = pd->cmd_list;
+  DmenuRow *cmd_list = pd->cmd_list;
   int seen = FALSE;
-  if (pd->selected_list != NULL) {
-    for (unsigned int st = 0; st < pd->cmd_list_length; st++) {
-      if (bitget(pd->selected_list, st)) {
+  RofiOutputBuffer *ob =
+      rofi_output_buffer_new(STDOUT_FILENO, pd->output_flush_threshold);
+  if (pd->selected_list != NULL && pd->selected_count > 0) {
+    // Walk the set bits in index order, skipping empty words.
+    unsigned int words = dmenu_selected_list_ensure(pd);
+    for (unsigned int w = 0; w < words; w++) {
+      uint32_t bits = pd->selected_list[w];
+      while (bits != 0) {
+        unsigned int st = w * 32 + __builtin_ctz(bits);
+        bits &= bits - 1;
         seen = TRUE;
-        rofi_output_formatted_line(pd->format, cmd_list[st].entry, st, input);
+        rofi_output_buffer_add_line(ob, pd->format, cmd_list[st].entry, st,
+                                    input);
       }
     }
   }
@@ -777,9 +1448,11 @@ static void dmenu_print_results(DmenuModePrivateData *pd, const char *input) {
       cmd = cmd_list[pd->selected_line].entry;
     }
     if (cmd) {
-      rofi_output_formatted_line(pd->format, cmd, pd->selected_line, input);
+      rofi_output_buffer_add_line(ob, pd->format, cmd, pd->selected_line,
+                                  input);
     }
   }
+  rofi_output_buffer_free(ob);
 }
 
 static void dmenu_finalize(RofiViewState *state) {
@@ -788,7 +1461,7 @@ static void dmenu_finalize(RofiViewState *state) {
       (DmenuModePrivateData *)rofi_view_get_mode(state)->private_data;
 
   unsigned int cmd_list_length = pd->cmd_list_length;
-  DmenuScriptEntry *cmd_list = pd->cmd_list;
+  DmenuRow *cmd_list = pd->cmd_list;
 
   char *input = g_strdup(rofi_view_get_user_input(state));
   pd->selected_line = rofi_view_get_selected_line(state);
@@ -796,6 +1469,17 @@ static void dmenu_finalize(RofiViewState *state) {
   MenuReturn mretv = rofi_view_get_return_value(state);
   unsigned int next_pos = rofi_view_get_next_position(state);
   int restart = 0;
+  // Bulk selection changes.
+  if ((mretv & (MENU_SELECT_ALL | MENU_SELECT_INVERT)) && pd->multi_select) {
+    pd->loading = FALSE;
+    dmenu_selection_bulk(pd, state,
+                         (mretv & MENU_SELECT_INVERT) == MENU_SELECT_INVERT);
+    dmenu_selection_update_overlay(pd, state);
+    g_free(input);
+    rofi_view_restart(state);
+    rofi_view_set_selected_line(state, pd->selected_line);
+    return;
+  }
   // Special behavior.
   if (pd->only_selected) {
     /**
@@ -810,26 +1494,13 @@ static void dmenu_finalize(RofiViewState *state) {
       if ((mretv & MENU_CUSTOM_ACTION) && pd->multi_select) {
         restart = TRUE;
         pd->loading = FALSE;
-        if (pd->selected_list == NULL) {
-          pd->selected_list =
-              g_malloc0(sizeof(uint32_t) * (pd->cmd_list_length / 32 + 1));
-        }
-        pd->selected_count +=
-            (bitget(pd->selected_list, pd->selected_line) ? (-1) : (1));
-        bittoggle(pd->selected_list, pd->selected_line);
+        dmenu_selection_toggle(pd, pd->selected_line);
         // Move to next line.
         pd->selected_line = MIN(next_pos, cmd_list_length - 1);
-        if (pd->selected_count > 0) {
-          char *str =
-              g_strdup_printf("%u/%u", pd->selected_count, pd->cmd_list_length);
-          rofi_view_set_overlay(state, str);
-          g_free(str);
-        } else {
-          rofi_view_set_overlay(state, NULL);
-        }
+        dmenu_selection_update_overlay(pd, state);
       } else if ((mretv & (MENU_OK | MENU_CUSTOM_COMMAND)) &&
                  cmd_list[pd->selected_line].entry != NULL) {
-        if (cmd_list[pd->selected_line].nonselectable == TRUE) {
+        if ((cmd_list[pd->selected_line].flags & DMENU_ROW_NONSELECTABLE)) {
           g_free(input);
           return;
         }
@@ -859,29 +1530,16 @@ static void dmenu_finalize(RofiViewState *state) {
   if ((mretv & MENU_OK) && pd->selected_line != UINT32_MAX &&
       cmd_list[pd->selected_line].entry != NULL) {
     // Check if entry is non-selectable.
-    if (cmd_list[pd->selected_line].nonselectable == TRUE) {
+    if ((cmd_list[pd->selected_line].flags & DMENU_ROW_NONSELECTABLE)) {
       g_free(input);
       return;
     }
     if ((mretv & MENU_CUSTOM_ACTION) && pd->multi_select) {
       restart = TRUE;
-      if (pd->selected_list == NULL) {
-        pd->selected_list =
-            g_malloc0(sizeof(uint32_t) * (pd->cmd_list_length / 32 + 1));
-      }
-      pd->selected_count +=
-          (bitget(pd->selected_list, pd->selected_line) ? (-1) : (1));
-      bittoggle(pd->selected_list, pd->selected_line);
+      dmenu_selection_toggle(pd, pd->selected_line);
       // Move to next line.
       pd->selected_line = MIN(next_pos, cmd_list_length - 1);
-      if (pd->selected_count > 0) {
-        char *str =
-            g_strdup_printf("%u/%u", pd->selected_count, pd->cmd_list_length);
-        rofi_view_set_overlay(state, str);
-        g_free(str);
-      } else {
-        rofi_view_set_overlay(state, NULL);
-      }
+      dmenu_selection_update_overlay(pd, state);
     } else {
       dmenu_print_results(pd, input);
     }
@@ -916,7 +1574,7 @@ int dmenu_mode_dialog(void) {
 
   char *input = NULL;
   unsigned int cmd_list_length = pd->cmd_list_length;
-  DmenuScriptEntry *cmd_list = pd->cmd_list;
+  DmenuRow *cmd_list = pd->cmd_list;
 
   pd->only_selected = FALSE;
   pd->ballot_selected = "☑ ";
@@ -940,6 +1598,9 @@ int dmenu_mode_dialog(void) {
   if (find_arg("-password") >= 0) {
     menu_flags |= MENU_PASSWORD;
   }
+  if (pd->multi_select) {
+    menu_flags |= MENU_MULTI_SELECT;
+  }
   /* copy filter string */
   input = g_strdup(config.filter);
 
@@ -959,13 +1620,16 @@ int dmenu_mode_dialog(void) {
   if (find_arg("-dump") >= 0) {
     rofi_int_matcher **tokens = helper_tokenize(
         config.filter ? config.filter : "", config.case_sensitive);
+    RofiOutputBuffer *ob =
+        rofi_output_buffer_new(STDOUT_FILENO, pd->output_flush_threshold);
     unsigned int i = 0;
     for (i = 0; i < cmd_list_length; i++) {
       if (tokens == NULL || helper_token_match(tokens, cmd_list[i].entry)) {
-        rofi_output_formatted_line(pd->format, cmd_list[i].entry, i,
-                                   config.filter);
+        rofi_output_buffer_add_line(ob, pd->format, cmd_list[i].entry, i,
+                                    config.filter);
       }
     }
+    rofi_output_buffer_free(ob);
     helper_tokenize_free(tokens);
     dmenu_mode_free(&dmenu_mode);
     g_free(input);
@@ -1011,6 +1675,9 @@ void print_dmenu_options(void) {
                  NULL, is_term);
   print_help_msg("-selected-row", "[integer]", "Select row", NULL, is_term);
   print_help_msg("-format", "[string]", "Output format string", "s", is_term);
+  print_help_msg("-flush-threshold", "[integer]",
+                 "Bytes of output to buffer before writing it out", "1048576",
+                 is_term);
   print_help_msg("-u", "[list]", "List of row indexes to mark urgent", NULL,
                  is_term);
   print_help_msg("-a", "[list]", "List of row indexes to mark active", NULL,
@@ -44,6 +44,8 @@
 #include <sys/types.h>
 #include <unistd.h>
 
+#include <glib/gstdio.h>
+
 #include "display.h"
 #include "helper.h"
 #include "history.h"
@@ -87,6 +89,32 @@ typedef enum {
   DRUN_DESKTOP_ENTRY_TYPE_DIRECTORY,
 } DRunDesktopEntryType;
 
+/** Modification time of a $PATH directory that could not be read. */
+#define DRUN_EXEC_DIR_UNKNOWN (-1)
+/** Modification time of a $PATH directory that does not exist. */
+#define DRUN_EXEC_DIR_ABSENT (-2)
+
+/**
+ * Executables in the $PATH directories, used to resolve TryExec while
+ * scanning the desktop files.
+ *
+ * The directory mtimes are taken when the index is created, the directories
+ * are only listed on the first lookup.
+ */
+typedef struct {
+  /** The $PATH directories, in search order. */
+  char **dirs;
+  /** Modification time of each directory, or DRUN_EXEC_DIR_ABSENT or
+   * DRUN_EXEC_DIR_UNKNOWN. */
+  gint64 *mtimes;
+  /** Number of directories. */
+  guint num_dirs;
+  /** Executable name to (1 + index in dirs) of the first directory with it. */
+  GHashTable *names;
+  /** Memoized TryExec value to result. */
+  GHashTable *results;
+} DRunExecIndex;
+
 /**
  * Store extra information about the entry.
  * Currently the executable and if it should run in terminal.
@@ -114,6 +142,8 @@ typedef struct {
   cairo_surface_t *icon;
   /* Executable - for Application entries only */
   char *exec;
+  /* TryExec value, to check cached entries again when $PATH changed. */
+  char *try_exec;
   /* Name of the Entry */
   char *name;
   /* Generic Name */
@@ -128,10 +158,12 @@ typedef struct {
   GKeyFile *key_file;
   /* Used for sorting. */
   gint sort_index;
+  /* Collation key of name, only set while sorting. */
+  gchar *collate_key;
   /* UID for the icon to display */
   uint32_t icon_fetch_uid;
   uint32_t icon_fetch_size;
-  guint icon_fetch_scale;
+  double icon_fetch_scale;
   /* Type of desktop file */
   DRunDesktopEntryType type;
 } DRunModeEntry;
@@ -210,6 +242,12 @@ struct _DRunModePrivateData {
   // DE
   gchar **current_desktop_list;
 
+  /** Prefix index over the matched fields, built on first use. */
+  RofiPrefixIndex *prefix_index;
+
+  /** Executables in $PATH, only valid during get_apps(). */
+  DRunExecIndex *exec_index;
+
   gboolean file_complete;
   Mode *completer;
   char *old_completer_input;
@@ -416,6 +454,125 @@ static gboolean rofi_strv_contains(const char *const *categories,
   }
   return FALSE;
 }
+/**
+ * @returns a new index of the current $PATH, free with drun_exec_index_free().
+ */
+static DRunExecIndex *drun_exec_index_new(void) {
+  DRunExecIndex *index = g_malloc0(sizeof(*index));
+  const char *path = g_getenv("PATH");
+  // Same default as g_find_program_in_path().
+  index->dirs = g_strsplit(path ? path : "/bin:/usr/bin:.",
+                           G_SEARCHPATH_SEPARATOR_S, 0);
+  index->num_dirs = g_strv_length(index->dirs);
+  index->mtimes = g_malloc0_n(index->num_dirs + 1, sizeof(*(index->mtimes)));
+  gint64 now = g_get_real_time() / G_USEC_PER_SEC;
+  for (guint i = 0; i < index->num_dirs; i++) {
+    if (index->dirs[i][0] == '\0') {
+      // Empty element means the working directory.
+      g_free(index->dirs[i]);
+      index->dirs[i] = g_strdup(".");
+    }
+    GStatBuf st;
+    if (g_stat(index->dirs[i], &st) != 0) {
+      index->mtimes[i] =
+          (errno == ENOENT || errno == ENOTDIR) ? DRUN_EXEC_DIR_ABSENT
+                                                : DRUN_EXEC_DIR_UNKNOWN;
+    } else if ((gint64)st.st_mtime < now) {
+      index->mtimes[i] = (gint64)st.st_mtime;
+    } else {
+      // A directory changed in this second can change again unnoticed, keep
+      // it unknown so the next run does not trust it.
+      index->mtimes[i] = DRUN_EXEC_DIR_UNKNOWN;
+    }
+  }
+  index->results = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+  return index;
+}
+
+static void drun_exec_index_free(DRunExecIndex *index) {
+  if (index == NULL) {
+    return;
+  }
+  if (index->names) {
+    g_hash_table_destroy(index->names);
+  }
+  g_hash_table_destroy(index->results);
+  g_free(index->mtimes);
+  g_strfreev(index->dirs);
+  g_free(index);
+}
+
+/**
+ * List every $PATH directory once.
+ */
+static void drun_exec_index_fill(DRunExecIndex *index) {
+  index->names = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+  for (guint i = 0; i < index->num_dirs; i++) {
+    GDir *dir = g_dir_open(index->dirs[i], 0, NULL);
+    if (dir == NULL) {
+      continue;
+    }
+    const char *name = NULL;
+    while ((name = g_dir_read_name(dir)) != NULL) {
+      if (!g_hash_table_contains(index->names, name)) {
+        g_hash_table_insert(index->names, g_strdup(name),
+                            GUINT_TO_POINTER(i + 1));
+      }
+    }
+    g_dir_close(dir);
+  }
+  TICK_N("DRUN exec index");
+}
+
+static gboolean drun_exec_index_is_executable(const char *path) {
+  return g_file_test(path, G_FILE_TEST_IS_EXECUTABLE) &&
+         !g_file_test(path, G_FILE_TEST_IS_DIR);
+}
+
+/**
+ * @param index The executable index.
+ * @param te The TryExec value.
+ *
+ * Resolve a relative name with the index, only the first candidate is
+ * stat-ed. Results are memoized, actions of an entry repeat its TryExec.
+ *
+ * @returns TRUE if @p te is an executable.
+ */
+static gboolean drun_exec_index_try_exec(DRunExecIndex *index,
+                                         const char *te) {
+  gpointer value = NULL;
+  if (g_hash_table_lookup_extended(index->results, te, NULL, &value)) {
+    return GPOINTER_TO_INT(value);
+  }
+  gboolean found = FALSE;
+  if (g_path_is_absolute(te)) {
+    found = g_file_test(te, G_FILE_TEST_IS_EXECUTABLE);
+  } else if (strchr(te, G_DIR_SEPARATOR) != NULL) {
+    // Relative to the working directory, not looked up in $PATH.
+    char *fp = g_find_program_in_path(te);
+    found = fp != NULL;
+    g_free(fp);
+  } else {
+    if (index->names == NULL) {
+      drun_exec_index_fill(index);
+    }
+    guint dir = GPOINTER_TO_UINT(g_hash_table_lookup(index->names, te));
+    if (dir > 0) {
+      char *fp = g_build_filename(index->dirs[dir - 1], te, NULL);
+      found = drun_exec_index_is_executable(fp);
+      g_free(fp);
+      if (!found) {
+        // Shadowed by something that is not executable, search further.
+        fp = g_find_program_in_path(te);
+        found = fp != NULL;
+        g_free(fp);
+      }
+    }
+  }
+  g_hash_table_insert(index->results, g_strdup(te), GINT_TO_POINTER(found));
+  return found;
+}
+
 /**
  * This function absorbs/freeś path, so this is no longer available afterwards.
  */
@@ -576,24 +733,14 @@ static void read_desktop_file(DRunModePrivateData *pd, const char *root,
     return;
   }
 
+  char *te = NULL;
   if (g_key_file_has_key(kf, DRUN_GROUP_NAME, "TryExec", NULL)) {
-    char *te = g_key_file_get_string(kf, DRUN_GROUP_NAME, "TryExec", NULL);
-    if (!g_path_is_absolute(te)) {
-      char *fp = g_find_program_in_path(te);
-      if (fp == NULL) {
-        g_free(te);
-        g_key_file_free(kf);
-        return;
-      }
-      g_free(fp);
-    } else {
-      if (g_file_test(te, G_FILE_TEST_IS_EXECUTABLE) == FALSE) {
-        g_free(te);
-        g_key_file_free(kf);
-        return;
-      }
+    te = g_key_file_get_string(kf, DRUN_GROUP_NAME, "TryExec", NULL);
+    if (te == NULL || !drun_exec_index_try_exec(pd->exec_index, te)) {
+      g_free(te);
+      g_key_file_free(kf);
+      return;
     }
-    g_free(te);
   }
 
   char **categories = NULL;
@@ -603,6 +750,7 @@ static void read_desktop_file(DRunModePrivateData *pd, const char *root,
     if (!rofi_strv_contains((const char *const *)categories,
                             (const char *const *)pd->show_categories)) {
       g_strfreev(categories);
+      g_free(te);
       g_key_file_free(kf);
       return;
     }
@@ -629,6 +777,7 @@ static void read_desktop_file(DRunModePrivateData *pd, const char *root,
   pd->entry_list[pd->cmd_list_length].root = g_strdup(root);
   pd->entry_list[pd->cmd_list_length].path = g_strdup(path);
   pd->entry_list[pd->cmd_list_length].desktop_id = g_strdup(id);
+  pd->entry_list[pd->cmd_list_length].try_exec = te;
   pd->entry_list[pd->cmd_list_length].app_id =
       g_strndup(basename, strlen(basename) - strlen(".desktop"));
   gchar *n =
@@ -822,17 +971,44 @@ static gint drun_int_sort_list(gconstpointer a, gconstpointer b,
     if (db->name == NULL) {
       return 1;
     }
-    return g_utf8_collate(da->name, db->name);
+    // Keys are built up front, strcmp on them matches g_utf8_collate.
+    return strcmp(da->collate_key, db->collate_key);
   }
   return db->sort_index - da->sort_index;
 }
 
+/**
+ * @param pd The drun private data.
+ *
+ * Sort the entries on history and name. Locale collation of the names is done
+ * once per entry instead of in every comparison.
+ */
+static void drun_sort_entries(DRunModePrivateData *pd) {
+  for (unsigned int index = 0; index < pd->cmd_list_length; index++) {
+    DRunModeEntry *entry = &(pd->entry_list[index]);
+    entry->collate_key =
+        entry->name != NULL ? g_utf8_collate_key(entry->name, -1) : NULL;
+  }
+  TICK_N("Collation keys");
+
+  g_qsort_with_data(pd->entry_list, pd->cmd_list_length,
+                    sizeof(DRunModeEntry), drun_int_sort_list, NULL);
+
+  for (unsigned int index = 0; index < pd->cmd_list_length; index++) {
+    DRunModeEntry *entry = &(pd->entry_list[index]);
+    g_free(entry->collate_key);
+    entry->collate_key = NULL;
+  }
+}
+
 /*******************************************
  * Cache voodoo                            *
  *******************************************/
 
+static void drun_entry_clear(DRunModeEntry *e);
+
 /** Version of the DRUN cache file format. */
-#define CACHE_VERSION 2
+#define CACHE_VERSION 4
 static void drun_write_str(FILE *fd, const char *str) {
   size_t l = (str == NULL ? 0 : strlen(str));
   fwrite(&l, sizeof(l), 1, fd);
@@ -905,6 +1081,27 @@ static void write_cache(DRunModePrivateData *pd, const char *cache_file) {
   uint8_t version = CACHE_VERSION;
   fwrite(&version, sizeof(version), 1, fd);
 
+  // The $PATH directories the TryExec checks were made against.
+  DRunExecIndex *index = pd->exec_index;
+  fwrite(&(index->num_dirs), sizeof(index->num_dirs), 1, fd);
+  for (guint i = 0; i < index->num_dirs; i++) {
+    drun_write_str(fd, index->dirs[i]);
+    fwrite(&(index->mtimes[i]), sizeof(index->mtimes[i]), 1, fd);
+  }
+  // The TryExec values that failed, these entries are not in the cache.
+  GPtrArray *failed = g_ptr_array_new();
+  GHashTableIter iter;
+  gpointer key, value;
+  g_hash_table_iter_init(&iter, index->results);
+  while (g_hash_table_iter_next(&iter, &key, &value)) {
+    if (!GPOINTER_TO_INT(value)) {
+      g_ptr_array_add(failed, key);
+    }
+  }
+  g_ptr_array_add(failed, NULL);
+  drun_write_strv(fd, (char **)failed->pdata);
+  g_ptr_array_free(failed, TRUE);
+
   fwrite(&(pd->cmd_list_length), sizeof(pd->cmd_list_length), 1, fd);
   for (unsigned int index = 0; index < pd->cmd_list_length; index++) {
     DRunModeEntry *entry = &(pd->entry_list[index]);
@@ -916,6 +1113,7 @@ static void write_cache(DRunModePrivateData *pd, const char *cache_file) {
     drun_write_str(fd, entry->desktop_id);
     drun_write_str(fd, entry->icon_name);
     drun_write_str(fd, entry->exec);
+    drun_write_str(fd, entry->try_exec);
     drun_write_str(fd, entry->name);
     drun_write_str(fd, entry->generic_name);
 
@@ -930,6 +1128,62 @@ static void write_cache(DRunModePrivateData *pd, const char *cache_file) {
   TICK_N("DRUN Write CACHE: end");
 }
 
+/**
+ * Check the $PATH directories stored in the cache against @p index.
+ *
+ * @returns TRUE if the TryExec results in the cache are still valid, FALSE if
+ * they need to be checked again.
+ */
+static gboolean drun_read_cache_exec_dirs(const DRunExecIndex *index,
+                                          FILE *fd) {
+  guint num_dirs = 0;
+  if (fread(&num_dirs, sizeof(num_dirs), 1, fd) != 1) {
+    return FALSE;
+  }
+  // Read all of them, the failed TryExec values follow.
+  gboolean valid = num_dirs == index->num_dirs;
+  for (guint i = 0; i < num_dirs; i++) {
+    char *dir = NULL;
+    gint64 mtime = DRUN_EXEC_DIR_UNKNOWN;
+    drun_read_string(fd, &dir);
+    if (fread(&mtime, sizeof(mtime), 1, fd) != 1) {
+      mtime = DRUN_EXEC_DIR_UNKNOWN;
+    }
+    // A directory that is still absent is unchanged, an unknown one never is.
+    valid = valid && i < index->num_dirs &&
+            g_strcmp0(dir, index->dirs[i]) == 0 &&
+            mtime != DRUN_EXEC_DIR_UNKNOWN && mtime == index->mtimes[i];
+    g_free(dir);
+  }
+  return valid;
+}
+
+/**
+ * @param pd The drun private data.
+ *
+ * $PATH changed since the cache was written, check the TryExec of the cached
+ * entries again and drop the ones that fail now.
+ */
+static void drun_read_cache_try_exec(DRunModePrivateData *pd) {
+  unsigned int kept = 0;
+  for (unsigned int index = 0; index < pd->cmd_list_length; index++) {
+    DRunModeEntry *entry = &(pd->entry_list[index]);
+    if (entry->try_exec != NULL &&
+        !drun_exec_index_try_exec(pd->exec_index, entry->try_exec)) {
+      g_debug("[%s] TryExec '%s' fails now, dropping it from the cache.",
+              entry->desktop_id, entry->try_exec);
+      drun_entry_clear(entry);
+      continue;
+    }
+    if (kept != index) {
+      pd->entry_list[kept] = *entry;
+    }
+    kept++;
+  }
+  pd->cmd_list_length = kept;
+  TICK_N("DRUN cache TryExec");
+}
+
 /**
  * Read cache file. returns FALSE when success.
  */
@@ -966,6 +1220,24 @@ static gboolean drun_read_cache(DRunModePrivateData *pd,
     return TRUE;
   }
 
+  gboolean exec_dirs_valid = drun_read_cache_exec_dirs(pd->exec_index, fd);
+  char **failed = NULL;
+  drun_read_stringv(fd, &failed);
+  if (!exec_dirs_valid) {
+    // An entry skipped on its TryExec can show up now, only a scan finds it.
+    for (guint i = 0; failed && failed[i]; i++) {
+      if (drun_exec_index_try_exec(pd->exec_index, failed[i])) {
+        g_debug("TryExec '%s' passes since the cache was written, ignoring.",
+                failed[i]);
+        g_strfreev(failed);
+        fclose(fd);
+        TICK_N("DRUN Read CACHE: stop");
+        return TRUE;
+      }
+    }
+  }
+  g_strfreev(failed);
+
   if (fread(&(pd->cmd_list_length), sizeof(pd->cmd_list_length), 1, fd) != 1) {
     fclose(fd);
     g_warning("Cache corrupt, ignoring.");
@@ -988,6 +1260,7 @@ static gboolean drun_read_cache(DRunModePrivateData *pd,
     drun_read_string(fd, &(entry->desktop_id));
     drun_read_string(fd, &(entry->icon_name));
     drun_read_string(fd, &(entry->exec));
+    drun_read_string(fd, &(entry->try_exec));
     drun_read_string(fd, &(entry->name));
     drun_read_string(fd, &(entry->generic_name));
 
@@ -1001,6 +1274,10 @@ static gboolean drun_read_cache(DRunModePrivateData *pd,
   }
 
   fclose(fd);
+  if (!exec_dirs_valid) {
+    drun_read_cache_try_exec(pd);
+    write_cache(pd, cache_file);
+  }
   TICK_N("DRUN Read CACHE: stop");
   return FALSE;
 }
@@ -1008,6 +1285,7 @@ static gboolean drun_read_cache(DRunModePrivateData *pd,
 static void get_apps(DRunModePrivateData *pd) {
   char *cache_file = g_build_filename(cache_dir, DRUN_DESKTOP_CACHE_FILE, NULL);
   TICK_N("Get Desktop apps (start)");
+  pd->exec_index = drun_exec_index_new();
   if (drun_read_cache(pd, cache_file)) {
     ThemeWidget *wid = rofi_config_find_widget(drun_mode.name, NULL, TRUE);
 
@@ -1056,13 +1334,14 @@ static void get_apps(DRunModePrivateData *pd) {
     }
     get_apps_history(pd);
 
-    g_qsort_with_data(pd->entry_list, pd->cmd_list_length,
-                      sizeof(DRunModeEntry), drun_int_sort_list, NULL);
+    drun_sort_entries(pd);
 
     TICK_N("Sorting done.");
 
     write_cache(pd, cache_file);
   }
+  drun_exec_index_free(pd->exec_index);
+  pd->exec_index = NULL;
   g_free(cache_file);
 }
 
@@ -1150,6 +1429,7 @@ static void drun_entry_clear(DRunModeEntry *e) {
   }
   g_free(e->icon_name);
   g_free(e->exec);
+  g_free(e->try_exec);
   g_free(e->name);
   g_free(e->generic_name);
   g_free(e->comment);
@@ -1273,6 +1553,7 @@ static void drun_mode_destroy(Mode *sw) {
     }
     g_hash_table_destroy(rmpd->disabled_entries);
     g_free(rmpd->entry_list);
+    rofi_prefix_index_free(rmpd->prefix_index);
 
     g_free(rmpd->old_completer_input);
     g_free(rmpd->old_input);
@@ -1352,7 +1633,7 @@ static char *_get_display_value(const Mode *sw, unsigned int selected_line,
 static cairo_surface_t *_get_icon(const Mode *sw, unsigned int selected_line,
                                   unsigned int height) {
   DRunModePrivateData *pd = (DRunModePrivateData *)mode_get_private_data(sw);
-  const guint scale = display_scale();
+  const double scale = display_scale();
   if (pd->file_complete) {
     return pd->completer->_get_icon(pd->completer, selected_line, height);
   }
@@ -1373,6 +1654,26 @@ static cairo_surface_t *_get_icon(const Mode *sw, unsigned int selected_line,
   return NULL;
 }
 
+static char *drun_get_icon_name(const Mode *sw, unsigned int selected_line) {
+  DRunModePrivateData *pd = (DRunModePrivateData *)mode_get_private_data(sw);
+  if (pd->file_complete || selected_line >= pd->cmd_list_length) {
+    return NULL;
+  }
+  return g_strdup(pd->entry_list[selected_line].icon_name);
+}
+
+static char *drun_get_identity(const Mode *sw, unsigned int selected_line) {
+  DRunModePrivateData *pd = (DRunModePrivateData *)mode_get_private_data(sw);
+  if (pd->file_complete || selected_line >= pd->cmd_list_length) {
+    return NULL;
+  }
+  // Names are not unique, the same application can be installed twice. The
+  // desktop actions share the desktop id, their command tells them apart.
+  const DRunModeEntry *dr = &(pd->entry_list[selected_line]);
+  return g_strdup_printf("%s\n%s", dr->desktop_id,
+                         dr->exec != NULL ? dr->exec : "");
+}
+
 static char *drun_get_completion(const Mode *sw, unsigned int index) {
   DRunModePrivateData *pd = (DRunModePrivateData *)mode_get_private_data(sw);
   /* Free temp storage. */
@@ -1450,6 +1751,60 @@ static int drun_token_match(const Mode *data, rofi_int_matcher **tokens,
   return match;
 }
 
+/**
+ * @param index The prefix index.
+ * @param entry The entry index.
+ * @param e The entry.
+ *
+ * Add the fields drun_token_match() matches against to the index.
+ */
+static void drun_prefix_index_add_entry(RofiPrefixIndex *index,
+                                        unsigned int entry,
+                                        const DRunModeEntry *e) {
+  if (matching_entry_fields[DRUN_MATCH_FIELD_NAME].enabled_match) {
+    rofi_prefix_index_add(index, entry, e->name);
+  }
+  if (matching_entry_fields[DRUN_MATCH_FIELD_GENERIC].enabled_match) {
+    rofi_prefix_index_add(index, entry, e->generic_name);
+  }
+  if (matching_entry_fields[DRUN_MATCH_FIELD_EXEC].enabled_match) {
+    rofi_prefix_index_add(index, entry, e->exec);
+  }
+  if (matching_entry_fields[DRUN_MATCH_FIELD_CATEGORIES].enabled_match) {
+    for (int iter = 0; e->categories && e->categories[iter]; iter++) {
+      rofi_prefix_index_add(index, entry, e->categories[iter]);
+    }
+  }
+  if (matching_entry_fields[DRUN_MATCH_FIELD_KEYWORDS].enabled_match) {
+    for (int iter = 0; e->keywords && e->keywords[iter]; iter++) {
+      rofi_prefix_index_add(index, entry, e->keywords[iter]);
+    }
+  }
+  if (matching_entry_fields[DRUN_MATCH_FIELD_COMMENT].enabled_match) {
+    rofi_prefix_index_add(index, entry, e->comment);
+  }
+}
+
+static RofiPrefixIndex *drun_get_prefix_index(Mode *sw) {
+  DRunModePrivateData *rmpd = (DRunModePrivateData *)mode_get_private_data(sw);
+  if (rmpd->file_complete) {
+    return NULL;
+  }
+  // Deleting a history entry shifts the list, rebuild when the length changes.
+  if (rmpd->prefix_index == NULL ||
+      rofi_prefix_index_get_length(rmpd->prefix_index) !=
+          rmpd->cmd_list_length) {
+    rofi_prefix_index_free(rmpd->prefix_index);
+    rmpd->prefix_index = rofi_prefix_index_new();
+    for (unsigned int i = 0; i < rmpd->cmd_list_length; i++) {
+      drun_prefix_index_add_entry(rmpd->prefix_index, i,
+                                  &(rmpd->entry_list[i]));
+    }
+    rofi_prefix_index_build(rmpd->prefix_index, rmpd->cmd_list_length);
+  }
+  return rmpd->prefix_index;
+}
+
 static unsigned int drun_mode_get_num_entries(const Mode *sw) {
   const DRunModePrivateData *pd =
       (const DRunModePrivateData *)mode_get_private_data(sw);
@@ -1492,6 +1847,9 @@ Mode drun_mode = {.name = "drun",
                   ._preprocess_input = NULL,
                   .private_data = NULL,
                   .free = NULL,
-                  .type = MODE_TYPE_SWITCHER};
+                  .type = MODE_TYPE_SWITCHER,
+                  ._get_prefix_index = drun_get_prefix_index,
+                  ._get_icon_name = drun_get_icon_name,
+                  ._get_identity = drun_get_identity};
 
 #endif // ENABLE_DRUN
@@ -95,7 +95,7 @@ typedef struct {
   enum FBFileType type;
   uint32_t icon_fetch_uid;
   uint32_t icon_fetch_size;
-  guint icon_fetch_scale;
+  double icon_fetch_scale;
   gboolean link;
   time_t time;
 } FBFile;
@@ -612,7 +612,7 @@ static cairo_surface_t *_get_icon(const Mode *sw, unsigned int selected_line,
                                   unsigned int height) {
   FileBrowserModePrivateData *pd =
       (FileBrowserModePrivateData *)mode_get_private_data(sw);
-  const guint scale = display_scale();
+  const double scale = display_scale();
   g_return_val_if_fail(pd->array != NULL, NULL);
   FBFile *dr = &(pd->array[selected_line]);
   if (dr->icon_fetch_uid > 0 && dr->icon_fetch_size == height &&
@@ -68,15 +68,46 @@ enum FBFileType {
 
 /** Icons to use for the file type */
 const char *rb_icon_name[NUM_FILE_TYPES] = {"go-up", "folder", "gtk-file"};
+
+/** Number of directory nodes allocated at once. */
+#define RB_DIR_BLOCK_SIZE 1024
+/** Size of the blocks in the name pool. */
+#define RB_NAME_POOL_BLOCK_SIZE 65536
+/** Paths shorter than this are joined on the stack. */
+#define RB_PATH_BUF_SIZE 1024
+
+/**
+ * A scanned directory. The root holds the absolute path of the scanned
+ * directory, every other node its name and a link to its parent.
+ *
+ * Nodes and names are never freed or moved while the mode is alive, so the
+ * scanning thread can hand them out without copying.
+ */
+typedef struct _RBDir {
+  /** The parent directory, NULL for the root. */
+  const struct _RBDir *parent;
+  /** Name in the filename encoding. */
+  const char *name;
+  /** Name in UTF-8, the same string as name when that is valid UTF-8. */
+  const char *uname;
+  /** Length of name. */
+  unsigned int name_len;
+  /** Length of uname. */
+  unsigned int uname_len;
+} RBDir;
+
 typedef struct {
-  char *name;
-  char *path;
+  /** The directory holding the file. */
+  const RBDir *dir;
+  /** Name in the filename encoding. */
+  const char *name;
+  /** Name in UTF-8, the same string as name when that is valid UTF-8. */
+  const char *uname;
   enum FBFileType type;
   uint32_t icon_fetch_uid;
   uint32_t icon_fetch_size;
-  guint icon_fetch_scale;
+  double icon_fetch_scale;
   gboolean link;
-  time_t time;
 } FBFile;
 
 typedef struct {
@@ -93,18 +124,141 @@ typedef struct {
   gboolean loading;
   int pipefd2[2];
   GRegex *filter_regex;
+
+  /** Pool holding the names of all files and directories. */
+  GStringChunk *name_pool;
+  /** Blocks of #RB_DIR_BLOCK_SIZE directory nodes. */
+  GPtrArray *dir_blocks;
+  /** Nodes used in the last block. */
+  unsigned int dir_block_used;
+  /** If the filename encoding is UTF-8. */
+  gboolean filename_is_utf8;
 } FileBrowserModePrivateData;
 
 static void free_list(FileBrowserModePrivateData *pd) {
-  for (unsigned int i = 0; i < pd->array_length; i++) {
-    FBFile *fb = &(pd->array[i]);
-    g_free(fb->name);
-    g_free(fb->path);
-  }
   g_free(pd->array);
   pd->array = NULL;
   pd->array_length = 0;
   pd->array_length_real = 0;
+  if (pd->dir_blocks != NULL) {
+    g_ptr_array_free(pd->dir_blocks, TRUE);
+    pd->dir_blocks = NULL;
+  }
+  if (pd->name_pool != NULL) {
+    g_string_chunk_free(pd->name_pool);
+    pd->name_pool = NULL;
+  }
+}
+
+/**
+ * @param pd The private data.
+ * @param name The name in the filename encoding.
+ * @param name_len The length of @p name.
+ * @param uname_len Set to the length of the UTF-8 name.
+ *
+ * Store @p name in the pool, and its UTF-8 version if that differs.
+ *
+ * @returns the UTF-8 name, sets @p name to the pooled name.
+ */
+static const char *rb_pool_names(FileBrowserModePrivateData *pd,
+                                 const char **name, unsigned int name_len,
+                                 unsigned int *uname_len) {
+  *name = g_string_chunk_insert_len(pd->name_pool, *name, name_len);
+  if (pd->filename_is_utf8 && g_utf8_validate(*name, name_len, NULL)) {
+    *uname_len = name_len;
+    return *name;
+  }
+  // Rofi expects utf-8, so lets convert the filename.
+  char *conv = g_filename_to_utf8(*name, name_len, NULL, NULL, NULL);
+  if (conv == NULL) {
+    conv = rofi_force_utf8(*name, name_len);
+  }
+  *uname_len = strlen(conv);
+  const char *uname =
+      g_string_chunk_insert_len(pd->name_pool, conv, *uname_len);
+  g_free(conv);
+  return uname;
+}
+
+static const RBDir *rb_dir_new(FileBrowserModePrivateData *pd,
+                               const RBDir *parent, const char *name) {
+  if (pd->dir_blocks->len == 0 || pd->dir_block_used == RB_DIR_BLOCK_SIZE) {
+    g_ptr_array_add(pd->dir_blocks,
+                    g_malloc_n(RB_DIR_BLOCK_SIZE, sizeof(RBDir)));
+    pd->dir_block_used = 0;
+  }
+  RBDir *block = g_ptr_array_index(pd->dir_blocks, pd->dir_blocks->len - 1);
+  RBDir *dir = &(block[pd->dir_block_used++]);
+  dir->parent = parent;
+  dir->name_len = strlen(name);
+  dir->name = name;
+  dir->uname =
+      rb_pool_names(pd, &(dir->name), dir->name_len, &(dir->uname_len));
+  return dir;
+}
+
+/**
+ * Only the root can end with a separator, when it is "/".
+ */
+static inline gboolean rb_dir_ends_with_separator(const RBDir *dir) {
+  return dir->name_len > 0 && dir->name[dir->name_len - 1] == G_DIR_SEPARATOR;
+}
+
+/**
+ * @param dir The directory.
+ * @param name The name of the file in @p dir, or NULL.
+ * @param utf8 Join the UTF-8 names instead of the filename encoded ones.
+ * @param relative Leave out the root.
+ * @param buf Buffer to use if the path fits.
+ * @param buf_len The size of @p buf.
+ *
+ * Materialize the path of @p name by walking up the parent links.
+ *
+ * @returns the path, in @p buf or newly allocated. Free with g_free() if it is
+ * not @p buf.
+ */
+static char *rb_join(const RBDir *dir, const char *name, gboolean utf8,
+                     gboolean relative, char *buf, gsize buf_len) {
+  gsize name_len = name ? strlen(name) : 0;
+  // First pass to get the length, the second fills the path from the back.
+  gsize len = name_len;
+  gboolean first = (name == NULL);
+  for (const RBDir *iter = dir; iter != NULL; iter = iter->parent) {
+    if (relative && iter->parent == NULL) {
+      break;
+    }
+    len += (utf8 ? iter->uname_len : iter->name_len);
+    len += (first || rb_dir_ends_with_separator(iter)) ? 0 : 1;
+    first = FALSE;
+  }
+  char *retv = (len < buf_len) ? buf : g_malloc(len + 1);
+  gsize pos = len;
+  retv[pos] = '\0';
+  if (name != NULL) {
+    pos -= name_len;
+    memcpy(&(retv[pos]), name, name_len);
+  }
+  first = (name == NULL);
+  for (const RBDir *iter = dir; iter != NULL; iter = iter->parent) {
+    if (relative && iter->parent == NULL) {
+      break;
+    }
+    if (!(first || rb_dir_ends_with_separator(iter))) {
+      retv[--pos] = G_DIR_SEPARATOR;
+    }
+    gsize l = utf8 ? iter->uname_len : iter->name_len;
+    pos -= l;
+    memcpy(&(retv[pos]), utf8 ? iter->uname : iter->name, l);
+    first = FALSE;
+  }
+  return retv;
+}
+
+/**
+ * @returns the full path of @p f in the filename encoding, free with g_free().
+ */
+static char *rb_file_path(const FBFile *f) {
+  return rb_join(f->dir, f->name, FALSE, FALSE, NULL, 0);
 }
 #include <dirent.h>
 #include <sys/types.h>
@@ -179,9 +333,33 @@ static void recursive_browser_mode_init_current_dir(Mode *sw) {
   }
 }
 
-static void scan_dir(FileBrowserModePrivateData *pd, GFile *path) {
-  char *cdir = g_file_get_path(path);
+static void rb_push_file(FileBrowserModePrivateData *pd, const RBDir *dir,
+                         const char *name, gboolean link) {
+  FBFile *f = g_malloc0(sizeof(FBFile));
+  unsigned int uname_len = 0;
+  f->dir = dir;
+  f->name = name;
+  f->uname = rb_pool_names(pd, &(f->name), strlen(name), &uname_len);
+  f->icon_fetch_uid = 0;
+  f->icon_fetch_size = 0;
+  f->icon_fetch_scale = 0;
+  f->link = link;
+  // Default to file.
+  f->type = RFILE;
+
+  g_async_queue_push(pd->async_queue, f);
+  if (g_async_queue_length(pd->async_queue) > 10000) {
+    write(pd->pipefd2[1], "r", 1);
+  }
+}
+
+static void scan_dir(FileBrowserModePrivateData *pd, const RBDir *node) {
+  char buf[RB_PATH_BUF_SIZE];
+  char *cdir = rb_join(node, NULL, FALSE, FALSE, buf, sizeof(buf));
   DIR *dir = opendir(cdir);
+  if (cdir != buf) {
+    g_free(cdir);
+  }
   if (dir) {
     struct dirent *rd = NULL;
     while (pd->end_thread == FALSE && (rd = readdir(dir)) != NULL) {
@@ -203,66 +381,27 @@ static void scan_dir(FileBrowserModePrivateData *pd, GFile *path) {
       case DT_SOCK:
       default:
         break;
-      case DT_REG: {
-        FBFile *f = g_malloc0(sizeof(FBFile));
-        // Rofi expects utf-8, so lets convert the filename.
-        f->path = g_build_filename(cdir, rd->d_name, NULL);
-        f->name = g_filename_to_utf8(f->path, -1, NULL, NULL, NULL);
-        if (f->name == NULL) {
-          f->name = rofi_force_utf8(rd->d_name, -1);
-        }
-        f->type = (rd->d_type == DT_DIR) ? DIRECTORY : RFILE;
-        f->icon_fetch_uid = 0;
-        f->icon_fetch_size = 0;
-        f->icon_fetch_scale = 0;
-        f->link = FALSE;
-
-        g_async_queue_push(pd->async_queue, f);
-        if (g_async_queue_length(pd->async_queue) > 10000) {
-          write(pd->pipefd2[1], "r", 1);
-        }
+      case DT_REG:
+        rb_push_file(pd, node, rd->d_name, FALSE);
         break;
-      }
-      case DT_DIR: {
-        char *d = g_build_filename(cdir, rd->d_name, NULL);
-        GFile *dirp = g_file_new_for_path(d);
-        scan_dir(pd, dirp);
-        g_object_unref(dirp);
-        g_free(d);
+      case DT_DIR:
+        scan_dir(pd, rb_dir_new(pd, node, rd->d_name));
         break;
-      }
-      case DT_LNK: {
-        FBFile *f = g_malloc0(sizeof(FBFile));
-        // Rofi expects utf-8, so lets convert the filename.
-        f->path = g_build_filename(cdir, rd->d_name, NULL);
-        f->name = g_filename_to_utf8(f->path, -1, NULL, NULL, NULL);
-        if (f->name == NULL) {
-          f->name = rofi_force_utf8(rd->d_name, -1);
-        }
-        f->icon_fetch_uid = 0;
-        f->icon_fetch_size = 0;
-        f->icon_fetch_scale = 0;
-        f->link = TRUE;
-        // Default to file.
-        f->type = RFILE;
-        g_async_queue_push(pd->async_queue, f);
-        if (g_async_queue_length(pd->async_queue) > 10000) {
-          write(pd->pipefd2[1], "r", 1);
-        }
+      case DT_LNK:
+        rb_push_file(pd, node, rd->d_name, TRUE);
         break;
       }
-      }
     }
     closedir(dir);
   }
-
-  g_free(cdir);
 }
 static gpointer recursive_browser_input_thread(gpointer userdata) {
   FileBrowserModePrivateData *pd = (FileBrowserModePrivateData *)userdata;
   GTimer *t = g_timer_new();
   g_debug("Start scan.\n");
-  scan_dir(pd, pd->current_dir);
+  char *root = g_file_get_path(pd->current_dir);
+  scan_dir(pd, rb_dir_new(pd, NULL, root));
+  g_free(root);
   write(pd->pipefd2[1], "r", 1);
   write(pd->pipefd2[1], "q", 1);
   double f = g_timer_elapsed(t, NULL);
@@ -295,7 +434,7 @@ static gboolean recursive_browser_async_read_proc(gint fd,
         changed = TRUE;
       }
       if (changed) {
-        rofi_view_reload();
+        rofi_view_data_changed();
       }
     } else if (command == 'q') {
       if (pd->loading) {
@@ -324,6 +463,10 @@ static int recursive_browser_mode_init(Mode *sw) {
     pd->wake_source = g_unix_fd_add(pd->pipefd2[0], G_IO_IN,
                                     recursive_browser_async_read_proc, pd);
 
+    pd->name_pool = g_string_chunk_new(RB_NAME_POOL_BLOCK_SIZE);
+    pd->dir_blocks = g_ptr_array_new_with_free_func(g_free);
+    pd->filename_is_utf8 = g_get_filename_charsets(NULL);
+
     // Create the message passing queue to the UI thread.
     pd->async_queue = g_async_queue_new();
     pd->end_thread = FALSE;
@@ -366,7 +509,9 @@ static ModeMode recursive_browser_mode_result(Mode *sw, int mretv, char **input,
   } else if ((mretv & MENU_OK)) {
     if (selected_line < pd->array_length) {
       if (pd->array[selected_line].type == RFILE) {
-        char *d_esc = g_shell_quote(pd->array[selected_line].path);
+        char *path = rb_file_path(&(pd->array[selected_line]));
+        char *d_esc = g_shell_quote(path);
+        g_free(path);
         char *cmd = g_strdup_printf("%s %s", pd->command, d_esc);
         g_free(d_esc);
         char *cdir = g_file_get_path(pd->current_dir);
@@ -415,13 +560,17 @@ static char *_get_display_value(const Mode *sw, unsigned int selected_line,
   if (!get_entry) {
     return NULL;
   }
-  if (pd->array[selected_line].type == UP) {
+  const FBFile *f = &(pd->array[selected_line]);
+  if (f->type == UP) {
     return g_strdup(" ..");
   }
-  if (pd->array[selected_line].link) {
-    return g_strconcat("@", pd->array[selected_line].name, NULL);
+  char *path = rb_join(f->dir, f->uname, TRUE, FALSE, NULL, 0);
+  if (f->link) {
+    char *retv = g_strconcat("@", path, NULL);
+    g_free(path);
+    return retv;
   }
-  return g_strdup(pd->array[selected_line].name);
+  return path;
 }
 
 /**
@@ -439,23 +588,33 @@ static int recursive_browser_token_match(const Mode *sw,
   FileBrowserModePrivateData *pd =
       (FileBrowserModePrivateData *)mode_get_private_data(sw);
 
-  // Call default matching function.
-  return helper_token_match(tokens, pd->array[index].name);
+  // Match on the path below the scanned directory, it is the same for all
+  // entries.
+  const FBFile *f = &(pd->array[index]);
+  char buf[RB_PATH_BUF_SIZE];
+  char *path = rb_join(f->dir, f->uname, TRUE, TRUE, buf, sizeof(buf));
+  int retv = helper_token_match(tokens, path);
+  if (path != buf) {
+    g_free(path);
+  }
+  return retv;
 }
 
 static cairo_surface_t *_get_icon(const Mode *sw, unsigned int selected_line,
                                   unsigned int height) {
   FileBrowserModePrivateData *pd =
       (FileBrowserModePrivateData *)mode_get_private_data(sw);
-  const guint scale = display_scale();
+  const double scale = display_scale();
   g_return_val_if_fail(pd->array != NULL, NULL);
   FBFile *dr = &(pd->array[selected_line]);
   if (dr->icon_fetch_uid > 0 && dr->icon_fetch_size == height &&
       dr->icon_fetch_scale == scale) {
     return rofi_icon_fetcher_get(dr->icon_fetch_uid);
   }
-  if (rofi_icon_fetcher_file_is_image(dr->path)) {
-    dr->icon_fetch_uid = rofi_icon_fetcher_query(dr->path, height);
+  if (rofi_icon_fetcher_file_is_image(dr->name)) {
+    char *path = rb_file_path(dr);
+    dr->icon_fetch_uid = rofi_icon_fetcher_query(path, height);
+    g_free(path);
   } else {
     dr->icon_fetch_uid =
         rofi_icon_fetcher_query(rb_icon_name[dr->type], height);
@@ -482,7 +641,9 @@ static char *_get_completion(const Mode *sw, unsigned int index) {
   FileBrowserModePrivateData *pd =
       (FileBrowserModePrivateData *)mode_get_private_data(sw);
 
-  char *d = g_strescape(pd->array[index].path, NULL);
+  char *path = rb_file_path(&(pd->array[index]));
+  char *d = g_strescape(path, NULL);
+  g_free(path);
   return d;
 }
 
@@ -511,7 +672,9 @@ ModeMode recursive_browser_mode_completer(Mode *sw, int mretv, char **input,
   } else if ((mretv & MENU_OK)) {
     if (selected_line < pd->array_length) {
       if (pd->array[selected_line].type == RFILE) {
-        *path = g_strescape(pd->array[selected_line].path, NULL);
+        char *fp = rb_file_path(&(pd->array[selected_line]));
+        *path = g_strescape(fp, NULL);
+        g_free(fp);
         return MODE_EXIT;
       }
     }
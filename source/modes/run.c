@@ -39,10 +39,12 @@
 
 #include <dirent.h>
 #include <errno.h>
+#include <glib-unix.h>
 #include <limits.h>
 #include <signal.h>
 #include <string.h>
 #include <strings.h>
+#include <sys/select.h>
 #include <sys/types.h>
 #include <unistd.h>
 
@@ -67,7 +69,7 @@ typedef struct {
   char *entry;
   uint32_t icon_fetch_uid;
   uint32_t icon_fetch_size;
-  guint icon_fetch_scale;
+  double icon_fetch_scale;
   /* Surface holding the icon. */
   cairo_surface_t *icon;
 } RunEntry;
@@ -80,6 +82,24 @@ typedef struct {
   RunEntry *cmd_list;
   /** Length of the #cmd_list. */
   unsigned int cmd_list_length;
+  /** Number of history entries at the start of #cmd_list, these are not
+   * sorted. */
+  unsigned int num_favorites;
+
+  /** Thread reading the output of run-list-command. */
+  GThread *reading_thread;
+  /** Blocks of lines passed from the reading thread to the UI thread. */
+  GAsyncQueue *async_queue;
+  /** Output of run-list-command. */
+  int generator_fd;
+  /** Stop signal to the reading thread. */
+  int pipefd[2];
+  /** Wake up from the reading thread. */
+  int pipefd2[2];
+  guint wake_source;
+
+  /** Prefix index over #cmd_list, built on first use. */
+  RofiPrefixIndex *prefix_index;
 
   /** Current mode. */
   gboolean file_complete;
@@ -170,66 +190,259 @@ static int sort_func(const void *a, const void *b, G_GNUC_UNUSED void *data) {
   return g_strcmp0(astr->entry, bstr->entry);
 }
 
+/** Maximum number of lines the reading thread collects before it pushes them
+ * to the UI thread. */
+#define RUN_BLOCK_LINES_SIZE 1024
+typedef struct {
+  unsigned int length;
+  char *values[RUN_BLOCK_LINES_SIZE];
+} RunBlock;
+
+static void run_block_push(RunModePrivateData *pd, RunBlock **block) {
+  if ((*block) == NULL) {
+    return;
+  }
+  g_async_queue_push(pd->async_queue, *block);
+  *block = NULL;
+  if (write(pd->pipefd2[1], "r", 1) != 1) {
+    g_warning("Failed to wake up the UI thread: %s", g_strerror(errno));
+  }
+}
+
+static void run_block_add(RunModePrivateData *pd, RunBlock **block,
+                          const char *line, gsize len) {
+  if (len == 0) {
+    return;
+  }
+  if ((*block) == NULL) {
+    (*block) = g_malloc0(sizeof(RunBlock));
+  }
+  (*block)->values[(*block)->length++] = rofi_force_utf8(line, len);
+  if ((*block)->length == RUN_BLOCK_LINES_SIZE) {
+    run_block_push(pd, block);
+  }
+}
+
 /**
  * External spider to get list of executables.
+ *
+ * Reads the output of run-list-command in a separate thread, so entries show
+ * up while the command is still running. Lines are passed in blocks, at most
+ * every 0.1 seconds or RUN_BLOCK_LINES_SIZE lines.
  */
-static RunEntry *get_apps_external(RunEntry *retv, unsigned int *length,
-                                   unsigned int num_favorites) {
-  int fd = execute_generator(config.run_list_command);
-  if (fd >= 0) {
-    FILE *inp = fdopen(fd, "r");
-    if (inp) {
-      char *buffer = NULL;
-      size_t buffer_length = 0;
-
-      while (getline(&buffer, &buffer_length, inp) > 0) {
-        int found = 0;
-        // Filter out line-end.
-        if (buffer[strlen(buffer) - 1] == '\n') {
-          buffer[strlen(buffer) - 1] = '\0';
-        }
+static gpointer get_apps_external_thread(gpointer userdata) {
+  RunModePrivateData *pd = (RunModePrivateData *)userdata;
+  int fd = pd->generator_fd;
+  char *line = NULL;
+  gsize len = 0;
+  gsize nread = 0;
+  RunBlock *block = NULL;
+  GTimer *tim = g_timer_new();
+
+  while (TRUE) {
+    fd_set rfds;
+    // Hand over what we have every 0.1 seconds, even if it is not a full
+    // block.
+    struct timeval tv = {.tv_sec = 0, .tv_usec = 100000};
+    FD_ZERO(&rfds);
+    FD_SET(fd, &rfds);
+    FD_SET(pd->pipefd[0], &rfds);
+    int retval = select(MAX(fd, pd->pipefd[0]) + 1, &rfds, NULL, NULL, &tv);
+    if (retval == -1) {
+      if (errno == EINTR) {
+        continue;
+      }
+      g_warning("select failed, giving up.");
+      break;
+    }
+    // Any input from the UI thread is an abort.
+    if (retval > 0 && FD_ISSET(pd->pipefd[0], &rfds)) {
+      break;
+    }
+    if (retval == 0) {
+      run_block_push(pd, &block);
+      continue;
+    }
+    if ((nread + 1024) > len) {
+      len = nread + 1024;
+      line = g_realloc(line, len);
+    }
+    ssize_t readbytes = read(fd, &line[nread], 1024);
+    if (readbytes <= 0) {
+      if (readbytes < 0 && errno == EINTR) {
+        continue;
+      }
+      // Remainder without trailing newline.
+      run_block_add(pd, &block, line, nread);
+      run_block_push(pd, &block);
+      break;
+    }
+    nread += readbytes;
+    gsize start = 0;
+    for (gsize i = nread - readbytes; i < nread; i++) {
+      if (line[i] == '\n') {
+        run_block_add(pd, &block, &line[start], i - start);
+        start = i + 1;
+      }
+    }
+    memmove(line, &line[start], nread - start);
+    nread -= start;
+    if (g_timer_elapsed(tim, NULL) >= 0.1) {
+      g_timer_start(tim);
+      run_block_push(pd, &block);
+    }
+  }
+  g_timer_destroy(tim);
+  g_free(line);
+  if (block != NULL) {
+    for (unsigned int i = 0; i < block->length; i++) {
+      g_free(block->values[i]);
+    }
+    g_free(block);
+  }
+  if (close(fd) != 0) {
+    g_warning("Failed to close stdout off executor script: '%s'",
+              g_strerror(errno));
+  }
+  return NULL;
+}
 
-        // This is a nice little penalty, but doable? time will tell.
-        // given num_favorites is max 25.
-        for (unsigned int j = 0; found == 0 && j < num_favorites; j++) {
-          if (strcasecmp(buffer, retv[j].entry) == 0) {
-            found = 1;
-          }
-        }
+static int run_block_value_cmp(const void *a, const void *b) {
+  return g_strcmp0(*(char *const *)a, *(char *const *)b);
+}
 
-        if (found == 1) {
-          continue;
-        }
+static int run_entry_find_cmp(const void *key, const void *member) {
+  return g_strcmp0((const char *)key, ((const RunEntry *)member)->entry);
+}
 
-        // No duplicate, add it.
-        retv = g_realloc(retv, ((*length) + 2) * sizeof(RunEntry));
-        retv[(*length)].entry = g_strdup(buffer);
-        retv[(*length)].icon = NULL;
-        retv[(*length)].icon_fetch_uid = 0;
-        retv[(*length)].icon_fetch_size = 0;
+/**
+ * @param pd The run mode private data.
+ * @param block Block of lines from run-list-command.
+ *
+ * Merge the lines into the sorted part of the list, skipping duplicates and
+ * favorites. Takes ownership of the strings.
+ *
+ * @returns TRUE if entries where added.
+ */
+static gboolean run_mode_merge_block(RunModePrivateData *pd, RunBlock *block) {
+  RunEntry *tail = &(pd->cmd_list[pd->num_favorites]);
+  unsigned int tail_length = pd->cmd_list_length - pd->num_favorites;
+  unsigned int n = 0;
+
+  qsort(block->values, block->length, sizeof(char *), run_block_value_cmp);
+  for (unsigned int i = 0; i < block->length; i++) {
+    char *value = block->values[i];
+    gboolean found = (n > 0 && g_strcmp0(block->values[n - 1], value) == 0);
+    // given num_favorites is max 25.
+    for (unsigned int j = 0; !found && j < pd->num_favorites; j++) {
+      found = (strcasecmp(value, pd->cmd_list[j].entry) == 0);
+    }
+    if (!found && tail_length > 0) {
+      found = bsearch(value, tail, tail_length, sizeof(RunEntry),
+                      run_entry_find_cmp) != NULL;
+    }
+    if (found) {
+      g_free(value);
+    } else {
+      block->values[n++] = value;
+    }
+  }
+  if (n == 0) {
+    return FALSE;
+  }
 
-        (*length)++;
-      }
-      if (buffer != NULL) {
-        free(buffer);
-      }
-      if (fclose(inp) != 0) {
-        g_warning("Failed to close stdout off executor script: '%s'",
-                  g_strerror(errno));
-      }
+  // Keep a terminating empty entry, like get_apps does.
+  RunEntry *list = g_malloc0_n(pd->cmd_list_length + n + 1, sizeof(RunEntry));
+  if (pd->num_favorites > 0) {
+    memcpy(list, pd->cmd_list, pd->num_favorites * sizeof(RunEntry));
+  }
+  unsigned int ti = 0, bi = 0, index = pd->num_favorites;
+  while (ti < tail_length || bi < n) {
+    if (bi == n || (ti < tail_length &&
+                    g_strcmp0(tail[ti].entry, block->values[bi]) < 0)) {
+      list[index++] = tail[ti++];
+    } else {
+      list[index++].entry = block->values[bi++];
     }
   }
-  retv[(*length)].entry = NULL;
-  retv[(*length)].icon = NULL;
-  retv[(*length)].icon_fetch_uid = 0;
-  retv[(*length)].icon_fetch_size = 0;
-  return retv;
+  g_free(pd->cmd_list);
+  pd->cmd_list = list;
+  pd->cmd_list_length += n;
+  return TRUE;
+}
+
+/**
+ * Runs on the UI thread when the reading thread handed over lines.
+ */
+static gboolean run_mode_async_read_proc(gint fd, GIOCondition condition,
+                                         gpointer user_data) {
+  RunModePrivateData *pd = (RunModePrivateData *)user_data;
+  char command;
+  if ((condition & G_IO_IN) != G_IO_IN) {
+    return G_SOURCE_CONTINUE;
+  }
+  if (read(fd, &command, 1) == 1 && command == 'r') {
+    gboolean changed = FALSE;
+    RunBlock *block = NULL;
+    while ((block = g_async_queue_try_pop(pd->async_queue)) != NULL) {
+      changed |= run_mode_merge_block(pd, block);
+      g_free(block);
+    }
+    if (changed && !pd->file_complete) {
+      rofi_view_data_changed();
+    }
+  }
+  return G_SOURCE_CONTINUE;
+}
+
+static void run_mode_start_external(RunModePrivateData *pd) {
+  pd->generator_fd = execute_generator(config.run_list_command);
+  if (pd->generator_fd < 0) {
+    return;
+  }
+  if (pipe(pd->pipefd) == -1 || pipe(pd->pipefd2) == -1) {
+    g_error("Failed to create pipe");
+  }
+  pd->wake_source =
+      g_unix_fd_add(pd->pipefd2[0], G_IO_IN, run_mode_async_read_proc, pd);
+  pd->async_queue = g_async_queue_new();
+  pd->reading_thread =
+      g_thread_new("run-read", (GThreadFunc)get_apps_external_thread, pd);
+}
+
+static void run_mode_stop_external(RunModePrivateData *pd) {
+  if (pd->reading_thread == NULL) {
+    return;
+  }
+  if (pd->wake_source > 0) {
+    g_source_remove(pd->wake_source);
+    pd->wake_source = 0;
+  }
+  // Signal stop.
+  if (write(pd->pipefd[1], "q", 1) != 1) {
+    g_warning("Failed to stop the reading thread: %s", g_strerror(errno));
+  }
+  g_thread_join(pd->reading_thread);
+  pd->reading_thread = NULL;
+  RunBlock *block = NULL;
+  while ((block = g_async_queue_try_pop(pd->async_queue)) != NULL) {
+    for (unsigned int i = 0; i < block->length; i++) {
+      g_free(block->values[i]);
+    }
+    g_free(block);
+  }
+  g_async_queue_unref(pd->async_queue);
+  pd->async_queue = NULL;
+  close(pd->pipefd[0]);
+  close(pd->pipefd[1]);
+  close(pd->pipefd2[0]);
+  close(pd->pipefd2[1]);
 }
 
 /**
  * Internal spider used to get list of executables.
  */
-static RunEntry *get_apps(unsigned int *length) {
+static RunEntry *get_apps(unsigned int *length, unsigned int *favorites) {
   GError *error = NULL;
   RunEntry *retv = NULL;
   unsigned int num_favorites = 0;
@@ -345,11 +558,8 @@ static RunEntry *get_apps(unsigned int *length) {
     }
   }
   g_free(homedir);
+  *favorites = num_favorites;
 
-  // Get external apps.
-  if (config.run_list_command != NULL && config.run_list_command[0] != '\0') {
-    retv = get_apps_external(retv, length, num_favorites);
-  }
   // No sorting needed.
   if ((*length) == 0) {
     return retv;
@@ -385,7 +595,13 @@ static int run_mode_init(Mode *sw) {
   if (sw->private_data == NULL) {
     RunModePrivateData *pd = g_malloc0(sizeof(*pd));
     sw->private_data = (void *)pd;
-    pd->cmd_list = get_apps(&(pd->cmd_list_length));
+    // Start the external command first, its output is merged in as it comes
+    // while $PATH is scanned.
+    if (config.run_list_command != NULL &&
+        config.run_list_command[0] != '\0') {
+      run_mode_start_external(pd);
+    }
+    pd->cmd_list = get_apps(&(pd->cmd_list_length), &(pd->num_favorites));
     pd->completer = NULL;
   }
 
@@ -394,6 +610,7 @@ static int run_mode_init(Mode *sw) {
 static void run_mode_destroy(Mode *sw) {
   RunModePrivateData *rmpd = (RunModePrivateData *)sw->private_data;
   if (rmpd != NULL) {
+    run_mode_stop_external(rmpd);
     for (unsigned int i = 0; i < rmpd->cmd_list_length; i++) {
       g_free(rmpd->cmd_list[i].entry);
       if (rmpd->cmd_list[i].icon != NULL) {
@@ -401,6 +618,7 @@ static void run_mode_destroy(Mode *sw) {
       }
     }
     g_free(rmpd->cmd_list);
+    rofi_prefix_index_free(rmpd->prefix_index);
     g_free(rmpd->old_input);
     g_free(rmpd->old_completer_input);
     if (rmpd->completer != NULL) {
@@ -520,6 +738,24 @@ static int run_token_match(const Mode *sw, rofi_int_matcher **tokens,
   }
   return helper_token_match(tokens, rmpd->cmd_list[index].entry);
 }
+static RofiPrefixIndex *run_get_prefix_index(Mode *sw) {
+  RunModePrivateData *rmpd = (RunModePrivateData *)sw->private_data;
+  if (rmpd->file_complete) {
+    return NULL;
+  }
+  // Merged blocks are sorted in, so any change invalidates the index.
+  if (rmpd->prefix_index == NULL ||
+      rofi_prefix_index_get_length(rmpd->prefix_index) !=
+          rmpd->cmd_list_length) {
+    rofi_prefix_index_free(rmpd->prefix_index);
+    rmpd->prefix_index = rofi_prefix_index_new();
+    for (unsigned int i = 0; i < rmpd->cmd_list_length; i++) {
+      rofi_prefix_index_add(rmpd->prefix_index, i, rmpd->cmd_list[i].entry);
+    }
+    rofi_prefix_index_build(rmpd->prefix_index, rmpd->cmd_list_length);
+  }
+  return rmpd->prefix_index;
+}
 static char *run_get_message(const Mode *sw) {
   RunModePrivateData *pd = sw->private_data;
   if (pd->file_complete) {
@@ -541,7 +777,7 @@ static char *run_get_message(const Mode *sw) {
 static cairo_surface_t *_get_icon(const Mode *sw, unsigned int selected_line,
                                   unsigned int height) {
   RunModePrivateData *pd = (RunModePrivateData *)mode_get_private_data(sw);
-  const guint scale = display_scale();
+  const double scale = display_scale();
   if (pd->file_complete) {
     return pd->completer->_get_icon(pd->completer, selected_line, height);
   }
@@ -566,6 +802,24 @@ static cairo_surface_t *_get_icon(const Mode *sw, unsigned int selected_line,
   return NULL;
 }
 
+static char *run_get_icon_name(const Mode *sw, unsigned int selected_line) {
+  RunModePrivateData *pd = (RunModePrivateData *)mode_get_private_data(sw);
+  if (pd->file_complete || selected_line >= pd->cmd_list_length) {
+    return NULL;
+  }
+  // Same as the lookup in _get_icon.
+  const char *entry = pd->cmd_list[selected_line].entry;
+  return g_strndup(entry, strcspn(entry, " "));
+}
+
+static char *run_get_identity(const Mode *sw, unsigned int selected_line) {
+  RunModePrivateData *pd = (RunModePrivateData *)mode_get_private_data(sw);
+  if (pd->file_complete || selected_line >= pd->cmd_list_length) {
+    return NULL;
+  }
+  return g_strdup(pd->cmd_list[selected_line].entry);
+}
+
 #include "mode-private.h"
 Mode run_mode = {.name = "run",
                  .cfg_name_key = "display-run",
@@ -581,5 +835,8 @@ Mode run_mode = {.name = "run",
                  ._preprocess_input = NULL,
                  .private_data = NULL,
                  .free = NULL,
-                 .type = MODE_TYPE_SWITCHER};
+                 .type = MODE_TYPE_SWITCHER,
+                 ._get_prefix_index = run_get_prefix_index,
+                 ._get_icon_name = run_get_icon_name,
+                 ._get_identity = run_get_identity};
 /** @}*/
@@ -69,6 +69,8 @@ typedef struct _WaylandWindowModePrivateData {
   int match_fields; /* bitmask of WaylandWindowMatchingFields */
   glong title_len;
   glong app_id_len;
+  /* bumped whenever the column widths change, invalidates display strings */
+  unsigned int display_generation;
   GRegex *window_regex;
 } WaylandWindowModePrivateData;
 
@@ -94,9 +96,17 @@ typedef struct {
   glong title_len;
   int state;
 
+  /* lengths this toplevel contributes to the column widths */
+  glong counted_app_id_len;
+  glong counted_title_len;
+
+  /* formatted row, valid while display_generation matches the view */
+  gchar *cached_display;
+  unsigned int cached_display_generation;
+
   unsigned int cached_icon_uid;
   unsigned int cached_icon_size;
-  guint cached_icon_scale;
+  double cached_icon_scale;
 } ForeignToplevelHandle;
 
 static void foreign_toplevel_handle_free(ForeignToplevelHandle *self) {
@@ -107,6 +117,7 @@ static void foreign_toplevel_handle_free(ForeignToplevelHandle *self) {
   }
   g_free(self->title);
   g_free(self->app_id);
+  g_free(self->cached_display);
   g_free(self);
 }
 
@@ -114,23 +125,60 @@ static void toplevels_list_update_max_len(gpointer data, gpointer user_data) {
   WaylandWindowModePrivateData *pd = (WaylandWindowModePrivateData *)user_data;
   ForeignToplevelHandle *entry = (ForeignToplevelHandle *)data;
 
-  pd->title_len = MAX(entry->title_len, pd->title_len);
-  pd->app_id_len = MAX(entry->app_id_len, pd->app_id_len);
+  pd->title_len = MAX(entry->counted_title_len, pd->title_len);
+  pd->app_id_len = MAX(entry->counted_app_id_len, pd->app_id_len);
+}
+
+/**
+ * Move one contribution to a column width from old_len to new_len.
+ *
+ * @returns TRUE if the column may have shrunk and needs a full recount.
+ */
+static gboolean toplevels_max_len_replace(glong *max_len, glong old_len,
+                                          glong new_len) {
+  if (new_len >= *max_len) {
+    *max_len = new_len;
+    return FALSE;
+  }
+  return old_len == *max_len;
 }
 
 /* Update column alignment and schedule reload */
 static void wayland_window_update_toplevel(ForeignToplevelHandle *toplevel) {
   WaylandWindowModePrivateData *pd = toplevel->view;
+  glong title_len = toplevel->title_len;
+  glong app_id_len = toplevel->app_id_len;
+  glong old_title_max = pd->title_len;
+  glong old_app_id_max = pd->app_id_len;
+
+  if (toplevel->state & TOPLEVEL_STATE_CLOSED) {
+    /* already unlinked, withdraw its contribution */
+    title_len = 0;
+    app_id_len = 0;
+  }
 
-  if (!pd->visible) {
-    /* initial fetch, just add the current item */
-    toplevels_list_update_max_len(toplevel, pd);
-  } else {
-    /* async update, recalculate from scratch */
+  gboolean recount = toplevels_max_len_replace(
+      &pd->title_len, toplevel->counted_title_len, title_len);
+  recount |= toplevels_max_len_replace(
+      &pd->app_id_len, toplevel->counted_app_id_len, app_id_len);
+  toplevel->counted_title_len = title_len;
+  toplevel->counted_app_id_len = app_id_len;
+
+  if (recount) {
+    /* the widest entry shrunk or left, the only case needing a full walk */
     pd->title_len = 0;
     pd->app_id_len = 0;
     g_list_foreach(pd->toplevels, toplevels_list_update_max_len, pd);
-    rofi_view_reload();
+  }
+  if (pd->title_len != old_title_max || pd->app_id_len != old_app_id_max) {
+    /* padding changed, every cached row is stale */
+    pd->display_generation++;
+  }
+  g_free(toplevel->cached_display);
+  toplevel->cached_display = NULL;
+
+  if (pd->visible) {
+    rofi_view_data_changed();
   }
 }
 
@@ -570,14 +618,23 @@ static char *_get_display_value(const Mode *sw, unsigned int selected_line,
   }
   *state |= MARKUP;
 
-  return get_entry ? _generate_display_string(pd, toplevel) : NULL;
+  if (!get_entry) {
+    return NULL;
+  }
+  if (toplevel->cached_display == NULL ||
+      toplevel->cached_display_generation != pd->display_generation) {
+    g_free(toplevel->cached_display);
+    toplevel->cached_display = _generate_display_string(pd, toplevel);
+    toplevel->cached_display_generation = pd->display_generation;
+  }
+  return g_strdup(toplevel->cached_display);
 }
 
 static cairo_surface_t *_get_icon(const Mode *sw, unsigned int selected_line,
                                   unsigned int height) {
   WaylandWindowModePrivateData *pd =
       (WaylandWindowModePrivateData *)mode_get_private_data(sw);
-  const guint scale = display_scale();
+  const double scale = display_scale();
 
   g_return_val_if_fail(pd != NULL, NULL);
 
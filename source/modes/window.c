@@ -113,6 +113,11 @@ typedef struct {
   char *class;
   char *name;
   char *role;
+  // Lengths in characters, computed once when the client is cached.
+  unsigned int title_len;
+  unsigned int class_len;
+  unsigned int name_len;
+  unsigned int role_len;
   int states;
   xcb_atom_t state[CLIENTSTATE];
   int window_types;
@@ -127,7 +132,7 @@ typedef struct {
   gboolean icon_checked;
   uint32_t icon_fetch_uid;
   uint32_t icon_fetch_size;
-  guint icon_fetch_scale;
+  double icon_fetch_scale;
   gboolean thumbnail_checked;
   gboolean icon_theme_checked;
 } client;
@@ -150,6 +155,8 @@ typedef struct {
   unsigned int name_len;
   unsigned int title_len;
   unsigned int role_len;
+  // Formatted rows, indexed like ids. Column widths are fixed once loaded.
+  char **display_cache;
   GRegex *window_regex;
   // Hide current active window
   gboolean hide_active_window;
@@ -363,13 +370,14 @@ static client *window_client(WindowModePrivateData *pd, xcb_window_t win) {
   } else {
     c->title = g_strdup("<i>no title set</i>");
   }
-  pd->title_len =
-      MAX(c->title ? g_utf8_strlen(c->title, -1) : 0, pd->title_len);
+  c->title_len = c->title ? g_utf8_strlen(c->title, -1) : 0;
+  pd->title_len = MAX(c->title_len, pd->title_len);
   g_free(tmp_title);
 
   char *tmp_role = window_get_text_prop(c->window, netatoms[WM_WINDOW_ROLE]);
   c->role = g_markup_escape_text(tmp_role ? tmp_role : "", -1);
-  pd->role_len = MAX(c->role ? g_utf8_strlen(c->role, -1) : 0, pd->role_len);
+  c->role_len = c->role ? g_utf8_strlen(c->role, -1) : 0;
+  pd->role_len = MAX(c->role_len, pd->role_len);
   g_free(tmp_role);
 
   cky = xcb_icccm_get_wm_class(xcb->connection, c->window);
@@ -377,7 +385,9 @@ static client *window_client(WindowModePrivateData *pd, xcb_window_t win) {
   if (xcb_icccm_get_wm_class_reply(xcb->connection, cky, &wcr, NULL)) {
     c->class = g_markup_escape_text(wcr.class_name, -1);
     c->name = g_markup_escape_text(wcr.instance_name, -1);
-    pd->name_len = MAX(c->name ? g_utf8_strlen(c->name, -1) : 0, pd->name_len);
+    c->class_len = c->class ? g_utf8_strlen(c->class, -1) : 0;
+    c->name_len = c->name ? g_utf8_strlen(c->name, -1) : 0;
+    pd->name_len = MAX(c->name_len, pd->name_len);
     xcb_icccm_get_wm_class_reply_wipe(&wcr);
   }
 
@@ -405,7 +415,7 @@ static gboolean window_client_reload(G_GNUC_UNUSED void *data) {
     window_mode_cd._init(&window_mode_cd);
   }
   if (window_mode.private_data || window_mode_cd.private_data) {
-    rofi_view_reload();
+    rofi_view_data_changed();
   }
   return G_SOURCE_REMOVE;
 }
@@ -604,10 +614,7 @@ static void _window_mode_load_data(Mode *sw, unsigned int cd) {
                                   xcb->ewmh._NET_WM_WINDOW_TYPE_DESKTOP) &&
           !client_has_state(winclient, xcb->ewmh._NET_WM_STATE_SKIP_PAGER) &&
           !client_has_state(winclient, xcb->ewmh._NET_WM_STATE_SKIP_TASKBAR)) {
-        pd->clf_len =
-            MAX(pd->clf_len, (winclient->class != NULL)
-                                 ? (g_utf8_strlen(winclient->class, -1))
-                                 : 0);
+        pd->clf_len = MAX(pd->clf_len, winclient->class_len);
 
         if (client_has_state(winclient,
                              xcb->ewmh._NET_WM_STATE_DEMANDS_ATTENTION)) {
@@ -689,6 +696,7 @@ static void _window_mode_load_data(Mode *sw, unsigned int cd) {
     if (has_names) {
       g_free(ws_names);
     }
+    pd->display_cache = g_malloc0_n(pd->ids->len, sizeof(char *));
   }
   xcb_ewmh_get_windows_reply_wipe(&clients);
 }
@@ -860,6 +868,12 @@ static void window_mode_destroy(Mode *sw) {
   WindowModePrivateData *rmpd =
       (WindowModePrivateData *)mode_get_private_data(sw);
   if (rmpd != NULL) {
+    if (rmpd->display_cache != NULL) {
+      for (int i = 0; i < rmpd->ids->len; i++) {
+        g_free(rmpd->display_cache[i]);
+      }
+      g_free(rmpd->display_cache);
+    }
     winlist_free(rmpd->ids);
     x11_cache_free();
     g_free(rmpd->cache);
@@ -917,16 +931,16 @@ static gboolean helper_eval_cb(const GMatchInfo *info, GString *str,
                           d->c->wmdesktopstr_len);
     } else if (match[1] == 'c') {
       helper_eval_add_str(str, d->c->class, l, d->pd->clf_len,
-                          g_utf8_strlen(d->c->class, -1));
+                          d->c->class_len);
     } else if (match[1] == 't') {
       helper_eval_add_str(str, d->c->title, l, d->pd->title_len,
-                          g_utf8_strlen(d->c->title, -1));
+                          d->c->title_len);
     } else if (match[1] == 'n') {
       helper_eval_add_str(str, d->c->name, l, d->pd->name_len,
-                          g_utf8_strlen(d->c->name, -1));
+                          d->c->name_len);
     } else if (match[1] == 'r') {
       helper_eval_add_str(str, d->c->role, l, d->pd->role_len,
-                          g_utf8_strlen(d->c->role, -1));
+                          d->c->role_len);
     }
 
     g_free(match);
@@ -956,7 +970,15 @@ static char *_get_display_value(const Mode *sw, unsigned int selected_line,
     *state |= ACTIVE;
   }
   *state |= MARKUP;
-  return get_entry ? _generate_display_string(rmpd, c) : NULL;
+  if (!get_entry) {
+    return NULL;
+  }
+  // The list is rebuilt from scratch on any client change, so entries stay
+  // valid for the lifetime of this private data.
+  if (rmpd->display_cache[selected_line] == NULL) {
+    rmpd->display_cache[selected_line] = _generate_display_string(rmpd, c);
+  }
+  return g_strdup(rmpd->display_cache[selected_line]);
 }
 
 /**
@@ -1068,7 +1090,7 @@ static cairo_surface_t *get_net_wm_icon(xcb_window_t xid,
 static cairo_surface_t *_get_icon(const Mode *sw, unsigned int selected_line,
                                   unsigned int size) {
   WindowModePrivateData *rmpd = mode_get_private_data(sw);
-  const guint scale = display_scale();
+  const double scale = display_scale();
   client *c = window_client(rmpd, rmpd->ids->array[selected_line]);
   if (c == NULL) {
     return NULL;
@@ -30,9 +30,11 @@
 
 #include "config.h"
 #include <stdlib.h>
+#include <math.h>
 
 #include "helper.h"
 #include "rofi-icon-fetcher.h"
+#include "rofi.h"
 #include "rofi-types.h"
 #include "settings.h"
 #include <cairo.h>
@@ -42,18 +44,24 @@
 #include "keyb.h"
 #include "view.h"
 
-#include "nkutils-enum.h"
-#include "nkutils-xdg-theme.h"
+#include "rofi-icon-theme-index.h"
 
+#include <fcntl.h>
 #include <stdint.h>
+#include <unistd.h>
 
 #include "helper.h"
 #include <gdk-pixbuf/gdk-pixbuf.h>
+#include <glib/gstdio.h>
 
 typedef struct {
-  // Context for icon-themes.
-  NkXdgThemeContext *xdg_context;
+  // Index of the icon-themes, built on first use.
+  RofiIconThemeIndex *theme_index;
+  GMutex theme_index_lock;
 
+  // Guards the caches and last_uid, icons are queried while drawing rows on
+  // worker threads.
+  GMutex cache_lock;
   // On name.
   GHashTable *icon_cache;
   // On uid.
@@ -79,7 +87,7 @@ typedef struct {
   uint32_t uid;
   int wsize;
   int hsize;
-  guint scale;
+  double scale;
   cairo_surface_t *surface;
   gboolean query_done;
 
@@ -112,14 +120,9 @@ static void rofi_icon_fetch_entry_free(gpointer data) {
 void rofi_icon_fetcher_init(void) {
   g_assert(rofi_icon_fetcher_data == NULL);
 
-  static const gchar *const icon_fallback_themes[] = {"Adwaita", "gnome", NULL};
-  const char *themes[2] = {config.icon_theme, NULL};
-
   rofi_icon_fetcher_data = g_malloc0(sizeof(IconFetcher));
-
-  rofi_icon_fetcher_data->xdg_context =
-      nk_xdg_theme_context_new(icon_fallback_themes, NULL);
-  nk_xdg_theme_preload_themes_icon(rofi_icon_fetcher_data->xdg_context, themes);
+  g_mutex_init(&(rofi_icon_fetcher_data->theme_index_lock));
+  g_mutex_init(&(rofi_icon_fetcher_data->cache_lock));
 
   rofi_icon_fetcher_data->icon_cache_uid =
       g_hash_table_new(g_direct_hash, g_direct_equal);
@@ -152,7 +155,9 @@ void rofi_icon_fetcher_destroy(void) {
     return;
   }
 
-  nk_xdg_theme_context_free(rofi_icon_fetcher_data->xdg_context);
+  rofi_icon_theme_index_free(rofi_icon_fetcher_data->theme_index);
+  g_mutex_clear(&(rofi_icon_fetcher_data->theme_index_lock));
+  g_mutex_clear(&(rofi_icon_fetcher_data->cache_lock));
 
   g_hash_table_unref(rofi_icon_fetcher_data->icon_cache_uid);
   g_hash_table_unref(rofi_icon_fetcher_data->icon_cache);
@@ -282,13 +287,172 @@ gboolean rofi_icon_fetcher_file_is_image(const char *const path) {
   return FALSE;
 }
 
+/**
+ * Directories of the XDG thumbnail cache, smallest first.
+ */
+static const struct {
+  const char *dir;
+  int size;
+} rofi_icon_fetcher_thumbnail_sizes[] = {
+    {"normal", 128},
+    {"large", 256},
+};
+
+/**
+ * Create a thumbnail of path and store it in the thumbnail cache, as
+ * described by the freedesktop thumbnail managing standard.
+ *
+ * @returns the thumbnail, or NULL if the image is smaller than the thumbnail
+ * (so it is cheap to load directly) or could not be loaded.
+ */
+static GdkPixbuf *rofi_icon_fetcher_create_thumbnail(
+    const char *path, const char *uri, const char *mtime, int tsize,
+    const char *thumb_dir, const char *thumb_path) {
+  int iw = 0, ih = 0;
+  if (gdk_pixbuf_get_file_info(path, &iw, &ih) == NULL) {
+    return NULL;
+  }
+  if (iw <= tsize && ih <= tsize) {
+    return NULL;
+  }
+  GdkPixbuf *pb = gdk_pixbuf_new_from_file_at_scale(path, tsize, tsize, TRUE,
+                                                    NULL);
+  if (pb == NULL) {
+    return NULL;
+  }
+  if (g_mkdir_with_parents(thumb_dir, 0700) != 0) {
+    return pb;
+  }
+  // Write to a temporary file and rename, so readers never see partial files.
+  char *tmp_path = g_strconcat(thumb_path, ".XXXXXX", NULL);
+  int fd = g_mkstemp_full(tmp_path, O_RDWR, 0600);
+  if (fd >= 0) {
+    close(fd);
+    char *width = g_strdup_printf("%d", iw);
+    char *height = g_strdup_printf("%d", ih);
+    if (gdk_pixbuf_save(pb, tmp_path, "png", NULL, "tEXt::Thumb::URI", uri,
+                        "tEXt::Thumb::MTime", mtime,
+                        "tEXt::Thumb::Image::Width", width,
+                        "tEXt::Thumb::Image::Height", height,
+                        "tEXt::Software", "rofi", NULL) == FALSE ||
+        g_rename(tmp_path, thumb_path) != 0) {
+      g_unlink(tmp_path);
+    }
+    g_free(width);
+    g_free(height);
+  }
+  g_free(tmp_path);
+  return pb;
+}
+
+/**
+ * @param path Absolute path of an image file.
+ * @param width The requested width in pixels.
+ * @param height The requested height in pixels.
+ *
+ * Load the image from the XDG thumbnail cache, creating the thumbnail if
+ * it is missing or outdated, so large images are only decoded once.
+ *
+ * @returns the image scaled to fit width x height, or NULL if the original
+ * should be loaded instead.
+ */
+static GdkPixbuf *rofi_icon_fetcher_get_thumbnail(const char *path, int width,
+                                                  int height) {
+  int size = MAX(width, height);
+  const char *dir = NULL;
+  int tsize = 0;
+  for (gsize i = 0; i < G_N_ELEMENTS(rofi_icon_fetcher_thumbnail_sizes);
+       i++) {
+    if (size <= rofi_icon_fetcher_thumbnail_sizes[i].size) {
+      dir = rofi_icon_fetcher_thumbnail_sizes[i].dir;
+      tsize = rofi_icon_fetcher_thumbnail_sizes[i].size;
+      break;
+    }
+  }
+  GStatBuf st;
+  if (dir == NULL || g_stat(path, &st) != 0) {
+    return NULL;
+  }
+  char *thumb_root =
+      g_build_filename(g_get_user_cache_dir(), "thumbnails", NULL);
+  // Never thumbnail thumbnails.
+  if (g_str_has_prefix(path, thumb_root)) {
+    g_free(thumb_root);
+    return NULL;
+  }
+  char *uri = g_filename_to_uri(path, NULL, NULL);
+  if (uri == NULL) {
+    g_free(thumb_root);
+    return NULL;
+  }
+  char *md5 = g_compute_checksum_for_string(G_CHECKSUM_MD5, uri, -1);
+  char *thumb_name = g_strconcat(md5, ".png", NULL);
+  char *thumb_dir = g_build_filename(thumb_root, dir, NULL);
+  char *thumb_path = g_build_filename(thumb_dir, thumb_name, NULL);
+  char *mtime = g_strdup_printf("%" G_GINT64_FORMAT, (gint64)st.st_mtime);
+
+  GdkPixbuf *thumb = gdk_pixbuf_new_from_file(thumb_path, NULL);
+  if (thumb != NULL) {
+    const char *turi = gdk_pixbuf_get_option(thumb, "tEXt::Thumb::URI");
+    const char *tmtime = gdk_pixbuf_get_option(thumb, "tEXt::Thumb::MTime");
+    if (g_strcmp0(turi, uri) != 0 || g_strcmp0(tmtime, mtime) != 0) {
+      g_object_unref(thumb);
+      thumb = NULL;
+    }
+  }
+  if (thumb == NULL) {
+    thumb = rofi_icon_fetcher_create_thumbnail(path, uri, mtime, tsize,
+                                               thumb_dir, thumb_path);
+  }
+  g_free(mtime);
+  g_free(thumb_path);
+  g_free(thumb_dir);
+  g_free(thumb_name);
+  g_free(md5);
+  g_free(uri);
+  g_free(thumb_root);
+  if (thumb == NULL) {
+    return NULL;
+  }
+
+  // Fit the requested size, keeping the aspect ratio.
+  int tw = gdk_pixbuf_get_width(thumb);
+  int th = gdk_pixbuf_get_height(thumb);
+  double scale = MIN(width / (double)tw, height / (double)th);
+  int sw = MAX(1, (int)(tw * scale + 0.5));
+  int sh = MAX(1, (int)(th * scale + 0.5));
+  if (sw == tw && sh == th) {
+    return thumb;
+  }
+  GdkPixbuf *pb = gdk_pixbuf_scale_simple(thumb, sw, sh, GDK_INTERP_BILINEAR);
+  g_object_unref(thumb);
+  return pb;
+}
+
+/**
+ * Loading the themes reads the icon-theme.cache files, or scans the themes
+ * that have none, so it is done by the first worker that needs it instead of
+ * at startup.
+ */
+static const RofiIconThemeIndex *rofi_icon_fetcher_get_theme_index(void) {
+  g_mutex_lock(&(rofi_icon_fetcher_data->theme_index_lock));
+  if (rofi_icon_fetcher_data->theme_index == NULL) {
+    const char *themes[] = {config.icon_theme, "Adwaita", "gnome", NULL};
+    // Skip the user theme when not set.
+    const char *const *list = config.icon_theme ? themes : themes + 1;
+    rofi_icon_fetcher_data->theme_index =
+        rofi_icon_theme_index_new(list, cache_dir);
+  }
+  g_mutex_unlock(&(rofi_icon_fetcher_data->theme_index_lock));
+  return rofi_icon_fetcher_data->theme_index;
+}
+
 static void rofi_icon_fetcher_worker(thread_state *sdata,
                                      G_GNUC_UNUSED gpointer user_data) {
   g_debug("starting up icon fetching thread.");
   // as long as dr->icon is updated atomicly.. (is a pointer write atomic?)
   // this should be fine running in another thread.
   IconFetcherEntry *sentry = (IconFetcherEntry *)sdata;
-  const gchar *themes[] = {config.icon_theme, NULL};
 
   const gchar *icon_path;
   gchar *icon_path_ = NULL;
@@ -323,9 +487,17 @@ static void rofi_icon_fetcher_worker(thread_state *sdata,
     return;
 
   } else {
-    icon_path = icon_path_ = nk_xdg_theme_get_icon(
-        rofi_icon_fetcher_data->xdg_context, themes, NULL, sentry->entry->name,
-        MIN(sentry->wsize, sentry->hsize), sentry->scale, TRUE);
+    // Fractional scales look up the icon at its pixel size, the next integer
+    // scale would pick an oversized one.
+    int lookup_size = MIN(sentry->wsize, sentry->hsize);
+    int lookup_scale = (int)sentry->scale;
+    if (sentry->scale != lookup_scale) {
+      lookup_size = (int)ceil(lookup_size * sentry->scale);
+      lookup_scale = 1;
+    }
+    icon_path = icon_path_ = rofi_icon_theme_index_lookup(
+        rofi_icon_fetcher_get_theme_index(), sentry->entry->name, lookup_size,
+        lookup_scale);
     if (icon_path_ == NULL) {
       g_debug("failed to get icon %s(%dx%d): n/a", sentry->entry->name,
               sentry->wsize, sentry->hsize);
@@ -358,13 +530,20 @@ static void rofi_icon_fetcher_worker(thread_state *sdata,
 
   int width = sentry->wsize, height = sentry->hsize;
   if (width > 0)
-    width *= sentry->scale;
+    width = (int)ceil(width * sentry->scale);
   if (height > 0)
-    height *= sentry->scale;
+    height = (int)ceil(height * sentry->scale);
 
   GError *error = NULL;
-  GdkPixbuf *pb =
-      gdk_pixbuf_new_from_file_at_scale(icon_path, width, height, TRUE, &error);
+  GdkPixbuf *pb = NULL;
+  if (icon_path == sentry->entry->name && width > 0 && height > 0 &&
+      rofi_icon_fetcher_file_is_image(icon_path)) {
+    pb = rofi_icon_fetcher_get_thumbnail(icon_path, width, height);
+  }
+  if (pb == NULL) {
+    pb = gdk_pixbuf_new_from_file_at_scale(icon_path, width, height, TRUE,
+                                           &error);
+  }
   if (error != NULL) {
     g_warning("Failed to load image: %s", error->message);
     g_error_free(error);
@@ -382,9 +561,10 @@ static void rofi_icon_fetcher_worker(thread_state *sdata,
   rofi_view_reload();
 }
 
-uint32_t rofi_icon_fetcher_query_advanced(const char *name, const int wsize,
-                                          const int hsize) {
-  g_debug("Query: %s(%dx%d)", name, wsize, hsize);
+/** Called with the cache lock held. */
+static uint32_t rofi_icon_fetcher_query_locked(const char *name,
+                                               const int wsize,
+                                               const int hsize) {
   IconFetcherNameEntry *entry =
       g_hash_table_lookup(rofi_icon_fetcher_data->icon_cache, name);
   if (entry == NULL) {
@@ -393,7 +573,7 @@ uint32_t rofi_icon_fetcher_query_advanced(const char *name, const int wsize,
     g_hash_table_insert(rofi_icon_fetcher_data->icon_cache, entry->name, entry);
   }
   IconFetcherEntry *sentry;
-  const guint scale = display_scale();
+  const double scale = display_scale();
   for (GList *iter = g_list_first(entry->sizes); iter;
        iter = g_list_next(iter)) {
     sentry = iter->data;
@@ -423,49 +603,29 @@ uint32_t rofi_icon_fetcher_query_advanced(const char *name, const int wsize,
 
   return sentry->uid;
 }
-uint32_t rofi_icon_fetcher_query(const char *name, const int size) {
-  g_debug("Query: %s(%d)", name, size);
-  IconFetcherNameEntry *entry =
-      g_hash_table_lookup(rofi_icon_fetcher_data->icon_cache, name);
-  if (entry == NULL) {
-    entry = g_new0(IconFetcherNameEntry, 1);
-    entry->name = g_strdup(name);
-    g_hash_table_insert(rofi_icon_fetcher_data->icon_cache, entry->name, entry);
-  }
-  IconFetcherEntry *sentry;
-  const guint scale = display_scale();
-  for (GList *iter = g_list_first(entry->sizes); iter;
-       iter = g_list_next(iter)) {
-    sentry = iter->data;
-    if (sentry->wsize == size && sentry->hsize == size &&
-        sentry->scale == scale) {
-      return sentry->uid;
-    }
-  }
-
-  // Not found.
-  sentry = g_new0(IconFetcherEntry, 1);
-  sentry->uid = ++(rofi_icon_fetcher_data->last_uid);
-  sentry->wsize = size;
-  sentry->hsize = size;
-  sentry->scale = scale;
-  sentry->entry = entry;
-  sentry->surface = NULL;
-
-  entry->sizes = g_list_prepend(entry->sizes, sentry);
-  g_hash_table_insert(rofi_icon_fetcher_data->icon_cache_uid,
-                      GINT_TO_POINTER(sentry->uid), sentry);
 
-  // Push into fetching queue.
-  sentry->state.callback = rofi_icon_fetcher_worker;
-  g_thread_pool_push(tpool, sentry, NULL);
+uint32_t rofi_icon_fetcher_query_advanced(const char *name, const int wsize,
+                                          const int hsize) {
+  g_debug("Query: %s(%dx%d)", name, wsize, hsize);
+  g_mutex_lock(&(rofi_icon_fetcher_data->cache_lock));
+  uint32_t uid = rofi_icon_fetcher_query_locked(name, wsize, hsize);
+  g_mutex_unlock(&(rofi_icon_fetcher_data->cache_lock));
+  return uid;
+}
 
-  return sentry->uid;
+uint32_t rofi_icon_fetcher_query(const char *name, const int size) {
+  g_debug("Query: %s(%d)", name, size);
+  g_mutex_lock(&(rofi_icon_fetcher_data->cache_lock));
+  uint32_t uid = rofi_icon_fetcher_query_locked(name, size, size);
+  g_mutex_unlock(&(rofi_icon_fetcher_data->cache_lock));
+  return uid;
 }
 
 cairo_surface_t *rofi_icon_fetcher_get(const uint32_t uid) {
+  g_mutex_lock(&(rofi_icon_fetcher_data->cache_lock));
   IconFetcherEntry *sentry = g_hash_table_lookup(
       rofi_icon_fetcher_data->icon_cache_uid, GINT_TO_POINTER(uid));
+  g_mutex_unlock(&(rofi_icon_fetcher_data->cache_lock));
   if (sentry) {
     return sentry->surface;
   }
@@ -475,8 +635,10 @@ cairo_surface_t *rofi_icon_fetcher_get(const uint32_t uid) {
 
 gboolean rofi_icon_fetcher_get_ex(const uint32_t uid,
                                   cairo_surface_t **surface) {
+  g_mutex_lock(&(rofi_icon_fetcher_data->cache_lock));
   IconFetcherEntry *sentry = g_hash_table_lookup(
       rofi_icon_fetcher_data->icon_cache_uid, GINT_TO_POINTER(uid));
+  g_mutex_unlock(&(rofi_icon_fetcher_data->cache_lock));
   *surface = NULL;
   if (sentry) {
     *surface = sentry->surface;
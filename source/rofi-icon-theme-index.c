@@ -0,0 +1,897 @@
+/*
+ * rofi
+ *
+ * MIT/X11 License
+ * Copyright © 2013-2023 Qball Cow <qball@gmpclient.org>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+/** The log domain of this Helper. */
+#define G_LOG_DOMAIN "Helpers.IconThemeIndex"
+
+#include "config.h"
+
+#include "rofi-icon-theme-index.h"
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <string.h>
+
+/**
+ * The cache uses the layout of the GTK icon-theme.cache (version 1.0), all
+ * numbers are big endian:
+ *
+ * Header:     u16 major, u16 minor, u32 hash offset, u32 directory list offset
+ * Hash:       u32 n buckets, u32 icon offset[n]
+ * Icon:       u32 next icon in chain, u32 name offset, u32 image list offset
+ * Image list: u32 n images, { u16 directory, u16 flags, u32 data offset }[n]
+ * Dir list:   u32 n directories, u32 name offset[n]
+ */
+#define ICON_CACHE_MAJOR_VERSION 1
+/** Minor version of the cache format. */
+#define ICON_CACHE_MINOR_VERSION 0
+/** Marks an empty bucket or the end of a chain. */
+#define ICON_CACHE_NONE 0xffffffffu
+/** Size of an icon record in the cache. */
+#define ICON_CACHE_ICON_SIZE 12
+
+/** Flags of an image in the cache, the values gtk-update-icon-cache uses. */
+typedef enum {
+  ICON_CACHE_HAS_SUFFIX_XPM = 1 << 0,
+  ICON_CACHE_HAS_SUFFIX_SVG = 1 << 1,
+  ICON_CACHE_HAS_SUFFIX_PNG = 1 << 2,
+  /** Only a .icon file, no image. */
+  ICON_CACHE_HAS_ICON_FILE = 1 << 3,
+  /** A .symbolic.png file, not looked up. */
+  ICON_CACHE_HAS_SUFFIX_SYMBOLIC_PNG = 1 << 4,
+} RofiIconCacheFlags;
+
+/**
+ * Version of the caches we store ourselves, part of the file name. Bump it
+ * when what is written changes.
+ */
+#define ICON_CACHE_PERSIST_VERSION 2
+
+/** Suffixes in order of preference, as in the XDG specification. */
+static const struct {
+  const char *suffix;
+  RofiIconCacheFlags flag;
+} icon_suffixes[] = {
+    {"png", ICON_CACHE_HAS_SUFFIX_PNG},
+    {"svg", ICON_CACHE_HAS_SUFFIX_SVG},
+    {"xpm", ICON_CACHE_HAS_SUFFIX_XPM},
+};
+
+/** Type of an icon theme directory. */
+typedef enum {
+  ICON_DIR_FIXED,
+  ICON_DIR_SCALABLE,
+  ICON_DIR_THRESHOLD,
+} RofiIconDirType;
+
+/** A directory of an icon theme, as described by its index.theme. */
+typedef struct {
+  char *name;
+  RofiIconDirType type;
+  int size;
+  int scale;
+  int min_size;
+  int max_size;
+  int threshold;
+} RofiIconThemeDir;
+
+/** The cache of one theme directory. */
+typedef struct {
+  /** Path of the theme directory. */
+  char *path;
+  /** Content of the cache, mapped or built in memory. */
+  GBytes *bytes;
+  const guint8 *data;
+  gsize length;
+  /** Index in RofiIconTheme::dirs for each directory in the cache or -1. */
+  int *dir_map;
+  guint32 n_dirs;
+} RofiIconCache;
+
+/** A loaded icon theme. */
+typedef struct {
+  char *name;
+  /** RofiIconThemeDir, in index.theme order. */
+  GPtrArray *dirs;
+  /** RofiIconCache, one per base directory that holds the theme. */
+  GPtrArray *caches;
+} RofiIconTheme;
+
+/** An icon outside of a theme. */
+typedef struct {
+  char *path;
+  /** Base directory it was found in. */
+  unsigned int base;
+  /** Position of the suffix in icon_suffixes. */
+  unsigned int rank;
+} RofiIconUnthemed;
+
+struct _RofiIconThemeIndex {
+  /** RofiIconTheme, in lookup order. */
+  GPtrArray *themes;
+  /** Name to RofiIconUnthemed. */
+  GHashTable *unthemed;
+};
+
+/**
+ * Reading, offsets are checked against the length so a corrupt cache can
+ * not make us read outside of it.
+ */
+static gboolean icon_cache_get_u16(const RofiIconCache *cache, gsize offset,
+                                   guint16 *value) {
+  if (offset > cache->length || (cache->length - offset) < 2) {
+    return FALSE;
+  }
+  const guint8 *p = cache->data + offset;
+  *value = (guint16)((p[0] << 8) | p[1]);
+  return TRUE;
+}
+
+static gboolean icon_cache_get_u32(const RofiIconCache *cache, gsize offset,
+                                   guint32 *value) {
+  if (offset > cache->length || (cache->length - offset) < 4) {
+    return FALSE;
+  }
+  const guint8 *p = cache->data + offset;
+  *value = ((guint32)p[0] << 24) | ((guint32)p[1] << 16) |
+           ((guint32)p[2] << 8) | (guint32)p[3];
+  return TRUE;
+}
+
+static const char *icon_cache_get_string(const RofiIconCache *cache,
+                                         gsize offset) {
+  if (offset >= cache->length ||
+      memchr(cache->data + offset, '\0', cache->length - offset) == NULL) {
+    return NULL;
+  }
+  return (const char *)(cache->data + offset);
+}
+
+/** The hash function GTK uses for the cache. */
+static guint32 icon_cache_hash(const char *name) {
+  const signed char *p = (const signed char *)name;
+  guint32 h = *p;
+  if (h) {
+    for (p += 1; *p != '\0'; p++) {
+      h = (h << 5) - h + *p;
+    }
+  }
+  return h;
+}
+
+/**
+ * @param cache The cache.
+ * @param name The icon name.
+ *
+ * @returns the offset of the image list of the icon or ICON_CACHE_NONE.
+ */
+static guint32 icon_cache_find(const RofiIconCache *cache, const char *name) {
+  guint32 hash_offset = 0, n_buckets = 0, icon = ICON_CACHE_NONE;
+  if (!icon_cache_get_u32(cache, 4, &hash_offset) ||
+      !icon_cache_get_u32(cache, hash_offset, &n_buckets) || n_buckets == 0) {
+    return ICON_CACHE_NONE;
+  }
+  gsize bucket =
+      (gsize)hash_offset + 4 + 4 * (icon_cache_hash(name) % n_buckets);
+  if (!icon_cache_get_u32(cache, bucket, &icon)) {
+    return ICON_CACHE_NONE;
+  }
+  // A chain can not hold more icons than fit in the cache.
+  for (gsize steps = cache->length / ICON_CACHE_ICON_SIZE;
+       icon != ICON_CACHE_NONE && steps > 0; steps--) {
+    guint32 next = 0, name_offset = 0, list_offset = 0;
+    if (!icon_cache_get_u32(cache, icon, &next) ||
+        !icon_cache_get_u32(cache, (gsize)icon + 4, &name_offset) ||
+        !icon_cache_get_u32(cache, (gsize)icon + 8, &list_offset)) {
+      return ICON_CACHE_NONE;
+    }
+    const char *icon_name = icon_cache_get_string(cache, name_offset);
+    if (icon_name != NULL && strcmp(icon_name, name) == 0) {
+      return list_offset;
+    }
+    icon = next;
+  }
+  return ICON_CACHE_NONE;
+}
+
+static void icon_cache_free(RofiIconCache *cache) {
+  g_free(cache->path);
+  g_free(cache->dir_map);
+  g_bytes_unref(cache->bytes);
+  g_free(cache);
+}
+
+/**
+ * @param path The theme directory.
+ * @param bytes The cache content, ownership is taken.
+ * @param dir_names Directory name to index (+1) in the theme.
+ *
+ * Validate the header and map the directories of the cache on those of the
+ * theme.
+ *
+ * @returns the cache, or NULL when it is not valid.
+ */
+static RofiIconCache *icon_cache_new(const char *path, GBytes *bytes,
+                                     GHashTable *dir_names) {
+  RofiIconCache *cache = g_malloc0(sizeof(RofiIconCache));
+  cache->path = g_strdup(path);
+  cache->bytes = bytes;
+  cache->data = g_bytes_get_data(bytes, &(cache->length));
+
+  guint16 major = 0, minor = 0;
+  guint32 dir_offset = 0, n_dirs = 0;
+  if (!icon_cache_get_u16(cache, 0, &major) ||
+      !icon_cache_get_u16(cache, 2, &minor) ||
+      major != ICON_CACHE_MAJOR_VERSION || minor != ICON_CACHE_MINOR_VERSION ||
+      !icon_cache_get_u32(cache, 8, &dir_offset) ||
+      !icon_cache_get_u32(cache, dir_offset, &n_dirs) ||
+      n_dirs > (cache->length - dir_offset) / 4) {
+    g_debug("Invalid icon cache for: %s", path);
+    icon_cache_free(cache);
+    return NULL;
+  }
+  cache->n_dirs = n_dirs;
+  cache->dir_map = g_new(int, MAX(n_dirs, 1));
+  for (guint32 i = 0; i < n_dirs; i++) {
+    guint32 name_offset = 0;
+    const char *name = NULL;
+    if (icon_cache_get_u32(cache, (gsize)dir_offset + 4 + 4 * i,
+                           &name_offset)) {
+      name = icon_cache_get_string(cache, name_offset);
+    }
+    gpointer index = name ? g_hash_table_lookup(dir_names, name) : NULL;
+    cache->dir_map[i] = GPOINTER_TO_INT(index) - 1;
+  }
+  return cache;
+}
+
+static GBytes *icon_cache_map(const char *file) {
+  GMappedFile *mf = g_mapped_file_new(file, FALSE, NULL);
+  if (mf == NULL) {
+    return NULL;
+  }
+  GBytes *bytes = g_mapped_file_get_bytes(mf);
+  g_mapped_file_unref(mf);
+  return bytes;
+}
+
+/**
+ * Writing.
+ */
+static void icon_cache_put_u16(GByteArray *a, guint16 value) {
+  guint8 b[2] = {(guint8)(value >> 8), (guint8)value};
+  g_byte_array_append(a, b, 2);
+}
+
+static void icon_cache_put_u32(GByteArray *a, guint32 value) {
+  guint8 b[4] = {(guint8)(value >> 24), (guint8)(value >> 16),
+                 (guint8)(value >> 8), (guint8)value};
+  g_byte_array_append(a, b, 4);
+}
+
+static void icon_cache_set_u32(GByteArray *a, gsize offset, guint32 value) {
+  a->data[offset] = (guint8)(value >> 24);
+  a->data[offset + 1] = (guint8)(value >> 16);
+  a->data[offset + 2] = (guint8)(value >> 8);
+  a->data[offset + 3] = (guint8)value;
+}
+
+static guint32 icon_cache_peek_u32(const GByteArray *a, gsize offset) {
+  return ((guint32)a->data[offset] << 24) |
+         ((guint32)a->data[offset + 1] << 16) |
+         ((guint32)a->data[offset + 2] << 8) | (guint32)a->data[offset + 3];
+}
+
+static void icon_cache_put_string(GByteArray *a, const char *str) {
+  g_byte_array_append(a, (const guint8 *)str, strlen(str) + 1);
+}
+
+/** An image in the cache that is being built. */
+typedef struct {
+  guint16 dir;
+  guint16 flags;
+} RofiIconCacheImage;
+
+/**
+ * @param theme The theme.
+ * @param icons Icon name to a GArray of RofiIconCacheImage.
+ *
+ * @returns the icons in the cache format.
+ */
+static GBytes *icon_cache_serialize(const RofiIconTheme *theme,
+                                    GHashTable *icons) {
+  GByteArray *a = g_byte_array_new();
+  icon_cache_put_u16(a, ICON_CACHE_MAJOR_VERSION);
+  icon_cache_put_u16(a, ICON_CACHE_MINOR_VERSION);
+  icon_cache_put_u32(a, 0);
+  icon_cache_put_u32(a, 0);
+
+  guint32 n_buckets = g_spaced_primes_closest(g_hash_table_size(icons) / 3);
+  icon_cache_set_u32(a, 4, a->len);
+  icon_cache_put_u32(a, n_buckets);
+  gsize buckets = a->len;
+  for (guint32 i = 0; i < n_buckets; i++) {
+    icon_cache_put_u32(a, ICON_CACHE_NONE);
+  }
+
+  GHashTableIter iter;
+  gpointer key, value;
+  g_hash_table_iter_init(&iter, icons);
+  while (g_hash_table_iter_next(&iter, &key, &value)) {
+    const char *name = (const char *)key;
+    GArray *images = (GArray *)value;
+    gsize bucket = buckets + 4 * (icon_cache_hash(name) % n_buckets);
+    guint32 icon = a->len;
+    // Prepend to the chain of the bucket.
+    icon_cache_put_u32(a, icon_cache_peek_u32(a, bucket));
+    icon_cache_put_u32(a, icon + ICON_CACHE_ICON_SIZE);
+    icon_cache_put_u32(a, 0);
+    icon_cache_put_string(a, name);
+    icon_cache_set_u32(a, icon + 8, a->len);
+    icon_cache_put_u32(a, images->len);
+    for (guint i = 0; i < images->len; i++) {
+      RofiIconCacheImage *image = &g_array_index(images, RofiIconCacheImage, i);
+      icon_cache_put_u16(a, image->dir);
+      icon_cache_put_u16(a, image->flags);
+      // No image data.
+      icon_cache_put_u32(a, 0);
+    }
+    icon_cache_set_u32(a, bucket, icon);
+  }
+
+  icon_cache_set_u32(a, 8, a->len);
+  icon_cache_put_u32(a, theme->dirs->len);
+  gsize dir_offsets = a->len;
+  for (guint i = 0; i < theme->dirs->len; i++) {
+    icon_cache_put_u32(a, 0);
+  }
+  for (guint i = 0; i < theme->dirs->len; i++) {
+    const RofiIconThemeDir *dir = g_ptr_array_index(theme->dirs, i);
+    icon_cache_set_u32(a, dir_offsets + 4 * i, a->len);
+    icon_cache_put_string(a, dir->name);
+  }
+  return g_byte_array_free_to_bytes(a);
+}
+
+static RofiIconCacheFlags icon_suffix_flag(const char *suffix) {
+  for (gsize i = 0; i < G_N_ELEMENTS(icon_suffixes); i++) {
+    if (g_ascii_strcasecmp(suffix, icon_suffixes[i].suffix) == 0) {
+      return icon_suffixes[i].flag;
+    }
+  }
+  return 0;
+}
+
+/**
+ * @param path The theme directory.
+ * @param theme The theme.
+ *
+ * Scan the directories of the theme, this is what gtk-update-icon-cache
+ * does.
+ *
+ * @returns the icons in the cache format.
+ */
+static GBytes *icon_cache_build(const char *path, const RofiIconTheme *theme) {
+  GHashTable *icons = g_hash_table_new_full(g_str_hash, g_str_equal, g_free,
+                                            (GDestroyNotify)g_array_unref);
+  for (guint d = 0; d < theme->dirs->len && d <= G_MAXUINT16; d++) {
+    const RofiIconThemeDir *dir = g_ptr_array_index(theme->dirs, d);
+    char *dir_path = g_build_filename(path, dir->name, NULL);
+    GDir *gdir = g_dir_open(dir_path, 0, NULL);
+    g_free(dir_path);
+    if (gdir == NULL) {
+      continue;
+    }
+    const char *file = NULL;
+    while ((file = g_dir_read_name(gdir)) != NULL) {
+      const char *dot = strrchr(file, '.');
+      if (dot == NULL || dot == file ||
+          g_str_has_suffix(file, ".symbolic.png")) {
+        continue;
+      }
+      guint16 flag = icon_suffix_flag(dot + 1);
+      if (flag == 0) {
+        continue;
+      }
+      char *name = g_strndup(file, dot - file);
+      GArray *images = g_hash_table_lookup(icons, name);
+      if (images == NULL) {
+        images = g_array_new(FALSE, FALSE, sizeof(RofiIconCacheImage));
+        g_hash_table_insert(icons, name, images);
+      } else {
+        g_free(name);
+      }
+      RofiIconCacheImage *last =
+          images->len > 0
+              ? &g_array_index(images, RofiIconCacheImage, images->len - 1)
+              : NULL;
+      if (last != NULL && last->dir == d) {
+        last->flags |= flag;
+      } else {
+        RofiIconCacheImage image = {.dir = d, .flags = flag};
+        g_array_append_val(images, image);
+      }
+    }
+    g_dir_close(gdir);
+  }
+  GBytes *bytes = icon_cache_serialize(theme, icons);
+  g_hash_table_destroy(icons);
+  return bytes;
+}
+
+/**
+ * @param path The theme directory.
+ * @param theme The theme.
+ * @param dir_names Directory name to index (+1) in the theme.
+ * @param persist_dir Where to keep the caches we build, can be NULL.
+ *
+ * Use the GTK cache if it is up to date, otherwise our own cache if that is
+ * up to date, otherwise scan the theme and store the result.
+ *
+ * @returns the cache of the theme directory.
+ */
+static RofiIconCache *icon_cache_load(const char *path,
+                                      const RofiIconTheme *theme,
+                                      GHashTable *dir_names,
+                                      const char *persist_dir) {
+  GStatBuf dir_st, st;
+  if (g_stat(path, &dir_st) != 0) {
+    return NULL;
+  }
+
+  char *file = g_build_filename(path, "icon-theme.cache", NULL);
+  if (g_stat(file, &st) == 0 && st.st_mtime >= dir_st.st_mtime) {
+    GBytes *bytes = icon_cache_map(file);
+    RofiIconCache *cache =
+        bytes ? icon_cache_new(path, bytes, dir_names) : NULL;
+    if (cache != NULL) {
+      g_debug("Using icon cache: %s", file);
+      g_free(file);
+      return cache;
+    }
+  }
+  g_free(file);
+
+  // Our own cache is only valid when no directory changed after writing it.
+  char *persist_file = NULL;
+  if (persist_dir != NULL) {
+    gchar *sum = g_compute_checksum_for_string(G_CHECKSUM_MD5, path, -1);
+    char *base = g_strdup_printf("rofi-icon-theme-%d-%s.cache",
+                                 ICON_CACHE_PERSIST_VERSION, sum);
+    persist_file = g_build_filename(persist_dir, base, NULL);
+    g_free(base);
+    g_free(sum);
+
+    if (g_stat(persist_file, &st) == 0) {
+      gboolean valid = st.st_mtime >= dir_st.st_mtime;
+      for (guint i = 0; valid && i < theme->dirs->len; i++) {
+        const RofiIconThemeDir *dir = g_ptr_array_index(theme->dirs, i);
+        char *dir_path = g_build_filename(path, dir->name, NULL);
+        GStatBuf sub_st;
+        if (g_stat(dir_path, &sub_st) == 0 && sub_st.st_mtime > st.st_mtime) {
+          valid = FALSE;
+        }
+        g_free(dir_path);
+      }
+      GBytes *bytes = valid ? icon_cache_map(persist_file) : NULL;
+      RofiIconCache *cache =
+          bytes ? icon_cache_new(path, bytes, dir_names) : NULL;
+      if (cache != NULL) {
+        g_debug("Using rofi icon cache: %s for %s", persist_file, path);
+        g_free(persist_file);
+        return cache;
+      }
+    }
+  }
+
+  g_debug("Building icon cache for: %s", path);
+  GBytes *bytes = icon_cache_build(path, theme);
+  if (persist_file != NULL) {
+    GError *error = NULL;
+    gsize length = 0;
+    const char *data = g_bytes_get_data(bytes, &length);
+    if (!g_file_set_contents(persist_file, data, length, &error)) {
+      g_warning("Failed to write icon cache: %s", error->message);
+      g_error_free(error);
+    }
+    g_free(persist_file);
+  }
+  return icon_cache_new(path, bytes, dir_names);
+}
+
+static void icon_theme_dir_free(RofiIconThemeDir *dir) {
+  g_free(dir->name);
+  g_free(dir);
+}
+
+static void icon_theme_free(RofiIconTheme *theme) {
+  g_free(theme->name);
+  g_ptr_array_free(theme->dirs, TRUE);
+  g_ptr_array_free(theme->caches, TRUE);
+  g_free(theme);
+}
+
+static int icon_theme_get_int(GKeyFile *kf, const char *group, const char *key,
+                              int def) {
+  GError *error = NULL;
+  int value = g_key_file_get_integer(kf, group, key, &error);
+  if (error != NULL) {
+    g_error_free(error);
+    return def;
+  }
+  return value;
+}
+
+/**
+ * @param theme The theme to add the directories to.
+ * @param kf The parsed index.theme.
+ * @param key The key listing the directories.
+ * @param dir_names Directory name to index (+1), updated.
+ */
+static void icon_theme_add_dirs(RofiIconTheme *theme, GKeyFile *kf,
+                                const char *key, GHashTable *dir_names) {
+  char **names = g_key_file_get_string_list(kf, "Icon Theme", key, NULL, NULL);
+  for (int i = 0; names && names[i]; i++) {
+    const char *name = names[i];
+    GError *error = NULL;
+    int size = g_key_file_get_integer(kf, name, "Size", &error);
+    if (error != NULL || g_hash_table_contains(dir_names, name)) {
+      g_clear_error(&error);
+      continue;
+    }
+    RofiIconThemeDir *dir = g_malloc0(sizeof(RofiIconThemeDir));
+    dir->name = g_strdup(name);
+    dir->size = size;
+    dir->scale = icon_theme_get_int(kf, name, "Scale", 1);
+    dir->min_size = icon_theme_get_int(kf, name, "MinSize", size);
+    dir->max_size = icon_theme_get_int(kf, name, "MaxSize", size);
+    dir->threshold = icon_theme_get_int(kf, name, "Threshold", 2);
+    char *type = g_key_file_get_string(kf, name, "Type", NULL);
+    if (g_strcmp0(type, "Fixed") == 0) {
+      dir->type = ICON_DIR_FIXED;
+    } else if (g_strcmp0(type, "Scalable") == 0) {
+      dir->type = ICON_DIR_SCALABLE;
+    } else {
+      dir->type = ICON_DIR_THRESHOLD;
+    }
+    g_free(type);
+    g_ptr_array_add(theme->dirs, dir);
+    g_hash_table_insert(dir_names, dir->name,
+                        GINT_TO_POINTER(theme->dirs->len));
+  }
+  g_strfreev(names);
+}
+
+/**
+ * @param name The theme name.
+ * @param base_dirs The icon base directories.
+ * @param persist_dir Where to keep the caches we build, can be NULL.
+ * @param inherits Set to the themes this theme inherits from.
+ *
+ * @returns the theme, or NULL if it has no index.theme.
+ */
+static RofiIconTheme *icon_theme_load(const char *name, char **base_dirs,
+                                      const char *persist_dir,
+                                      char ***inherits) {
+  // The first index.theme found describes the theme.
+  GKeyFile *kf = g_key_file_new();
+  gboolean found = FALSE;
+  for (int i = 0; !found && base_dirs[i]; i++) {
+    char *file = g_build_filename(base_dirs[i], name, "index.theme", NULL);
+    found = g_key_file_load_from_file(kf, file, G_KEY_FILE_NONE, NULL);
+    g_free(file);
+  }
+  if (!found) {
+    g_key_file_free(kf);
+    return NULL;
+  }
+  g_key_file_set_list_separator(kf, ',');
+
+  RofiIconTheme *theme = g_malloc0(sizeof(RofiIconTheme));
+  theme->name = g_strdup(name);
+  theme->dirs = g_ptr_array_new_with_free_func(
+      (GDestroyNotify)icon_theme_dir_free);
+  theme->caches =
+      g_ptr_array_new_with_free_func((GDestroyNotify)icon_cache_free);
+
+  GHashTable *dir_names = g_hash_table_new(g_str_hash, g_str_equal);
+  icon_theme_add_dirs(theme, kf, "Directories", dir_names);
+  icon_theme_add_dirs(theme, kf, "ScaledDirectories", dir_names);
+  *inherits = g_key_file_get_string_list(kf, "Icon Theme", "Inherits", NULL,
+                                         NULL);
+  g_key_file_free(kf);
+
+  for (int i = 0; base_dirs[i]; i++) {
+    char *path = g_build_filename(base_dirs[i], name, NULL);
+    if (g_file_test(path, G_FILE_TEST_IS_DIR)) {
+      RofiIconCache *cache =
+          icon_cache_load(path, theme, dir_names, persist_dir);
+      if (cache != NULL) {
+        g_ptr_array_add(theme->caches, cache);
+      }
+    }
+    g_free(path);
+  }
+  g_hash_table_destroy(dir_names);
+  return theme;
+}
+
+static void icon_theme_index_add(RofiIconThemeIndex *index, GHashTable *seen,
+                                 const char *name, char **base_dirs,
+                                 const char *persist_dir) {
+  if (name == NULL || name[0] == '\0' || g_hash_table_contains(seen, name)) {
+    return;
+  }
+  g_hash_table_add(seen, g_strdup(name));
+  char **inherits = NULL;
+  RofiIconTheme *theme =
+      icon_theme_load(name, base_dirs, persist_dir, &inherits);
+  if (theme == NULL) {
+    g_debug("Icon theme not found: %s", name);
+    return;
+  }
+  g_ptr_array_add(index->themes, theme);
+  for (int i = 0; inherits && inherits[i]; i++) {
+    // hicolor is always searched last.
+    if (g_strcmp0(inherits[i], "hicolor") != 0) {
+      icon_theme_index_add(index, seen, inherits[i], base_dirs, persist_dir);
+    }
+  }
+  g_strfreev(inherits);
+}
+
+static void icon_unthemed_free(RofiIconUnthemed *icon) {
+  g_free(icon->path);
+  g_free(icon);
+}
+
+/**
+ * @param index The index.
+ * @param dirs The directories that can hold unthemed icons, in order.
+ *
+ * List the icons directly in the base directories.
+ */
+static void icon_theme_index_add_unthemed(RofiIconThemeIndex *index,
+                                          char **dirs) {
+  for (unsigned int base = 0; dirs[base]; base++) {
+    GDir *gdir = g_dir_open(dirs[base], 0, NULL);
+    if (gdir == NULL) {
+      continue;
+    }
+    const char *file = NULL;
+    while ((file = g_dir_read_name(gdir)) != NULL) {
+      const char *dot = strrchr(file, '.');
+      if (dot == NULL || dot == file) {
+        continue;
+      }
+      unsigned int rank = 0;
+      while (rank < G_N_ELEMENTS(icon_suffixes) &&
+             g_ascii_strcasecmp(dot + 1, icon_suffixes[rank].suffix) != 0) {
+        rank++;
+      }
+      if (rank == G_N_ELEMENTS(icon_suffixes)) {
+        continue;
+      }
+      char *name = g_strndup(file, dot - file);
+      RofiIconUnthemed *icon = g_hash_table_lookup(index->unthemed, name);
+      if (icon == NULL) {
+        icon = g_malloc0(sizeof(RofiIconUnthemed));
+        g_hash_table_insert(index->unthemed, name, icon);
+      } else if (icon->base == base && rank < icon->rank) {
+        g_free(icon->path);
+        g_free(name);
+      } else {
+        g_free(name);
+        continue;
+      }
+      icon->path = g_build_filename(dirs[base], file, NULL);
+      icon->base = base;
+      icon->rank = rank;
+    }
+    g_dir_close(gdir);
+  }
+}
+
+RofiIconThemeIndex *rofi_icon_theme_index_new(const char *const *themes,
+                                              const char *persist_dir) {
+  RofiIconThemeIndex *index = g_malloc0(sizeof(RofiIconThemeIndex));
+  index->themes =
+      g_ptr_array_new_with_free_func((GDestroyNotify)icon_theme_free);
+  index->unthemed = g_hash_table_new_full(
+      g_str_hash, g_str_equal, g_free, (GDestroyNotify)icon_unthemed_free);
+
+  // Search path of the XDG icon theme specification.
+  const char *const *data_dirs = g_get_system_data_dirs();
+  GPtrArray *dirs = g_ptr_array_new();
+  g_ptr_array_add(dirs, g_build_filename(g_get_home_dir(), ".icons", NULL));
+  g_ptr_array_add(dirs,
+                  g_build_filename(g_get_user_data_dir(), "icons", NULL));
+  for (int i = 0; data_dirs && data_dirs[i]; i++) {
+    g_ptr_array_add(dirs, g_build_filename(data_dirs[i], "icons", NULL));
+  }
+  g_ptr_array_add(dirs, NULL);
+  char **base_dirs = (char **)g_ptr_array_free(dirs, FALSE);
+
+  GHashTable *seen = g_hash_table_new_full(g_str_hash, g_str_equal, g_free,
+                                           NULL);
+  for (int i = 0; themes && themes[i]; i++) {
+    icon_theme_index_add(index, seen, themes[i], base_dirs, persist_dir);
+  }
+  icon_theme_index_add(index, seen, "hicolor", base_dirs, persist_dir);
+  g_hash_table_destroy(seen);
+
+  // Unthemed icons live in the base directories and the pixmaps directories.
+  dirs = g_ptr_array_new_with_free_func(g_free);
+  for (int i = 0; base_dirs[i]; i++) {
+    g_ptr_array_add(dirs, g_strdup(base_dirs[i]));
+  }
+  for (int i = 0; data_dirs && data_dirs[i]; i++) {
+    g_ptr_array_add(dirs, g_build_filename(data_dirs[i], "pixmaps", NULL));
+  }
+  g_ptr_array_add(dirs, NULL);
+  icon_theme_index_add_unthemed(index, (char **)dirs->pdata);
+  g_ptr_array_free(dirs, TRUE);
+  g_strfreev(base_dirs);
+  return index;
+}
+
+/**
+ * Size matching, from the XDG icon theme specification.
+ */
+static gboolean icon_dir_matches_size(const RofiIconThemeDir *dir, int size,
+                                      int scale) {
+  if (dir->scale != scale) {
+    return FALSE;
+  }
+  switch (dir->type) {
+  case ICON_DIR_FIXED:
+    return dir->size == size;
+  case ICON_DIR_SCALABLE:
+    return dir->min_size <= size && size <= dir->max_size;
+  case ICON_DIR_THRESHOLD:
+  default:
+    return (dir->size - dir->threshold) <= size &&
+           size <= (dir->size + dir->threshold);
+  }
+}
+
+static int icon_dir_size_distance(const RofiIconThemeDir *dir, int size,
+                                  int scale) {
+  int scaled = size * scale;
+  switch (dir->type) {
+  case ICON_DIR_FIXED:
+    return ABS(dir->size * dir->scale - scaled);
+  case ICON_DIR_SCALABLE:
+    if (scaled < dir->min_size * dir->scale) {
+      return dir->min_size * dir->scale - scaled;
+    }
+    if (scaled > dir->max_size * dir->scale) {
+      return scaled - dir->max_size * dir->scale;
+    }
+    return 0;
+  case ICON_DIR_THRESHOLD:
+  default:
+    if (scaled < (dir->size - dir->threshold) * dir->scale) {
+      return dir->size * dir->scale - scaled;
+    }
+    if (scaled > (dir->size + dir->threshold) * dir->scale) {
+      return scaled - dir->size * dir->scale;
+    }
+    return 0;
+  }
+}
+
+static char *icon_theme_build_path(const RofiIconCache *cache,
+                                   const RofiIconThemeDir *dir,
+                                   const char *name, const char *suffix) {
+  char *file = g_strdup_printf("%s.%s", name, suffix);
+  char *path = g_build_filename(cache->path, dir->name, file, NULL);
+  g_free(file);
+  return path;
+}
+
+static char *icon_theme_lookup(const RofiIconTheme *theme, const char *name,
+                               int size, int scale) {
+  const RofiIconCache *best_cache = NULL;
+  const RofiIconThemeDir *best_dir = NULL;
+  const char *best_suffix = NULL;
+  int best_distance = G_MAXINT;
+
+  for (guint c = 0; c < theme->caches->len; c++) {
+    const RofiIconCache *cache = g_ptr_array_index(theme->caches, c);
+    guint32 list = icon_cache_find(cache, name);
+    guint32 n_images = 0;
+    if (list == ICON_CACHE_NONE ||
+        !icon_cache_get_u32(cache, list, &n_images)) {
+      continue;
+    }
+    for (guint32 i = 0; i < n_images; i++) {
+      gsize image = (gsize)list + 4 + 8 * (gsize)i;
+      guint16 dir_index = 0, flags = 0;
+      if (!icon_cache_get_u16(cache, image, &dir_index) ||
+          !icon_cache_get_u16(cache, image + 2, &flags)) {
+        break;
+      }
+      if (dir_index >= cache->n_dirs || cache->dir_map[dir_index] < 0) {
+        continue;
+      }
+      const char *suffix = NULL;
+      for (gsize s = 0; suffix == NULL && s < G_N_ELEMENTS(icon_suffixes);
+           s++) {
+        if (flags & icon_suffixes[s].flag) {
+          suffix = icon_suffixes[s].suffix;
+        }
+      }
+      if (suffix == NULL) {
+        continue;
+      }
+      const RofiIconThemeDir *dir =
+          g_ptr_array_index(theme->dirs, cache->dir_map[dir_index]);
+      if (icon_dir_matches_size(dir, size, scale)) {
+        return icon_theme_build_path(cache, dir, name, suffix);
+      }
+      int distance = icon_dir_size_distance(dir, size, scale);
+      if (distance < best_distance) {
+        best_distance = distance;
+        best_cache = cache;
+        best_dir = dir;
+        best_suffix = suffix;
+      }
+    }
+  }
+  if (best_dir != NULL) {
+    return icon_theme_build_path(best_cache, best_dir, name, best_suffix);
+  }
+  return NULL;
+}
+
+char *rofi_icon_theme_index_lookup(const RofiIconThemeIndex *index,
+                                   const char *name, int size, int scale) {
+  if (index == NULL || name == NULL || name[0] == '\0') {
+    return NULL;
+  }
+  for (guint i = 0; i < index->themes->len; i++) {
+    char *path = icon_theme_lookup(g_ptr_array_index(index->themes, i), name,
+                                   size, MAX(scale, 1));
+    if (path != NULL) {
+      return path;
+    }
+  }
+  const RofiIconUnthemed *icon = g_hash_table_lookup(index->unthemed, name);
+  if (icon != NULL) {
+    return g_strdup(icon->path);
+  }
+  return NULL;
+}
+
+void rofi_icon_theme_index_free(RofiIconThemeIndex *index) {
+  if (index == NULL) {
+    return;
+  }
+  g_ptr_array_free(index->themes, TRUE);
+  g_hash_table_destroy(index->unthemed);
+  g_free(index);
+}
@@ -67,6 +67,7 @@
 #include "view.h"
 
 #include "rofi-icon-fetcher.h"
+#include "startup-snapshot.h"
 #include "theme.h"
 
 #include "timings.h"
@@ -128,6 +129,10 @@ unsigned int num_available_modes = 0;
 unsigned int num_modes = 0;
 /** Current selected mode */
 unsigned int curr_mode = 0;
+/** Per entry in #modes, if it has been initialized. */
+static gboolean *modes_initialized = NULL;
+/** Rows of the previous run shown while the first mode initializes. */
+static Mode *startup_snapshot = NULL;
 
 /** Handle to NkBindings object for input devices. */
 NkBindings *bindings = NULL;
@@ -195,26 +200,111 @@ static void teardown(int pfd) {
   // Cleanup pid file.
   remove_pid_file(pfd);
 }
-static void run_mode_index(ModeMode mode) {
-  // Otherwise check if requested mode is enabled.
-  for (unsigned int i = 0; i < num_modes; i++) {
-    if (!mode_init(modes[i])) {
-      GString *str = g_string_new("Failed to initialize the mode: ");
-      g_string_append(str, modes[i]->name);
-      g_string_append(str, "\n");
-
-      rofi_view_error_dialog(str->str, ERROR_MSG_MARKUP);
-      g_string_free(str, FALSE);
-      break;
+/**
+ * @param index The index of the mode in #modes.
+ *
+ * Modes are initialized the first time they are shown, so startup only pays
+ * for the mode that is displayed first. On failure an error dialog is shown.
+ *
+ * @returns TRUE if the mode is ready to use.
+ */
+static gboolean rofi_mode_ensure_init(unsigned int index) {
+  if (modes_initialized == NULL) {
+    modes_initialized = g_malloc0_n(num_modes, sizeof(gboolean));
+  }
+  if (modes_initialized[index]) {
+    return TRUE;
+  }
+  // Also set on failure, a partially initialized mode needs destroying.
+  modes_initialized[index] = TRUE;
+  if (!mode_init(modes[index])) {
+    GString *str = g_string_new("Failed to initialize the mode: ");
+    g_string_append(str, modes[index]->name);
+    g_string_append(str, "\n");
+
+    rofi_view_error_dialog(str->str, ERROR_MSG_MARKUP);
+    g_string_free(str, FALSE);
+    return FALSE;
+  }
+  return TRUE;
+}
+
+/**
+ * @param state The view showing #startup_snapshot.
+ * @param selected_line A row of the snapshot, set to the same row in the
+ * mode or UINT32_MAX if it is gone.
+ *
+ * Initialize the mode the snapshot stands in for and show it instead.
+ *
+ * @returns FALSE if the mode failed to initialize, @p state is freed then.
+ */
+static gboolean rofi_startup_snapshot_replace(RofiViewState *state,
+                                              unsigned int *selected_line) {
+  Mode *snapshot = startup_snapshot;
+  startup_snapshot = NULL;
+  TICK_N("Replace startup snapshot");
+  if (!rofi_mode_ensure_init(curr_mode)) {
+    // Error dialog is shown on top, drop this view.
+    rofi_view_remove_active(state);
+    rofi_view_free(state);
+    startup_snapshot_free(snapshot);
+    return FALSE;
+  }
+  *selected_line =
+      startup_snapshot_map_line(snapshot, modes[curr_mode], *selected_line);
+  rofi_view_replace_mode(state, modes[curr_mode]);
+  if (*selected_line != UINT32_MAX) {
+    rofi_view_set_selected_line(state, *selected_line);
+  }
+  startup_snapshot_free(snapshot);
+  TICK_N("Replace startup snapshot done");
+  return TRUE;
+}
+
+/**
+ * Runs after the first frame with the snapshot has been drawn.
+ */
+static gboolean rofi_startup_snapshot_idle(G_GNUC_UNUSED gpointer data) {
+  RofiViewState *state = rofi_view_get_active();
+  if (startup_snapshot != NULL && state != NULL &&
+      state->sw == startup_snapshot) {
+    // Keep the row the user moved to, if any.
+    unsigned int selected_line = UINT32_MAX;
+    unsigned int selected = listview_get_selected(state->list_view);
+    if (selected < state->filtered_lines) {
+      selected_line = state->line_map[selected];
     }
+    rofi_startup_snapshot_replace(state, &selected_line);
   }
-  // Error dialog must have been created.
-  if (rofi_view_get_active() != NULL) {
-    return;
+  return G_SOURCE_REMOVE;
+}
+
+static void run_mode_index(ModeMode mode) {
+  // Show the first page of the previous run while the mode initializes.
+  // Not when the input or the selection is given, the snapshot only holds
+  // the unfiltered first page.
+  if (config.filter == NULL && find_arg("-selected-row") < 0) {
+    startup_snapshot = startup_snapshot_load(modes[mode]);
+  }
+  if (startup_snapshot == NULL) {
+    // Only the requested mode, the others are initialized when switched to.
+    rofi_mode_ensure_init(mode);
+    // Error dialog must have been created.
+    if (rofi_view_get_active() != NULL) {
+      return;
+    }
   }
   curr_mode = mode;
-  RofiViewState *state =
-      rofi_view_create(modes[mode], config.filter, 0, process_result);
+  RofiViewState *state = rofi_view_create(
+      startup_snapshot ? startup_snapshot : modes[mode], config.filter, 0,
+      process_result);
+  if (state != NULL && startup_snapshot != NULL) {
+    // Lower priority than drawing, so the snapshot is on screen first.
+    g_idle_add(rofi_startup_snapshot_idle, NULL);
+  } else if (startup_snapshot != NULL) {
+    startup_snapshot_free(startup_snapshot);
+    startup_snapshot = NULL;
+  }
 
   // User can pre-select a row.
   if (find_arg("-selected-row") >= 0) {
@@ -236,6 +326,19 @@ void process_result(RofiViewState *state) {
     unsigned int selected_line = rofi_view_get_selected_line(state);
     ;
     MenuReturn mretv = rofi_view_get_return_value(state);
+    if (sw == startup_snapshot && !(mretv & MENU_CANCEL)) {
+      // Accepted before the mode finished loading, act on the live rows.
+      if (!rofi_startup_snapshot_replace(state, &selected_line)) {
+        return;
+      }
+      sw = state->sw;
+      if (selected_line == UINT32_MAX &&
+          !(mretv & (MENU_NEXT | MENU_PREVIOUS | MENU_QUICK_SWITCH |
+                     MENU_CUSTOM_INPUT))) {
+        // The row is gone, let the user pick from the live rows.
+        return;
+      }
+    }
     char *input = g_strdup(rofi_view_get_user_input(state));
     ModeMode retv = mode_result(sw, mretv, &input, selected_line);
     {
@@ -270,6 +373,12 @@ void process_result(RofiViewState *state) {
       mode = retv;
     }
     if (mode != MODE_EXIT) {
+      if (!rofi_mode_ensure_init(mode)) {
+        // Error dialog is shown on top, drop this view.
+        rofi_view_remove_active(state);
+        rofi_view_free(state);
+        return;
+      }
       /**
        * Load in the new mode.
        */
@@ -278,6 +387,9 @@ void process_result(RofiViewState *state) {
       return;
     }
     // On exit, free current view, and pop to one above.
+    if (sw != startup_snapshot) {
+      startup_snapshot_save(sw, listview_get_page_size(state->list_view));
+    }
     rofi_view_remove_active(state);
     rofi_view_free(state);
     return;
@@ -507,9 +619,17 @@ static void help_print_no_arguments(void) {
  * Cleanup globally allocated memory.
  */
 static void cleanup(void) {
-  for (unsigned int i = 0; i < num_modes; i++) {
-    mode_destroy(modes[i]);
+  if (startup_snapshot != NULL) {
+    startup_snapshot_free(startup_snapshot);
+    startup_snapshot = NULL;
+  }
+  for (unsigned int i = 0; modes_initialized != NULL && i < num_modes; i++) {
+    if (modes_initialized[i]) {
+      mode_destroy(modes[i]);
+    }
   }
+  g_free(modes_initialized);
+  modes_initialized = NULL;
   rofi_view_workers_finalize();
   if (main_loop != NULL) {
     g_main_loop_unref(main_loop);
@@ -0,0 +1,327 @@
+/*
+ * rofi
+ *
+ * MIT/X11 License
+ * Copyright © 2013-2023 Qball Cow <qball@gmpclient.org>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+/** The log domain of this Helper. */
+#define G_LOG_DOMAIN "Helpers.StartupSnapshot"
+
+#include "config.h"
+
+#include <glib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "helper.h"
+#include "mode-private.h"
+#include "rofi-icon-fetcher.h"
+#include "rofi.h"
+#include "startup-snapshot.h"
+#include "theme.h"
+#include "timings.h"
+
+/** Name of the file in the cache directory that holds the snapshots. */
+#define STARTUP_SNAPSHOT_FILE "rofi3.snapshot"
+/** Upper bound on the number of rows stored per mode. */
+#define STARTUP_SNAPSHOT_MAX_ROWS 100
+
+/** A stored row. */
+typedef struct {
+  char *display;
+  char *icon_name;
+  /** The completion string of the row in the mode. */
+  char *completion;
+  /** The identity of the row in the mode, see mode_get_identity(). */
+  char *identity;
+  int state;
+
+  uint32_t icon_fetch_uid;
+  uint32_t icon_fetch_size;
+} StartupSnapshotRow;
+
+typedef struct {
+  StartupSnapshotRow *rows;
+  unsigned int num_rows;
+} StartupSnapshotModePrivateData;
+
+gboolean startup_snapshot_enabled(const Mode *mode) {
+  ThemeWidget *wid = rofi_config_find_widget(mode->name, NULL, TRUE);
+  if (wid) {
+    Property *p =
+        rofi_theme_find_property(wid, P_BOOLEAN, "startup-snapshot", FALSE);
+    if (p != NULL && p->type == P_BOOLEAN) {
+      return p->value.b;
+    }
+  }
+  // Only modes that identify their rows (run, drun) opt in by default, the
+  // completion string of the others does not tell rows apart.
+  return mode->_get_identity != NULL;
+}
+
+void startup_snapshot_save(Mode *mode, unsigned int rows) {
+  if (cache_dir == NULL || !startup_snapshot_enabled(mode)) {
+    return;
+  }
+  rows = MIN(rows, mode_get_num_entries(mode));
+  rows = MIN(rows, STARTUP_SNAPSHOT_MAX_ROWS);
+
+  char *path = g_build_filename(cache_dir, STARTUP_SNAPSHOT_FILE, NULL);
+  GKeyFile *kf = g_key_file_new();
+  // Keep the snapshots of the other modes.
+  g_key_file_load_from_file(kf, path, G_KEY_FILE_NONE, NULL);
+  g_key_file_remove_group(kf, mode->name, NULL);
+
+  if (rows > 0) {
+    char **display = g_new0(char *, rows + 1);
+    char **icons = g_new0(char *, rows + 1);
+    char **completion = g_new0(char *, rows + 1);
+    char **identity = g_new0(char *, rows + 1);
+    int *states = g_new0(int, rows);
+    for (unsigned int i = 0; i < rows; i++) {
+      display[i] = mode_get_display_value(mode, i, &(states[i]), NULL, TRUE);
+      icons[i] = mode_get_icon_name(mode, i);
+      completion[i] = mode_get_completion(mode, i);
+      identity[i] = mode_get_identity(mode, i);
+      // The lists can not hold NULL.
+      display[i] = display[i] ? display[i] : g_strdup("");
+      icons[i] = icons[i] ? icons[i] : g_strdup("");
+      completion[i] = completion[i] ? completion[i] : g_strdup("");
+      identity[i] = identity[i] ? identity[i] : g_strdup("");
+    }
+    g_key_file_set_string_list(kf, mode->name, "Display",
+                               (const gchar *const *)display, rows);
+    g_key_file_set_string_list(kf, mode->name, "Icon",
+                               (const gchar *const *)icons, rows);
+    g_key_file_set_string_list(kf, mode->name, "Completion",
+                               (const gchar *const *)completion, rows);
+    g_key_file_set_string_list(kf, mode->name, "Identity",
+                               (const gchar *const *)identity, rows);
+    g_key_file_set_integer_list(kf, mode->name, "State", states, rows);
+    g_strfreev(display);
+    g_strfreev(icons);
+    g_strfreev(completion);
+    g_strfreev(identity);
+    g_free(states);
+  }
+
+  GError *error = NULL;
+  if (!g_key_file_save_to_file(kf, path, &error)) {
+    g_warning("Failed to write startup snapshot: %s", error->message);
+    g_error_free(error);
+  }
+  g_key_file_free(kf);
+  g_free(path);
+}
+
+/**
+ * The snapshot mode.
+ */
+static int startup_snapshot_mode_init(G_GNUC_UNUSED Mode *sw) { return TRUE; }
+
+static unsigned int startup_snapshot_mode_get_num_entries(const Mode *sw) {
+  const StartupSnapshotModePrivateData *pd =
+      (const StartupSnapshotModePrivateData *)mode_get_private_data(sw);
+  return pd ? pd->num_rows : 0;
+}
+
+static ModeMode startup_snapshot_mode_result(G_GNUC_UNUSED Mode *sw,
+                                             G_GNUC_UNUSED int menu_retv,
+                                             G_GNUC_UNUSED char **input,
+                                             G_GNUC_UNUSED unsigned int line) {
+  // Results are handled by the mode the snapshot stands in for.
+  return MODE_EXIT;
+}
+
+static void startup_snapshot_mode_destroy(Mode *sw) {
+  StartupSnapshotModePrivateData *pd =
+      (StartupSnapshotModePrivateData *)mode_get_private_data(sw);
+  if (pd == NULL) {
+    return;
+  }
+  for (unsigned int i = 0; i < pd->num_rows; i++) {
+    g_free(pd->rows[i].display);
+    g_free(pd->rows[i].icon_name);
+    g_free(pd->rows[i].completion);
+    g_free(pd->rows[i].identity);
+  }
+  g_free(pd->rows);
+  g_free(pd);
+  mode_set_private_data(sw, NULL);
+}
+
+static int startup_snapshot_mode_token_match(const Mode *sw,
+                                             rofi_int_matcher **tokens,
+                                             unsigned int index) {
+  const StartupSnapshotModePrivateData *pd =
+      (const StartupSnapshotModePrivateData *)mode_get_private_data(sw);
+  return helper_token_match(tokens, pd->rows[index].display);
+}
+
+static char *startup_snapshot_mode_get_display_value(
+    const Mode *sw, unsigned int selected_line, int *state,
+    G_GNUC_UNUSED GList **attr_list, int get_entry) {
+  const StartupSnapshotModePrivateData *pd =
+      (const StartupSnapshotModePrivateData *)mode_get_private_data(sw);
+  const StartupSnapshotRow *row = &(pd->rows[selected_line]);
+  *state |= row->state;
+  return get_entry ? g_strdup(row->display) : NULL;
+}
+
+static cairo_surface_t *
+startup_snapshot_mode_get_icon(const Mode *sw, unsigned int selected_line,
+                               unsigned int height) {
+  StartupSnapshotModePrivateData *pd =
+      (StartupSnapshotModePrivateData *)mode_get_private_data(sw);
+  StartupSnapshotRow *row = &(pd->rows[selected_line]);
+  if (row->icon_name == NULL) {
+    return NULL;
+  }
+  if (row->icon_fetch_uid == 0 || row->icon_fetch_size != height) {
+    row->icon_fetch_uid = rofi_icon_fetcher_query(row->icon_name, height);
+    row->icon_fetch_size = height;
+  }
+  return rofi_icon_fetcher_get(row->icon_fetch_uid);
+}
+
+static char *startup_snapshot_mode_get_completion(const Mode *sw,
+                                                  unsigned int selected_line) {
+  const StartupSnapshotModePrivateData *pd =
+      (const StartupSnapshotModePrivateData *)mode_get_private_data(sw);
+  return g_strdup(pd->rows[selected_line].completion);
+}
+
+/** Template for the snapshot modes. */
+static const Mode startup_snapshot_mode = {
+    .abi_version = ABI_VERSION,
+    ._init = startup_snapshot_mode_init,
+    ._get_num_entries = startup_snapshot_mode_get_num_entries,
+    ._result = startup_snapshot_mode_result,
+    ._destroy = startup_snapshot_mode_destroy,
+    ._token_match = startup_snapshot_mode_token_match,
+    ._get_display_value = startup_snapshot_mode_get_display_value,
+    ._get_icon = startup_snapshot_mode_get_icon,
+    ._get_completion = startup_snapshot_mode_get_completion,
+    ._preprocess_input = NULL,
+    ._get_message = NULL,
+    .private_data = NULL,
+    .free = NULL,
+    .type = MODE_TYPE_SWITCHER,
+};
+
+Mode *startup_snapshot_load(const Mode *mode) {
+  if (cache_dir == NULL || !startup_snapshot_enabled(mode)) {
+    return NULL;
+  }
+  char *path = g_build_filename(cache_dir, STARTUP_SNAPSHOT_FILE, NULL);
+  GKeyFile *kf = g_key_file_new();
+  gboolean loaded = g_key_file_load_from_file(kf, path, G_KEY_FILE_NONE, NULL);
+  g_free(path);
+  if (!loaded) {
+    g_key_file_free(kf);
+    return NULL;
+  }
+
+  gsize n_display = 0, n_icons = 0, n_completion = 0, n_identity = 0;
+  gsize n_states = 0;
+  char **display = g_key_file_get_string_list(kf, mode->name, "Display",
+                                              &n_display, NULL);
+  char **icons =
+      g_key_file_get_string_list(kf, mode->name, "Icon", &n_icons, NULL);
+  char **completion = g_key_file_get_string_list(kf, mode->name, "Completion",
+                                                 &n_completion, NULL);
+  char **identity = g_key_file_get_string_list(kf, mode->name, "Identity",
+                                               &n_identity, NULL);
+  int *states =
+      g_key_file_get_integer_list(kf, mode->name, "State", &n_states, NULL);
+  g_key_file_free(kf);
+
+  Mode *snapshot = NULL;
+  if (display != NULL && icons != NULL && completion != NULL &&
+      identity != NULL && states != NULL && n_display > 0 &&
+      n_display <= STARTUP_SNAPSHOT_MAX_ROWS && n_icons == n_display &&
+      n_completion == n_display && n_identity == n_display &&
+      n_states == n_display) {
+    StartupSnapshotModePrivateData *pd =
+        g_malloc0(sizeof(StartupSnapshotModePrivateData));
+    pd->num_rows = n_display;
+    pd->rows = g_new0(StartupSnapshotRow, pd->num_rows);
+    for (unsigned int i = 0; i < pd->num_rows; i++) {
+      StartupSnapshotRow *row = &(pd->rows[i]);
+      row->display = g_strdup(display[i]);
+      row->icon_name = icons[i][0] != '\0' ? g_strdup(icons[i]) : NULL;
+      row->completion = g_strdup(completion[i]);
+      row->identity = g_strdup(identity[i]);
+      row->state = states[i];
+    }
+
+    snapshot = g_malloc0(sizeof(Mode));
+    *snapshot = startup_snapshot_mode;
+    // Same name, so the per-mode theme and configuration apply.
+    snapshot->name = g_strdup(mode->name);
+    g_strlcpy(snapshot->cfg_name_key, mode->cfg_name_key,
+              sizeof(snapshot->cfg_name_key));
+    snapshot->display_name = g_strdup(mode->display_name);
+    mode_set_private_data(snapshot, pd);
+    TICK_N("Startup snapshot loaded");
+  }
+  g_strfreev(display);
+  g_strfreev(icons);
+  g_strfreev(completion);
+  g_strfreev(identity);
+  g_free(states);
+  return snapshot;
+}
+
+unsigned int startup_snapshot_map_line(const Mode *snapshot, const Mode *mode,
+                                       unsigned int selected_line) {
+  const StartupSnapshotModePrivateData *pd =
+      (const StartupSnapshotModePrivateData *)mode_get_private_data(snapshot);
+  unsigned int num_entries = mode_get_num_entries(mode);
+  if (pd == NULL || selected_line >= pd->num_rows || num_entries == 0) {
+    return UINT32_MAX;
+  }
+  const char *identity = pd->rows[selected_line].identity;
+  // Start where the row was, it usually did not move.
+  for (unsigned int n = 0; n < num_entries; n++) {
+    unsigned int i = (selected_line + n) % num_entries;
+    char *row_identity = mode_get_identity(mode, i);
+    gboolean found = g_strcmp0(row_identity, identity) == 0;
+    g_free(row_identity);
+    if (found) {
+      return i;
+    }
+  }
+  return UINT32_MAX;
+}
+
+void startup_snapshot_free(Mode *snapshot) {
+  if (snapshot == NULL) {
+    return;
+  }
+  mode_destroy(snapshot);
+  g_free(snapshot->name);
+  g_free(snapshot->display_name);
+  g_free(snapshot);
+}
@@ -1084,7 +1084,7 @@ void rofi_theme_get_color(const widget *widget, const char *property,
 
 static gboolean rofi_theme_get_image_inside(Property *p, const widget *widget,
                                             const char *property, cairo_t *d) {
-  const guint scale = disp_scale ? disp_scale() : 1;
+  const double scale = disp_scale ? disp_scale() : 1;
   if (p) {
     if (p->type == P_INHERIT) {
       if (widget->parent) {
@@ -1116,13 +1116,17 @@ static gboolean rofi_theme_get_image_inside(Property *p, const widget *widget,
       }
       // FIXME: cache when hsize, wsize and scale do not change without modifying
       // RofiImage (for ABI compatibility)
-      p->value.image.surface_id =
+      // The property and the image are shared between rows that can be drawn
+      // on different threads, so neither is modified here.
+      uint32_t surface_id =
           rofi_icon_fetcher_query_advanced(p->value.image.url, wsize, hsize);
-      cairo_surface_t *img = rofi_icon_fetcher_get(p->value.image.surface_id);
+      cairo_surface_t *img = rofi_icon_fetcher_get(surface_id);
 
       if (img != NULL) {
         cairo_pattern_t *pat = cairo_pattern_create_for_surface(img);
-        cairo_surface_set_device_scale(img, scale, scale);
+        cairo_matrix_t matrix;
+        cairo_matrix_init_scale(&matrix, scale, scale);
+        cairo_pattern_set_matrix(pat, &matrix);
         cairo_pattern_set_extend(pat, CAIRO_EXTEND_REPEAT);
         cairo_set_source(d, pat);
         cairo_pattern_destroy(pat);
@@ -87,6 +87,8 @@ struct _rofi_view_cache_state CacheState = {
     .entry_history = NULL,
     .entry_history_length = 0,
     .entry_history_index = 0,
+    .data_generation = 0,
+    .pending_motion = {.x = 0, .y = 0, .find_mouse_target = FALSE, .source = 0},
 };
 
 static char *get_matching_state(void) {
@@ -261,7 +263,9 @@ void rofi_view_set_selected_line(RofiViewState *state,
 #endif
 }
 
+static void rofi_view_filter_scan_stop(RofiViewState *state);
 void rofi_view_free(RofiViewState *state) {
+  rofi_view_filter_scan_stop(state);
   if (state->tokens) {
     helper_tokenize_free(state->tokens);
     state->tokens = NULL;
@@ -272,6 +276,10 @@ void rofi_view_free(RofiViewState *state) {
 
   g_free(state->line_map);
   g_free(state->distance);
+  g_free(state->filter_text);
+  if (state->mode_snapshots) {
+    g_hash_table_destroy(state->mode_snapshots);
+  }
   // Free the switcher boxes.
   // When state is free'ed we should no longer need these.
   g_free(state->modes);
@@ -287,6 +295,12 @@ unsigned int rofi_view_get_selected_line(const RofiViewState *state) {
   return state->selected_line;
 }
 
+const unsigned int *rofi_view_get_filtered_line_map(const RofiViewState *state,
+                                                    unsigned int *length) {
+  *length = state->filtered_lines;
+  return state->line_map;
+}
+
 unsigned int rofi_view_get_next_position(const RofiViewState *state) {
   unsigned int next_pos = state->selected_line;
   unsigned int selected = listview_get_selected(state->list_view);
@@ -302,7 +316,7 @@ unsigned int rofi_view_get_completed(const RofiViewState *state) {
 
 const char *rofi_view_get_user_input(const RofiViewState *state) {
   if (state->text) {
-    return state->text->text;
+    return textbox_peek_text(state->text);
   }
   return NULL;
 }
@@ -338,6 +352,8 @@ typedef struct _thread_state_view {
   unsigned int stop;
   /** Rows processed. */
   unsigned int count;
+  /** If set, the rows to process are listed in line_map[start, stop). */
+  gboolean candidates;
 
   /** Pattern input to filter. */
   const char *pattern;
@@ -358,7 +374,9 @@ static void rofi_view_call_thread(gpointer data, gpointer user_data) {
 static void filter_elements(thread_state *ts,
                             G_GNUC_UNUSED gpointer user_data) {
   thread_state_view *t = (thread_state_view *)ts;
-  for (unsigned int i = t->start; i < t->stop; i++) {
+  for (unsigned int n = t->start; n < t->stop; n++) {
+    // Matches are compacted in place, never ahead of the candidate read.
+    unsigned int i = t->candidates ? t->state->line_map[n] : n;
     int match = mode_token_match(t->state->sw, t->state->tokens, i);
     // If each token was matched, add it to list.
     if (match) {
@@ -639,9 +657,302 @@ static void _rofi_view_reload_row(RofiViewState *state) {
   rofi_view_reload_message_bar(state);
 }
 
+/**
+ * @param state The view to update.
+ *
+ * Push a new filter result (line_map, filtered_lines) out to the widgets and
+ * resize the window to fit.
+ */
+static void rofi_view_refilter_apply(RofiViewState *state) {
+  listview_set_num_elements(state->list_view, state->filtered_lines);
+
+  if (state->tb_filtered_rows) {
+    // While rows are left to test, the count is a lower bound.
+    char *r = g_strdup_printf(
+        state->filter_scan_pos < state->filter_scan_end ? "%u+" : "%u",
+        state->filtered_lines);
+    textbox_text(state->tb_filtered_rows, r);
+    g_free(r);
+  }
+  if (state->tb_total_rows) {
+    char *r = g_strdup_printf("%u", state->num_lines);
+    textbox_text(state->tb_total_rows, r);
+    g_free(r);
+  }
+  TICK_N("Update filter lines");
+
+  if (config.auto_select == TRUE && state->filtered_lines == 1 &&
+      state->num_lines > 1) {
+    (state->selected_line) =
+        state->line_map[listview_get_selected(state->list_view)];
+    state->retv = MENU_OK;
+    state->quit = TRUE;
+  }
+
+  // Size the window.
+  int height = rofi_view_calculate_window_height(state);
+  if (height != state->height) {
+    state->height = height;
+    rofi_view_calculate_window_position(state);
+    rofi_view_window_update_size(state);
+    g_debug("Resize based on re-filter");
+  }
+  TICK_N("Filter resize window based on window ");
+  state->refilter = FALSE;
+  TICK_N("Filter done");
+  rofi_view_update(state, TRUE);
+}
+
+/** Only use the prefix index of a mode from this many lines on. */
+#define ROFI_VIEW_PREFIX_INDEX_MIN_LINES 1000
+
+/**
+ * @param state The Menu Handle
+ * @param pattern The (preprocessed) user input.
+ * @param num_rows Set to the number of candidates.
+ *
+ * In prefix matching mode, use the prefix index of the mode to fill line_map
+ * with the entries that can match, instead of testing every entry.
+ *
+ * @returns TRUE if line_map holds the candidates.
+ */
+static gboolean rofi_view_prefix_candidates(RofiViewState *state,
+                                            const char *pattern,
+                                            unsigned int *num_rows) {
+  if (config.matching_method != MM_PREFIX || config.normalize_match ||
+      state->num_lines < ROFI_VIEW_PREFIX_INDEX_MIN_LINES) {
+    return FALSE;
+  }
+  RofiPrefixIndex *index = mode_get_prefix_index(state->sw);
+  if (index == NULL) {
+    return FALSE;
+  }
+  unsigned int *entries = NULL;
+  unsigned int length = 0;
+  if (!rofi_prefix_index_lookup(index, pattern, &entries, &length)) {
+    return FALSE;
+  }
+  unsigned int covered =
+      MIN(rofi_prefix_index_get_length(index), state->num_lines);
+  unsigned int n = 0;
+  for (unsigned int i = 0; i < length && entries[i] < covered; i++) {
+    state->line_map[n++] = entries[i];
+  }
+  // Entries added after the index was built are always tested.
+  for (unsigned int i = covered; i < state->num_lines; i++) {
+    state->line_map[n++] = i;
+  }
+  g_free(entries);
+  *num_rows = n;
+  return TRUE;
+}
+
+/**
+ * @param state The Menu Handle
+ * @param start The first row to test.
+ * @param stop The row to stop at.
+ * @param candidates If set, the rows to test are listed in line_map.
+ * @param pattern The (preprocessed) user input, used for sorting.
+ * @param plen The length of pattern.
+ *
+ * Test the rows, in parallel on long ranges. The matches are compacted into
+ * line_map from start on, in row order.
+ *
+ * @returns the number of matches.
+ */
+static unsigned int rofi_view_filter_range(RofiViewState *state,
+                                           unsigned int start,
+                                           unsigned int stop,
+                                           gboolean candidates,
+                                           const char *pattern, glong plen) {
+  unsigned int num_rows = stop - start;
+  unsigned int j = start;
+  /**
+   * On long lists it can be beneficial to parallelize.
+   * If number of threads is 1, no thread is spawn.
+   * If number of threads > 1 and there are enough (> 1000) items, spawn jobs
+   * for the thread pool. For large lists with 8 threads I see a factor three
+   * speedup of the whole function.
+   */
+  unsigned int nt = MAX(1, num_rows / 500);
+  // Limit the number of jobs, it could cause stack overflow if we don´t
+  // limit.
+  nt = MIN(nt, config.threads * 4);
+  thread_state_view states[nt];
+  GCond cond;
+  GMutex mutex;
+  g_mutex_init(&mutex);
+  g_cond_init(&cond);
+  unsigned int count = nt;
+  unsigned int steps = (num_rows + nt) / nt;
+  for (unsigned int i = 0; i < nt; i++) {
+    states[i].state = state;
+    states[i].start = start + MIN(num_rows, i * steps);
+    states[i].stop = start + MIN(num_rows, (i + 1) * steps);
+    states[i].count = 0;
+    states[i].candidates = candidates;
+    states[i].cond = &cond;
+    states[i].mutex = &mutex;
+    states[i].acount = &count;
+    states[i].plen = plen;
+    states[i].pattern = pattern;
+    states[i].st.callback = filter_elements;
+    if (i > 0) {
+      g_thread_pool_push(tpool, &states[i], NULL);
+    }
+  }
+  // Run one in this thread.
+  rofi_view_call_thread(&states[0], NULL);
+  // No need to do this with only one thread.
+  if (nt > 1) {
+    g_mutex_lock(&mutex);
+    while (count > 0) {
+      g_cond_wait(&cond, &mutex);
+    }
+    g_mutex_unlock(&mutex);
+  }
+  g_cond_clear(&cond);
+  g_mutex_clear(&mutex);
+  for (unsigned int i = 0; i < nt; i++) {
+    if (j != states[i].start) {
+      memmove(&(state->line_map[j]), &(state->line_map[states[i].start]),
+              sizeof(unsigned int) * (states[i].count));
+    }
+    j += states[i].count;
+  }
+  return j - start;
+}
+
+/** Unsorted lists from this many rows on are filtered lazily. */
+#define ROFI_VIEW_LAZY_FILTER_MIN_LINES 10000
+/** Pages to fill before the rest is left to the background: the visible
+ * page plus one to scroll into. */
+#define ROFI_VIEW_LAZY_FILTER_PAGES 2
+/** Rows tested in the first block, doubled for each next block. */
+#define ROFI_VIEW_LAZY_FILTER_BLOCK 1024
+/** Rows tested per step in the background. */
+#define ROFI_VIEW_LAZY_FILTER_CHUNK 65536
+
+static void rofi_view_refilter_apply(RofiViewState *state);
+
+static void rofi_view_filter_scan_stop(RofiViewState *state) {
+  if (state->filter_scan_source != 0) {
+    g_source_remove(state->filter_scan_source);
+    state->filter_scan_source = 0;
+  }
+  state->filter_scan_pos = 0;
+  state->filter_scan_end = 0;
+}
+
+/**
+ * @param state The Menu Handle
+ * @param rows The maximum number of rows to test.
+ *
+ * Test the next rows of a lazy filter and append the matches to the result.
+ *
+ * @returns TRUE if rows are left to test.
+ */
+static gboolean rofi_view_filter_scan_step(RofiViewState *state,
+                                           unsigned int rows) {
+  unsigned int pos = state->filter_scan_pos;
+  unsigned int stop = state->filter_scan_end;
+  if (stop - pos > rows) {
+    stop = pos + rows;
+  }
+  unsigned int count = rofi_view_filter_range(
+      state, pos, stop, state->filter_scan_candidates, NULL, 0);
+  if (count > 0 && state->filtered_lines != pos) {
+    memmove(&(state->line_map[state->filtered_lines]),
+            &(state->line_map[pos]), sizeof(unsigned int) * count);
+  }
+  state->filtered_lines += count;
+  state->filter_scan_pos = stop;
+  if (count > 0 || stop == state->filter_scan_end) {
+    rofi_view_refilter_apply(state);
+  }
+  return state->filter_scan_pos < state->filter_scan_end;
+}
+
+static gboolean rofi_view_filter_scan_idle(gpointer data) {
+  RofiViewState *state = (RofiViewState *)data;
+  // A refilter is pending, it starts over.
+  if (state->refilter || state->reload ||
+      mode_get_num_entries(state->sw) < state->num_lines) {
+    state->filter_scan_source = 0;
+    return G_SOURCE_REMOVE;
+  }
+  if (rofi_view_filter_scan_step(state, ROFI_VIEW_LAZY_FILTER_CHUNK)) {
+    return G_SOURCE_CONTINUE;
+  }
+  TICK_N("Filter background done");
+  state->filter_scan_source = 0;
+  return G_SOURCE_REMOVE;
+}
+
+/**
+ * @param state The Menu Handle
+ *
+ * Test the rows a lazy filter has left, so the result is complete.
+ */
+static void rofi_view_filter_scan_finish(RofiViewState *state) {
+  if (state->filter_scan_source == 0) {
+    return;
+  }
+  g_source_remove(state->filter_scan_source);
+  state->filter_scan_source = 0;
+  if (state->refilter || state->reload) {
+    // A refilter is pending, it starts over.
+    rofi_view_filter_scan_stop(state);
+    return;
+  }
+  rofi_view_filter_scan_step(state, G_MAXUINT);
+}
+
+/**
+ * @param state The Menu Handle
+ * @param num_rows The number of rows to test.
+ * @param candidates If set, the rows to test are listed in line_map.
+ *
+ * Without sorting the result is in row order, so the rows after the last
+ * match shown are not needed to draw. Test rows in growing blocks until the
+ * first pages are filled and leave the rest to the background.
+ *
+ * @returns the number of matches found.
+ */
+static unsigned int rofi_view_filter_first_pages(RofiViewState *state,
+                                                 unsigned int num_rows,
+                                                 gboolean candidates) {
+  unsigned int needed = MAX(listview_get_page_size(state->list_view), 1) *
+                        ROFI_VIEW_LAZY_FILTER_PAGES;
+  unsigned int block = ROFI_VIEW_LAZY_FILTER_BLOCK;
+  unsigned int pos = 0, j = 0;
+  while (pos < num_rows && j < needed) {
+    unsigned int stop = (num_rows - pos > block) ? pos + block : num_rows;
+    unsigned int count =
+        rofi_view_filter_range(state, pos, stop, candidates, NULL, 0);
+    if (count > 0 && j != pos) {
+      memmove(&(state->line_map[j]), &(state->line_map[pos]),
+              sizeof(unsigned int) * count);
+    }
+    j += count;
+    pos = stop;
+    block = MIN(block * 2, ROFI_VIEW_LAZY_FILTER_CHUNK);
+  }
+  if (pos < num_rows) {
+    state->filter_scan_pos = pos;
+    state->filter_scan_end = num_rows;
+    state->filter_scan_candidates = candidates;
+    state->filter_scan_source =
+        g_idle_add_full(G_PRIORITY_LOW, rofi_view_filter_scan_idle, state,
+                        NULL);
+  }
+  return j;
+}
+
 static gboolean rofi_view_refilter_real(RofiViewState *state) {
   CacheState.refilter_timeout = 0;
   CacheState.refilter_timeout_count = 0;
+  rofi_view_filter_scan_stop(state);
   if (state->sw == NULL) {
     return G_SOURCE_REMOVE;
   }
@@ -657,64 +968,26 @@ static gboolean rofi_view_refilter_real(RofiViewState *state) {
     state->tokens = NULL;
   }
   TICK_N("Filter tokenize");
-  if (state->text && strlen(state->text->text) > 0) {
+  g_free(state->filter_text);
+  state->filter_text =
+      g_strdup(state->text ? textbox_peek_text(state->text) : "");
+  state->filter_generation = g_atomic_int_get(&CacheState.data_generation);
+  if (state->filter_text[0] != '\0') {
 
     listview_set_filtered(state->list_view, TRUE);
     unsigned int j = 0;
-    gchar *pattern = mode_preprocess_input(state->sw, state->text->text);
+    gchar *pattern = mode_preprocess_input(state->sw, state->filter_text);
     glong plen = pattern ? g_utf8_strlen(pattern, -1) : 0;
     state->tokens = helper_tokenize(pattern, config.case_sensitive);
-    /**
-     * On long lists it can be beneficial to parallelize.
-     * If number of threads is 1, no thread is spawn.
-     * If number of threads > 1 and there are enough (> 1000) items, spawn jobs
-     * for the thread pool. For large lists with 8 threads I see a factor three
-     * speedup of the whole function.
-     */
-    unsigned int nt = MAX(1, state->num_lines / 500);
-    // Limit the number of jobs, it could cause stack overflow if we don´t
-    // limit.
-    nt = MIN(nt, config.threads * 4);
-    thread_state_view states[nt];
-    GCond cond;
-    GMutex mutex;
-    g_mutex_init(&mutex);
-    g_cond_init(&cond);
-    unsigned int count = nt;
-    unsigned int steps = (state->num_lines + nt) / nt;
-    for (unsigned int i = 0; i < nt; i++) {
-      states[i].state = state;
-      states[i].start = i * steps;
-      states[i].stop = MIN(state->num_lines, (i + 1) * steps);
-      states[i].count = 0;
-      states[i].cond = &cond;
-      states[i].mutex = &mutex;
-      states[i].acount = &count;
-      states[i].plen = plen;
-      states[i].pattern = pattern;
-      states[i].st.callback = filter_elements;
-      if (i > 0) {
-        g_thread_pool_push(tpool, &states[i], NULL);
-      }
-    }
-    // Run one in this thread.
-    rofi_view_call_thread(&states[0], NULL);
-    // No need to do this with only one thread.
-    if (nt > 1) {
-      g_mutex_lock(&mutex);
-      while (count > 0) {
-        g_cond_wait(&cond, &mutex);
-      }
-      g_mutex_unlock(&mutex);
-    }
-    g_cond_clear(&cond);
-    g_mutex_clear(&mutex);
-    for (unsigned int i = 0; i < nt; i++) {
-      if (j != states[i].start) {
-        memmove(&(state->line_map[j]), &(state->line_map[states[i].start]),
-                sizeof(unsigned int) * (states[i].count));
-      }
-      j += states[i].count;
+    unsigned int num_rows = state->num_lines;
+    gboolean candidates =
+        rofi_view_prefix_candidates(state, pattern, &num_rows);
+    TICK_N("Filter candidates");
+    if (!config.sort && num_rows >= ROFI_VIEW_LAZY_FILTER_MIN_LINES) {
+      j = rofi_view_filter_first_pages(state, num_rows, candidates);
+    } else {
+      j = rofi_view_filter_range(state, 0, num_rows, candidates, pattern,
+                                 plen);
     }
     if (config.sort) {
       g_qsort_with_data(state->line_map, j, sizeof(int), lev_sort,
@@ -736,40 +1009,7 @@ static gboolean rofi_view_refilter_real(RofiViewState *state) {
     state->filtered_lines = state->num_lines;
   }
   TICK_N("Filter matching done");
-  listview_set_num_elements(state->list_view, state->filtered_lines);
-
-  if (state->tb_filtered_rows) {
-    char *r = g_strdup_printf("%u", state->filtered_lines);
-    textbox_text(state->tb_filtered_rows, r);
-    g_free(r);
-  }
-  if (state->tb_total_rows) {
-    char *r = g_strdup_printf("%u", state->num_lines);
-    textbox_text(state->tb_total_rows, r);
-    g_free(r);
-  }
-  TICK_N("Update filter lines");
-
-  if (config.auto_select == TRUE && state->filtered_lines == 1 &&
-      state->num_lines > 1) {
-    (state->selected_line) =
-        state->line_map[listview_get_selected(state->list_view)];
-    state->retv = MENU_OK;
-    state->quit = TRUE;
-  }
-
-  // Size the window.
-  int height = rofi_view_calculate_window_height(state);
-  if (height != state->height) {
-    state->height = height;
-    rofi_view_calculate_window_position(state);
-    rofi_view_window_update_size(state);
-    g_debug("Resize based on re-filter");
-  }
-  TICK_N("Filter resize window based on window ");
-  state->refilter = FALSE;
-  TICK_N("Filter done");
-  rofi_view_update(state, TRUE);
+  rofi_view_refilter_apply(state);
 
   g_timer_destroy(timer);
   return G_SOURCE_REMOVE;
@@ -782,7 +1022,7 @@ void rofi_view_refilter(RofiViewState *state) {
     CacheState.refilter_timeout = 0;
   }
   if (CacheState.max_refilter_time > (config.refilter_timeout_limit / 1000.0) &&
-      state->text && strlen(state->text->text) > 0 &&
+      state->text && textbox_peek_text(state->text)[0] != '\0' &&
       CacheState.refilter_timeout_count < 25) {
     if (CacheState.delayed_mode == FALSE) {
       g_warning(
@@ -794,7 +1034,7 @@ void rofi_view_refilter(RofiViewState *state) {
         g_timeout_add(200, (GSourceFunc)rofi_view_refilter_real, state);
   } else {
     if (CacheState.delayed_mode == TRUE && state->text &&
-        strlen(state->text->text) > 0 &&
+        textbox_peek_text(state->text)[0] != '\0' &&
         CacheState.refilter_timeout_count < 25) {
       g_warning(
           "Filtering took %f seconds , switching back to instant filter\n",
@@ -812,6 +1052,8 @@ static void rofi_view_refilter_force(RofiViewState *state) {
   if (state->refilter) {
     rofi_view_refilter_real(state);
   }
+  // Act on the complete result.
+  rofi_view_filter_scan_finish(state);
 }
 /**
  * @param state The Menu Handle
@@ -890,8 +1132,8 @@ static void rofi_view_trigger_global_action(KeyBindingAction action) {
     unsigned int selected = listview_get_selected(state->list_view);
     if (selected < state->filtered_lines) {
       data = mode_get_completion(state->sw, state->line_map[selected]);
-    } else if (state->text && state->text->text) {
-      data = g_strdup(state->text->text);
+    } else if (state->text) {
+      data = textbox_get_text(state->text);
     }
     if (data) {
 #ifdef ENABLE_XCB
@@ -1131,6 +1373,22 @@ static void rofi_view_trigger_global_action(KeyBindingAction action) {
     state->quit = TRUE;
     break;
   }
+  case SELECT_ALL:
+  case SELECT_INVERT: {
+    if ((state->menu_flags & MENU_MULTI_SELECT) == 0) {
+      break;
+    }
+    rofi_view_refilter_force(state);
+    unsigned int selected = listview_get_selected(state->list_view);
+    state->selected_line = UINT32_MAX;
+    if (selected < state->filtered_lines) {
+      (state->selected_line) = state->line_map[selected];
+    }
+    state->retv =
+        (action == SELECT_ALL) ? MENU_SELECT_ALL : MENU_SELECT_INVERT;
+    state->quit = TRUE;
+    break;
+  }
   case ENTRY_HISTORY_DOWN: {
     if (CacheState.entry_history_enable && state->text) {
       CacheState.entry_history[CacheState.entry_history_index].index =
@@ -1318,6 +1576,40 @@ void rofi_view_handle_mouse_motion(RofiViewState *state, gint x, gint y,
   }
 }
 
+/** Priority of the pending motion source, it runs before the repaint. */
+#define ROFI_VIEW_MOTION_PRIORITY (G_PRIORITY_HIGH_IDLE - 10)
+
+static gboolean rofi_view_mouse_motion_idle(G_GNUC_UNUSED gpointer data) {
+  CacheState.pending_motion.source = 0;
+  RofiViewState *state = rofi_view_get_active();
+  if (state != NULL) {
+    rofi_view_handle_mouse_motion(state, CacheState.pending_motion.x,
+                                  CacheState.pending_motion.y,
+                                  CacheState.pending_motion.find_mouse_target);
+    rofi_view_maybe_update(state);
+  }
+  return G_SOURCE_REMOVE;
+}
+
+void rofi_view_queue_mouse_motion(gint x, gint y, gboolean find_mouse_target) {
+  CacheState.pending_motion.x = x;
+  CacheState.pending_motion.y = y;
+  CacheState.pending_motion.find_mouse_target = find_mouse_target;
+  if (CacheState.pending_motion.source == 0) {
+    CacheState.pending_motion.source =
+        g_idle_add_full(ROFI_VIEW_MOTION_PRIORITY, rofi_view_mouse_motion_idle,
+                        NULL, NULL);
+  }
+}
+
+void rofi_view_flush_mouse_motion(void) {
+  if (CacheState.pending_motion.source == 0) {
+    return;
+  }
+  g_source_remove(CacheState.pending_motion.source);
+  rofi_view_mouse_motion_idle(NULL);
+}
+
 WidgetTriggerActionResult textbox_button_trigger_action(
     widget *wid, MouseBindingMouseDefaultAction action, G_GNUC_UNUSED gint x,
     G_GNUC_UNUSED gint y, G_GNUC_UNUSED void *user_data) {
@@ -1800,7 +2092,138 @@ void rofi_view_ellipsize_listview(RofiViewState *state,
   listview_set_ellipsize(state->list_view, mode);
 }
 
+/**
+ * Filter result of a mode, retained when switching away from it.
+ */
+typedef struct {
+  /** Input the result was computed for. */
+  char *text;
+  /** #CacheState data_generation the result was computed at. */
+  gint generation;
+  /** Matching settings the result depends on. */
+  unsigned int case_sensitive;
+  unsigned int sort;
+  MatchingMethod matching_method;
+  /** Number of (unfiltered) entries in the mode. */
+  unsigned int num_lines;
+  /** Number of (filtered) entries in line_map. */
+  unsigned int filtered_lines;
+  /** Translation between filtered and unfiltered list, filtered_lines long. */
+  unsigned int *line_map;
+  /** Selected row in the filtered list. */
+  unsigned int selected;
+} RofiViewModeSnapshot;
+
+static void rofi_view_mode_snapshot_free(gpointer data) {
+  RofiViewModeSnapshot *snapshot = (RofiViewModeSnapshot *)data;
+  g_free(snapshot->text);
+  g_free(snapshot->line_map);
+  g_free(snapshot);
+}
+
+/**
+ * @param state The view switching away from its current mode.
+ *
+ * Copy the filter result of the current mode into a snapshot.
+ */
+static void rofi_view_mode_snapshot_save(RofiViewState *state) {
+  if (state->sw == NULL || state->refilter || state->reload ||
+      state->filter_text == NULL || state->line_map == NULL ||
+      state->filter_scan_pos < state->filter_scan_end) {
+    return;
+  }
+  if (state->mode_snapshots == NULL) {
+    state->mode_snapshots = g_hash_table_new_full(
+        g_direct_hash, g_direct_equal, NULL, rofi_view_mode_snapshot_free);
+  }
+  RofiViewModeSnapshot *snapshot = g_malloc0(sizeof(*snapshot));
+  snapshot->text = g_strdup(state->filter_text);
+  snapshot->generation = state->filter_generation;
+  snapshot->case_sensitive = config.case_sensitive;
+  snapshot->sort = config.sort;
+  snapshot->matching_method = config.matching_method;
+  snapshot->num_lines = state->num_lines;
+  snapshot->filtered_lines = state->filtered_lines;
+  snapshot->line_map = g_malloc_n(state->filtered_lines, sizeof(unsigned int));
+  memcpy(snapshot->line_map, state->line_map,
+         state->filtered_lines * sizeof(unsigned int));
+  snapshot->selected = listview_get_selected(state->list_view);
+  g_hash_table_replace(state->mode_snapshots, state->sw, snapshot);
+}
+
+/**
+ * @param state The view that just switched to a new mode.
+ *
+ * Restore the filter result of the current mode, if it was computed for the
+ * current input, settings and mode data.
+ *
+ * @returns TRUE if restored and no refilter is needed.
+ */
+static gboolean rofi_view_mode_snapshot_restore(RofiViewState *state) {
+  if (state->mode_snapshots == NULL || state->sw == NULL) {
+    return FALSE;
+  }
+  RofiViewModeSnapshot *snapshot =
+      g_hash_table_lookup(state->mode_snapshots, state->sw);
+  if (snapshot == NULL) {
+    return FALSE;
+  }
+  const char *text = state->text ? textbox_peek_text(state->text) : "";
+  if (snapshot->generation != g_atomic_int_get(&CacheState.data_generation) ||
+      snapshot->case_sensitive != config.case_sensitive ||
+      snapshot->sort != config.sort ||
+      snapshot->matching_method != config.matching_method ||
+      snapshot->num_lines != mode_get_num_entries(state->sw) ||
+      g_strcmp0(snapshot->text, text) != 0) {
+    g_hash_table_remove(state->mode_snapshots, state->sw);
+    return FALSE;
+  }
+  TICK_N("Restore filter snapshot");
+  if (CacheState.refilter_timeout != 0) {
+    g_source_remove(CacheState.refilter_timeout);
+    CacheState.refilter_timeout = 0;
+  }
+  g_free(state->line_map);
+  g_free(state->distance);
+  g_free(state->filter_text);
+  state->num_lines = snapshot->num_lines;
+  state->filtered_lines = snapshot->filtered_lines;
+  state->line_map = g_malloc_n(state->num_lines, sizeof(unsigned int));
+  memcpy(state->line_map, snapshot->line_map,
+         state->filtered_lines * sizeof(unsigned int));
+  state->distance = g_malloc0_n(state->num_lines, sizeof(int));
+  state->filter_text = g_strdup(snapshot->text);
+  state->filter_generation = snapshot->generation;
+  state->reload = FALSE;
+  unsigned int selected = snapshot->selected;
+
+  listview_set_max_lines(state->list_view, state->num_lines);
+  rofi_view_reload_message_bar(state);
+
+  // Highlighting needs the tokens, the scores are not needed.
+  if (state->tokens) {
+    helper_tokenize_free(state->tokens);
+    state->tokens = NULL;
+  }
+  if (text[0] != '\0') {
+    gchar *pattern = mode_preprocess_input(state->sw, text);
+    state->tokens = helper_tokenize(pattern, config.case_sensitive);
+    g_free(pattern);
+  }
+  listview_set_filtered(state->list_view, text[0] != '\0');
+  rofi_view_refilter_apply(state);
+  listview_set_selected(state->list_view, selected);
+  return TRUE;
+}
+
 void rofi_view_switch_mode(RofiViewState *state, Mode *mode) {
+  // Reloading the same mode means its data might have changed.
+  gboolean switched = (state->sw != mode);
+  // Rows of the old mode can not be tested against the new one.
+  rofi_view_filter_scan_finish(state);
+  if (switched) {
+    rofi_view_mode_snapshot_save(state);
+  }
   state->sw = mode;
   // Update prompt;
   if (state->prompt) {
@@ -1822,12 +2245,23 @@ void rofi_view_switch_mode(RofiViewState *state, Mode *mode) {
     }
   }
   rofi_view_restart(state);
+  if (switched && rofi_view_mode_snapshot_restore(state)) {
+    return;
+  }
   state->reload = TRUE;
   state->refilter = TRUE;
   rofi_view_refilter(state);
   rofi_view_update(state, TRUE);
 }
 
+void rofi_view_replace_mode(RofiViewState *state, Mode *mode) {
+  Mode *old = state->sw;
+  rofi_view_switch_mode(state, mode);
+  if (state->mode_snapshots != NULL && old != NULL) {
+    g_hash_table_remove(state->mode_snapshots, old);
+  }
+}
+
 /** ------ */
 
 void rofi_view_update(RofiViewState *state, gboolean qr) {
@@ -1879,6 +2313,12 @@ void rofi_view_hide(void) { proxy->hide(); }
 
 void rofi_view_reload(void) { proxy->reload(); }
 
+void rofi_view_data_changed(void) {
+  // Retained filter results are no longer valid.
+  g_atomic_int_inc(&CacheState.data_generation);
+  rofi_view_reload();
+}
+
 void __create_window(MenuFlags menu_flags) {
   proxy->__create_window(menu_flags);
 }
@@ -31,6 +31,7 @@
 #include <fcntl.h>
 #include <linux/input-event-codes.h>
 #include <locale.h>
+#include <string.h>
 #include <sys/mman.h>
 #include <sys/types.h>
 #include <unistd.h>
@@ -56,7 +57,9 @@
 #include "display.h"
 #include "wayland-internal.h"
 
+#include "fractional-scale-v1-protocol.h"
 #include "primary-selection-unstable-v1-protocol.h"
+#include "viewporter-protocol.h"
 #include "wlr-layer-shell-unstable-v1-protocol.h"
 
 typedef struct _display_buffer_pool wayland_buffer_pool;
@@ -80,6 +83,11 @@ struct _display_buffer_pool {
   size_t size;
   int32_t width;
   int32_t height;
+  /* Size of the surface the buffers are shown at. */
+  int32_t surface_width;
+  int32_t surface_height;
+  int32_t buffer_scale;
+  double scale;
   gboolean to_free;
   wayland_buffer *buffers;
 };
@@ -128,13 +136,35 @@ static void wayland_buffer_release(void *data, struct wl_buffer *buffer) {
 static const struct wl_buffer_listener wayland_buffer_listener = {
     wayland_buffer_release};
 
+/**
+ * The scale the buffers are drawn at: the preferred fractional scale when the
+ * compositor sent one, the integer output scale otherwise.
+ */
+static double wayland_buffer_scale(void) {
+  if (wayland->preferred_scale != 0) {
+    return wayland->preferred_scale / 120.0;
+  }
+  return wayland->scale;
+}
+
 wayland_buffer_pool *display_buffer_pool_new(gint width, gint height) {
   struct wl_shm_pool *wl_pool;
   struct wl_buffer *buffer;
   int fd;
   uint8_t *data;
-  width *= wayland->scale;
-  height *= wayland->scale;
+  int32_t surface_width = width;
+  int32_t surface_height = height;
+  int32_t buffer_scale = 1;
+  if (wayland->preferred_scale != 0) {
+    // The buffer is mapped onto the surface by the viewport, its size is
+    // rounded half away from zero as the protocol asks.
+    width = (width * wayland->preferred_scale + 60) / 120;
+    height = (height * wayland->preferred_scale + 60) / 120;
+  } else {
+    buffer_scale = wayland->scale;
+    width *= wayland->scale;
+    height *= wayland->scale;
+  }
   int32_t stride;
   size_t size;
   size_t pool_size;
@@ -174,6 +204,10 @@ wayland_buffer_pool *display_buffer_pool_new(gint width, gint height) {
 
   pool->width = width;
   pool->height = height;
+  pool->surface_width = surface_width;
+  pool->surface_height = surface_height;
+  pool->buffer_scale = buffer_scale;
+  pool->scale = wayland_buffer_scale();
 
   pool->buffers = g_new0(wayland_buffer, wayland->buffer_count);
 
@@ -202,6 +236,16 @@ void display_buffer_pool_free(wayland_buffer_pool *self) {
   wayland_buffer_cleanup(self);
 }
 
+static void wayland_scale_changed(void) {
+  // create new buffers with the correct scaled size
+  rofi_view_pool_refresh();
+
+  RofiViewState *state = rofi_view_get_active();
+  if (state != NULL) {
+    rofi_view_set_size(state, -1, -1);
+  }
+}
+
 static void wayland_surface_protocol_enter(void *data,
                                            struct wl_surface *wl_surface,
                                            struct wl_output *wl_output) {
@@ -212,17 +256,12 @@ static void wayland_surface_protocol_enter(void *data,
     return;
   }
 
-  wl_surface_set_buffer_scale(wl_surface, output->scale);
-
+  // The buffer scale is set on commit, together with the buffer it applies
+  // to. The integer scale is still tracked for the cursor.
   if (wayland->scale != output->scale) {
     wayland->scale = output->scale;
-
-    // create new buffers with the correct scaled size
-    rofi_view_pool_refresh();
-
-    RofiViewState *state = rofi_view_get_active();
-    if (state != NULL) {
-      rofi_view_set_size(state, -1, -1);
+    if (wayland->preferred_scale == 0) {
+      wayland_scale_changed();
     }
   }
 }
@@ -236,6 +275,30 @@ static const struct wl_surface_listener wayland_surface_interface = {
     .leave = wayland_surface_protocol_leave,
 };
 
+static void
+wayland_fractional_scale_preferred_scale(void *data,
+                                         struct wp_fractional_scale_v1 *scale,
+                                         uint32_t preferred_scale) {
+  if (wayland->preferred_scale == preferred_scale) {
+    return;
+  }
+  wayland->preferred_scale = preferred_scale;
+  wayland_scale_changed();
+}
+
+static const struct wp_fractional_scale_v1_listener
+    wayland_fractional_scale_listener = {
+        .preferred_scale = wayland_fractional_scale_preferred_scale,
+};
+
+static void wayland_surface_destroy(void) {
+  g_clear_pointer(&wayland->fractional_scale, wp_fractional_scale_v1_destroy);
+  g_clear_pointer(&wayland->viewport, wp_viewport_destroy);
+  wayland->preferred_scale = 0;
+  wl_surface_destroy(wayland->surface);
+  wayland->surface = NULL;
+}
+
 static void wayland_frame_callback(void *data, struct wl_callback *callback,
                                    uint32_t time);
 
@@ -262,6 +325,7 @@ display_buffer_pool_get_next_buffer(wayland_buffer_pool *pool) {
   surface = cairo_image_surface_create_for_data(
       buffer->data, CAIRO_FORMAT_ARGB32, pool->width, pool->height,
       cairo_format_stride_for_width(CAIRO_FORMAT_ARGB32, pool->width));
+  cairo_surface_set_device_scale(surface, pool->scale, pool->scale);
   cairo_surface_set_user_data(surface, &wayland_cairo_surface_user_data, buffer,
                               NULL);
   return surface;
@@ -278,10 +342,18 @@ void display_surface_commit(cairo_surface_t *surface) {
 
   cairo_surface_destroy(surface);
 
-  wl_surface_damage(wayland->surface, 0, 0, pool->width, pool->height);
+  wl_surface_damage(wayland->surface, 0, 0, pool->surface_width,
+                    pool->surface_height);
   wl_surface_attach(wayland->surface, buffer->buffer, 0, 0);
-  // FIXME: hidpi
-  wl_surface_set_buffer_scale(wayland->surface, wayland->scale);
+  wl_surface_set_buffer_scale(wayland->surface, pool->buffer_scale);
+  if (wayland->viewport != NULL) {
+    if (pool->surface_width > 0 && pool->surface_height > 0) {
+      wp_viewport_set_destination(wayland->viewport, pool->surface_width,
+                                  pool->surface_height);
+    } else {
+      wp_viewport_set_destination(wayland->viewport, -1, -1);
+    }
+  }
   buffer->released = FALSE;
 
   wl_surface_commit(wayland->surface);
@@ -309,14 +381,35 @@ static void wayland_keyboard_keymap(void *data, struct wl_keyboard *keyboard,
   }
 
   char *str = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
   if (str == MAP_FAILED) {
-    close(fd);
     return;
   }
 
-  struct xkb_keymap *keymap = xkb_keymap_new_from_string(
-      nk_bindings_seat_get_context(wayland->bindings_seat), str,
-      XKB_KEYMAP_FORMAT_TEXT_V1, XKB_KEYMAP_COMPILE_NO_FLAGS);
+  // Every seat (and every keyboard re-bind) sends the full keymap text, which
+  // is nearly always identical. Compiling it is the expensive part, so reuse
+  // the previous result when the text did not change.
+  guint hash = g_str_hash(str);
+  struct xkb_keymap *keymap = NULL;
+  if (wayland->keymap.keymap != NULL && wayland->keymap.hash == hash &&
+      wayland->keymap.size == size &&
+      memcmp(wayland->keymap.text, str, size) == 0) {
+    keymap = xkb_keymap_ref(wayland->keymap.keymap);
+  } else {
+    keymap = xkb_keymap_new_from_string(
+        nk_bindings_seat_get_context(wayland->bindings_seat), str,
+        XKB_KEYMAP_FORMAT_TEXT_V1, XKB_KEYMAP_COMPILE_NO_FLAGS);
+    if (keymap != NULL) {
+      g_free(wayland->keymap.text);
+      g_clear_pointer(&wayland->keymap.keymap, xkb_keymap_unref);
+      wayland->keymap.hash = hash;
+      wayland->keymap.size = size;
+      wayland->keymap.text = g_malloc(size);
+      memcpy(wayland->keymap.text, str, size);
+      wayland->keymap.keymap = xkb_keymap_ref(keymap);
+    }
+  }
+  munmap(str, size);
   if (keymap == NULL) {
     fprintf(stderr, "Failed to get Keymap for current keyboard device.\n");
     return;
@@ -325,10 +418,13 @@ static void wayland_keyboard_keymap(void *data, struct wl_keyboard *keyboard,
   if (state == NULL) {
     fprintf(stderr,
             "Failed to get state object for current keyboard device.\n");
+    xkb_keymap_unref(keymap);
     return;
   }
 
   nk_bindings_seat_update_keymap(wayland->bindings_seat, keymap, state);
+  xkb_state_unref(state);
+  xkb_keymap_unref(keymap);
 }
 
 static void wayland_keyboard_enter(void *data, struct wl_keyboard *keyboard,
@@ -418,6 +514,8 @@ static void wayland_keyboard_key(void *data, struct wl_keyboard *keyboard,
 
   wayland->last_seat = self;
   self->serial = serial;
+  // Key handling should see the pointer position that preceded it.
+  rofi_view_flush_mouse_motion();
 
   xkb_keycode_t keycode = key + 8;
   if (kstate == WL_KEYBOARD_KEY_STATE_RELEASED) {
@@ -540,11 +638,17 @@ static void wayland_pointer_send_events(wayland_seat *self) {
   }
 
   if (self->motion.x > -1 || self->motion.y > -1) {
-    rofi_view_handle_mouse_motion(state, self->motion.x, self->motion.y, config.hover_select);
+    rofi_view_queue_mouse_motion(self->motion.x, self->motion.y,
+                                 config.hover_select);
     self->motion.x = -1;
     self->motion.y = -1;
   }
 
+  if (self->button.button > 0 || self->wheel.vertical != 0 ||
+      self->wheel.horizontal != 0) {
+    rofi_view_flush_mouse_motion();
+  }
+
   NkBindingsMouseButton button = -1;
   switch (self->button.button) {
   case BTN_LEFT:
@@ -1051,6 +1155,15 @@ static void wayland_registry_handle_global(void *data,
     wayland->layer_shell =
         wl_registry_bind(registry, name, &zwlr_layer_shell_v1_interface,
                          MIN(version, WL_LAYER_SHELL_INTERFACE_VERSION));
+  } else if (g_strcmp0(interface, wp_viewporter_interface.name) == 0) {
+    wayland->viewporter =
+        wl_registry_bind(registry, name, &wp_viewporter_interface,
+                         MIN(version, WP_VIEWPORTER_INTERFACE_VERSION));
+  } else if (g_strcmp0(interface,
+                       wp_fractional_scale_manager_v1_interface.name) == 0) {
+    wayland->fractional_scale_manager = wl_registry_bind(
+        registry, name, &wp_fractional_scale_manager_v1_interface,
+        MIN(version, WP_FRACTIONAL_SCALE_MANAGER_INTERFACE_VERSION));
   } else if (g_strcmp0(interface, wl_shm_interface.name) == 0) {
     wayland->global_names[WAYLAND_GLOBAL_SHM] = name;
     wayland->shm = wl_registry_bind(registry, name, &wl_shm_interface,
@@ -1175,8 +1288,7 @@ static void
 wayland_layer_shell_surface_closed(void *data,
                                    struct zwlr_layer_surface_v1 *surface) {
   zwlr_layer_surface_v1_destroy(surface);
-  wl_surface_destroy(wayland->surface);
-  wayland->surface = NULL;
+  wayland_surface_destroy();
 }
 
 static const struct zwlr_layer_surface_v1_listener
@@ -1271,6 +1383,17 @@ static gboolean wayland_display_setup(GMainLoop *main_loop,
   }
 
   wayland->surface = wl_compositor_create_surface(wayland->compositor);
+  if (wayland->viewporter != NULL &&
+      wayland->fractional_scale_manager != NULL) {
+    wayland->viewport =
+        wp_viewporter_get_viewport(wayland->viewporter, wayland->surface);
+    wayland->fractional_scale =
+        wp_fractional_scale_manager_v1_get_fractional_scale(
+            wayland->fractional_scale_manager, wayland->surface);
+    wp_fractional_scale_v1_add_listener(wayland->fractional_scale,
+                                        &wayland_fractional_scale_listener,
+                                        NULL);
+  }
 
   wayland->bindings_seat = nk_bindings_seat_new(bindings, XKB_CONTEXT_NO_FLAGS);
 
@@ -1384,10 +1507,15 @@ static void wayland_display_cleanup(void) {
   }
 
   if (wayland->surface != NULL) {
-    wl_surface_destroy(wayland->surface);
+    wayland_surface_destroy();
   }
+  g_clear_pointer(&wayland->fractional_scale_manager,
+                  wp_fractional_scale_manager_v1_destroy);
+  g_clear_pointer(&wayland->viewporter, wp_viewporter_destroy);
 
   nk_bindings_seat_free(wayland->bindings_seat);
+  g_clear_pointer(&wayland->keymap.keymap, xkb_keymap_unref);
+  g_free(wayland->keymap.text);
   g_hash_table_unref(wayland->seats_by_name);
   g_hash_table_unref(wayland->seats);
   g_hash_table_unref(wayland->outputs);
@@ -1416,7 +1544,7 @@ static const struct _view_proxy *wayland_display_view_proxy(void) {
   return wayland_view_proxy;
 }
 
-static guint wayland_display_scale(void) { return wayland->scale; }
+static double wayland_display_scale(void) { return wayland_buffer_scale(); }
 
 static char *wayland_get_clipboard_data(int type) {
   switch (type) {
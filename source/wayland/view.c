@@ -338,8 +338,6 @@ static void wayland_rofi_view_update(RofiViewState *state, gboolean qr) {
   cairo_set_operator(d, CAIRO_OPERATOR_SOURCE);
   // Paint the background transparent.
   cairo_set_source_rgba(d, 0, 0, 0, 0.0);
-  guint scale = display_scale();
-  cairo_surface_set_device_scale(surface, scale, scale);
   cairo_paint(d);
   TICK_N("Background");
 
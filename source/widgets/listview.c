@@ -27,6 +27,8 @@
 
 #include "config.h"
 #include <glib.h>
+#include <math.h>
+#include <string.h>
 #include <widgets/box.h>
 #include <widgets/icon.h>
 #include <widgets/listview.h>
@@ -34,6 +36,7 @@
 #include <widgets/textbox.h>
 #include <widgets/widget.h>
 
+#include "rofi-types.h"
 #include "settings.h"
 #include "theme.h"
 #include "view.h"
@@ -43,6 +46,9 @@
 /** Default spacing between the elements in the listview. */
 #define DEFAULT_SPACING 2
 
+/** Minimum number of visible rows to draw them on the thread pool. */
+#define LISTVIEW_PARALLEL_MIN_ROWS 4
+
 /**
  * Orientation of the listview
  */
@@ -124,6 +130,22 @@ struct _listview {
   char *listview_name;
 
   PangoEllipsizeMode emode;
+  /** Row rectangles of the last drawn frame, used for hit-testing. */
+  struct {
+    /** x, y, w, h for each visible row. */
+    int *rects;
+    /** Number of rows in rects, 0 if it needs rebuilding. */
+    unsigned int length;
+    /** Row that was hit last. */
+    unsigned int last;
+  } hit_map;
+  /** Image surfaces the rows are drawn in on the thread pool. */
+  struct {
+    /** Surface per visible row, reused between frames. */
+    cairo_surface_t **surfaces;
+    /** Number of entries in surfaces. */
+    unsigned int length;
+  } row_cache;
   /** Barview */
   struct {
     MoveDirection direction;
@@ -251,6 +273,13 @@ static void listview_free(widget *wid) {
     widget_free(WIDGET(lv->boxes[i].box));
   }
   g_free(lv->boxes);
+  g_free(lv->hit_map.rects);
+  for (unsigned int i = 0; i < lv->row_cache.length; i++) {
+    if (lv->row_cache.surfaces[i] != NULL) {
+      cairo_surface_destroy(lv->row_cache.surfaces[i]);
+    }
+  }
+  g_free(lv->row_cache.surfaces);
 
   g_free(lv->listview_name);
   widget_free(WIDGET(lv->scrollbar));
@@ -414,6 +443,242 @@ static void barview_draw(widget *wid, cairo_t *draw) {
   }
 }
 
+/**
+ * The visible rows of one frame, drawn concurrently into image surfaces.
+ *
+ * The main thread and the helpers pushed on the thread pool claim rows until
+ * none are left. The main thread only waits for claimed rows to finish, a
+ * helper that is started late finds no work and drops its reference.
+ */
+typedef struct {
+  /** Generic thread state, the batch is pushed once per helper. */
+  thread_state st;
+  /** One reference per helper and one for the main thread. */
+  gint ref;
+  /** Lock for done. */
+  GMutex mutex;
+  /** Signalled when a row is done. */
+  GCond cond;
+  /** The next row to claim. */
+  gint next;
+  /** Number of rows done. */
+  unsigned int done;
+  /** Number of rows. */
+  unsigned int length;
+  /** The surface the listview is drawn on. */
+  cairo_surface_t *target;
+  /** The rows. */
+  struct {
+    /** The row widget. */
+    widget *row;
+    /** Surface covering the row. */
+    cairo_surface_t *surface;
+    /** Position of the row on target, in pixels. */
+    int px, py;
+  } *rows;
+} ListviewRowBatch;
+
+static void listview_row_batch_unref(ListviewRowBatch *batch) {
+  if (g_atomic_int_dec_and_test(&(batch->ref))) {
+    g_mutex_clear(&(batch->mutex));
+    g_cond_clear(&(batch->cond));
+    g_free(batch->rows);
+    g_free(batch);
+  }
+}
+
+static void listview_row_batch_draw_row(ListviewRowBatch *batch,
+                                        unsigned int i) {
+  cairo_surface_t *surface = batch->rows[i].surface;
+  widget *row = batch->rows[i].row;
+  // Start from what is behind the row, so it blends as if it was drawn in
+  // place.
+  cairo_surface_flush(surface);
+  int stride = cairo_image_surface_get_stride(surface);
+  int target_stride = cairo_image_surface_get_stride(batch->target);
+  int height = cairo_image_surface_get_height(surface);
+  size_t bytes = 4 * (size_t)cairo_image_surface_get_width(surface);
+  unsigned char *dst = cairo_image_surface_get_data(surface);
+  const unsigned char *src = cairo_image_surface_get_data(batch->target) +
+                             (size_t)batch->rows[i].py * target_stride +
+                             4 * (size_t)batch->rows[i].px;
+  for (int y = 0; y < height; y++) {
+    memcpy(dst + (size_t)y * stride, src + (size_t)y * target_stride, bytes);
+  }
+  cairo_surface_mark_dirty(surface);
+
+  cairo_t *d = cairo_create(surface);
+  cairo_translate(d, -row->x, -row->y);
+  widget_draw(row, d);
+  cairo_destroy(d);
+  cairo_surface_flush(surface);
+}
+
+static void listview_row_batch_run(ListviewRowBatch *batch, gboolean worker) {
+  gboolean thread_draw = FALSE;
+  gint i;
+  while ((i = g_atomic_int_add(&(batch->next), 1)) < (gint)batch->length) {
+    if (worker && !thread_draw) {
+      textbox_thread_draw_begin();
+      thread_draw = TRUE;
+    }
+    listview_row_batch_draw_row(batch, i);
+    g_mutex_lock(&(batch->mutex));
+    batch->done++;
+    g_cond_signal(&(batch->cond));
+    g_mutex_unlock(&(batch->mutex));
+  }
+  if (thread_draw) {
+    textbox_thread_draw_end();
+  }
+}
+
+static void listview_row_batch_helper(thread_state *ts,
+                                      G_GNUC_UNUSED gpointer user_data) {
+  ListviewRowBatch *batch = (ListviewRowBatch *)ts;
+  listview_row_batch_run(batch, TRUE);
+  listview_row_batch_unref(batch);
+}
+
+/**
+ * @param value The value to convert.
+ * @param out Set to @p value if it is a whole number.
+ *
+ * @returns TRUE if @p value is a whole number.
+ */
+static gboolean listview_to_pixel(double value, int *out) {
+  double r = round(value);
+  if (fabs(value - r) > 1e-6) {
+    return FALSE;
+  }
+  *out = (int)r;
+  return TRUE;
+}
+
+/**
+ * @param lv The listview.
+ * @param draw The cairo context the listview is drawn on.
+ * @param max The number of visible rows.
+ *
+ * Draw the rows on the thread pool, each in its own image surface, and copy
+ * them onto @p draw. This is only done when the rows map onto whole pixels of
+ * an image surface and do not overlap, so the result is the same as drawing
+ * them in place.
+ *
+ * @returns FALSE if the rows were not drawn.
+ */
+static gboolean listview_draw_rows_parallel(listview *lv, cairo_t *draw,
+                                            unsigned int max) {
+  if (tpool == NULL || config.threads < 2 ||
+      max < LISTVIEW_PARALLEL_MIN_ROWS) {
+    return FALSE;
+  }
+  if (distance_get_pixel(lv->spacing, ROFI_ORIENTATION_VERTICAL) < 0 ||
+      distance_get_pixel(lv->spacing, ROFI_ORIENTATION_HORIZONTAL) < 0) {
+    return FALSE;
+  }
+  cairo_surface_t *target = cairo_get_target(draw);
+  if (cairo_get_group_target(draw) != target ||
+      cairo_surface_get_type(target) != CAIRO_SURFACE_TYPE_IMAGE) {
+    return FALSE;
+  }
+  cairo_format_t format = cairo_image_surface_get_format(target);
+  if (format != CAIRO_FORMAT_ARGB32 && format != CAIRO_FORMAT_RGB24) {
+    return FALSE;
+  }
+  cairo_matrix_t ctm;
+  cairo_get_matrix(draw, &ctm);
+  if (ctm.xx != 1.0 || ctm.yy != 1.0 || ctm.xy != 0.0 || ctm.yx != 0.0) {
+    return FALSE;
+  }
+  double sx = 1.0, sy = 1.0, ox = 0.0, oy = 0.0;
+  cairo_surface_get_device_scale(target, &sx, &sy);
+  cairo_surface_get_device_offset(target, &ox, &oy);
+  const int target_width = cairo_image_surface_get_width(target);
+  const int target_height = cairo_image_surface_get_height(target);
+
+  if (lv->row_cache.length < max) {
+    lv->row_cache.surfaces = g_realloc(
+        lv->row_cache.surfaces, max * sizeof(*(lv->row_cache.surfaces)));
+    for (unsigned int i = lv->row_cache.length; i < max; i++) {
+      lv->row_cache.surfaces[i] = NULL;
+    }
+    lv->row_cache.length = max;
+  }
+
+  ListviewRowBatch *batch = g_malloc0(sizeof(*batch));
+  batch->rows = g_malloc0_n(max, sizeof(*(batch->rows)));
+  for (unsigned int i = 0; i < max; i++) {
+    widget *row = WIDGET(lv->boxes[i].box);
+    int px, py, pw, ph;
+    if (!widget_enabled(row) || row->w < 1 || row->h < 1 ||
+        !listview_to_pixel((ctm.x0 + row->x) * sx + ox, &px) ||
+        !listview_to_pixel((ctm.y0 + row->y) * sy + oy, &py) ||
+        !listview_to_pixel(row->w * sx, &pw) ||
+        !listview_to_pixel(row->h * sy, &ph) || px < 0 || py < 0 ||
+        (px + pw) > target_width || (py + ph) > target_height) {
+      g_free(batch->rows);
+      g_free(batch);
+      return FALSE;
+    }
+    cairo_surface_t *surface = lv->row_cache.surfaces[i];
+    if (surface == NULL || cairo_image_surface_get_width(surface) != pw ||
+        cairo_image_surface_get_height(surface) != ph ||
+        cairo_image_surface_get_format(surface) != format) {
+      if (surface != NULL) {
+        cairo_surface_destroy(surface);
+      }
+      surface = cairo_image_surface_create(format, pw, ph);
+      lv->row_cache.surfaces[i] = surface;
+    }
+    cairo_surface_set_device_scale(surface, sx, sy);
+    batch->rows[i].row = row;
+    batch->rows[i].surface = surface;
+    batch->rows[i].px = px;
+    batch->rows[i].py = py;
+  }
+  batch->length = max;
+  batch->target = target;
+  batch->st.callback = listview_row_batch_helper;
+  g_mutex_init(&(batch->mutex));
+  g_cond_init(&(batch->cond));
+  cairo_surface_flush(target);
+
+  unsigned int helpers = MIN((unsigned int)config.threads, max) - 1;
+  batch->ref = helpers + 1;
+  for (unsigned int i = 0; i < helpers; i++) {
+    g_thread_pool_push(tpool, batch, NULL);
+  }
+  // Draw rows here too, the helpers could be queued behind icon loading.
+  listview_row_batch_run(batch, FALSE);
+  g_mutex_lock(&(batch->mutex));
+  while (batch->done < batch->length) {
+    g_cond_wait(&(batch->cond), &(batch->mutex));
+  }
+  g_mutex_unlock(&(batch->mutex));
+
+  for (unsigned int i = 0; i < max; i++) {
+    widget *row = batch->rows[i].row;
+    cairo_save(draw);
+    cairo_set_operator(draw, CAIRO_OPERATOR_SOURCE);
+    cairo_set_source_surface(draw, batch->rows[i].surface, row->x, row->y);
+    cairo_rectangle(draw, row->x, row->y, row->w, row->h);
+    cairo_fill(draw);
+    cairo_restore(draw);
+  }
+  listview_row_batch_unref(batch);
+  return TRUE;
+}
+
+static void listview_draw_rows(listview *lv, cairo_t *draw, unsigned int max) {
+  if (listview_draw_rows_parallel(lv, draw, max)) {
+    return;
+  }
+  for (unsigned int i = 0; i < max; i++) {
+    widget_draw(WIDGET(lv->boxes[i].box), draw);
+  }
+}
+
 static void listview_draw(widget *wid, cairo_t *draw) {
   unsigned int offset = 0;
   listview *lv = (listview *)wid;
@@ -513,15 +778,14 @@ static void listview_draw(widget *wid, cairo_t *draw) {
                         lv->element_height);
         }
         update_element(lv, i, i + offset, TRUE);
-        widget_draw(WIDGET(lv->boxes[i].box), draw);
       }
       lv->rchanged = FALSE;
     } else {
       for (unsigned int i = 0; i < max; i++) {
         update_element(lv, i, i + offset, TRUE);
-        widget_draw(WIDGET(lv->boxes[i].box), draw);
       }
     }
+    listview_draw_rows(lv, draw, max);
   }
   widget_draw(WIDGET(lv->scrollbar), draw);
 }
@@ -531,6 +795,56 @@ listview_element_trigger_action(widget *wid,
                                 gint x, gint y, void *user_data);
 static gboolean listview_element_motion_notify(widget *wid, gint x, gint y);
 
+/**
+ * @param lv The listview.
+ *
+ * Store the rectangles of the visible rows as they were laid out for this
+ * frame, so pointer motion can be resolved without walking the widgets.
+ */
+static void listview_hit_map_update(listview *lv) {
+  unsigned int max = MIN(lv->cur_elements, lv->req_elements - lv->last_offset);
+  lv->hit_map.rects = g_realloc(lv->hit_map.rects, 4 * max * sizeof(int));
+  for (unsigned int i = 0; i < max; i++) {
+    const widget *w = WIDGET(lv->boxes[i].box);
+    int *r = &(lv->hit_map.rects[4 * i]);
+    r[0] = w->x;
+    r[1] = w->y;
+    r[2] = w->w;
+    r[3] = w->h;
+  }
+  lv->hit_map.length = max;
+}
+
+/**
+ * @param lv The listview.
+ * @param x The x position, relative to the listview.
+ * @param y The y position, relative to the listview.
+ *
+ * @returns the visible row at x,y, or UINT32_MAX if there is none.
+ */
+static unsigned int listview_hit_test(listview *lv, gint x, gint y) {
+  unsigned int max = MIN(lv->cur_elements, lv->req_elements - lv->last_offset);
+  if (lv->hit_map.length != max) {
+    // Layout changed since the last frame, check the widgets.
+    for (unsigned int i = 0; i < max; i++) {
+      if (widget_intersect(WIDGET(lv->boxes[i].box), x, y)) {
+        return i;
+      }
+    }
+    return UINT32_MAX;
+  }
+  // Consecutive motion events mostly stay within the same row.
+  for (unsigned int j = 0; j < max; j++) {
+    unsigned int i = (lv->hit_map.last + j) % max;
+    const int *r = &(lv->hit_map.rects[4 * i]);
+    if (x >= r[0] && x < (r[0] + r[2]) && y >= r[1] && y < (r[1] + r[3])) {
+      lv->hit_map.last = i;
+      return i;
+    }
+  }
+  return UINT32_MAX;
+}
+
 static void _listview_draw(widget *wid, cairo_t *draw) {
   listview *lv = (listview *)wid;
   if (lv->type == LISTVIEW) {
@@ -538,6 +852,7 @@ static void _listview_draw(widget *wid, cairo_t *draw) {
   } else {
     barview_draw(wid, draw);
   }
+  listview_hit_map_update(lv);
 }
 /**
  * State names used for theming.
@@ -580,6 +895,7 @@ static void listview_recompute_elements(listview *lv) {
   }
   lv->rchanged = TRUE;
   lv->cur_elements = newne;
+  lv->hit_map.length = 0;
 }
 
 void listview_set_num_elements(listview *lv, unsigned int rows) {
@@ -666,11 +982,10 @@ static widget *listview_find_mouse_target(widget *wid, WidgetType type, gint x,
     target = widget_find_mouse_target(WIDGET(lv->scrollbar), type, rx, ry);
   }
 
-  unsigned int max = MIN(lv->cur_elements, lv->req_elements - lv->last_offset);
-  unsigned int i;
-  for (i = 0; i < max && target == NULL; i++) {
-    widget *w = WIDGET(lv->boxes[i].box);
-    if (widget_intersect(w, x, y)) {
+  if (target == NULL) {
+    unsigned int i = listview_hit_test(lv, x, y);
+    if (i != UINT32_MAX) {
+      widget *w = WIDGET(lv->boxes[i].box);
       rx = x - widget_get_x_pos(w);
       ry = y - widget_get_y_pos(w);
       target = widget_find_mouse_target(w, type, rx, ry);
@@ -735,9 +1050,12 @@ static gboolean listview_element_motion_notify(widget *wid,
                                                G_GNUC_UNUSED gint y) {
   listview *lv = (listview *)wid->parent;
   unsigned int max = MIN(lv->cur_elements, lv->req_elements - lv->last_offset);
-  unsigned int i;
-  for (i = 0; i < max && WIDGET(lv->boxes[i].box) != wid; i++) {
+  unsigned int i = lv->hit_map.last;
+  if (i >= max || WIDGET(lv->boxes[i].box) != wid) {
+    for (i = 0; i < max && WIDGET(lv->boxes[i].box) != wid; i++) {
+    }
   }
+  // Only changing the hovered row needs a redraw.
   if (i < max && (lv->last_offset + i) != listview_get_selected(lv)) {
     listview_set_selected(lv, lv->last_offset + i);
   }
@@ -1123,6 +1441,12 @@ gboolean listview_get_fixed_num_lines(listview *lv) {
   }
   return FALSE;
 }
+unsigned int listview_get_page_size(listview *lv) {
+  if (lv) {
+    return lv->menu_lines * MAX(lv->menu_columns, 1);
+  }
+  return 0;
+}
 void listview_set_fixed_num_lines(listview *lv) {
   if (lv) {
     lv->fixed_num_lines = TRUE;
@@ -57,6 +57,145 @@ static TBFontConfig *tbfc_default = NULL;
 /** HashMap of previously parsed font descriptions. */
 static GHashTable *tbfc_cache = NULL;
 
+/** Settings of p_context, copied into the context of each drawing thread. */
+static struct {
+  cairo_font_options_t *font_options;
+  double resolution;
+  PangoFontDescription *pfd;
+  PangoLanguage *language;
+} p_context_settings = {NULL, -1, NULL, NULL};
+
+/** The PangoContext of a drawing thread, kept for the life of the thread. */
+static GPrivate tb_thread_context = G_PRIVATE_INIT(g_object_unref);
+/** Set to the thread context between textbox_thread_draw_begin() and end. */
+static GPrivate tb_thread_draw = G_PRIVATE_INIT(NULL);
+
+/** Minimum amount of bytes to grow the gap with. */
+#define TB_TEXT_GAP_MIN 64
+
+/**
+ * @param t The text buffer.
+ * @param text The new (valid UTF-8) text.
+ * @param len The length of text in bytes.
+ *
+ * Replace the content, the gap is placed at the end.
+ */
+static void tb_text_set(TBText *t, const char *text, size_t len) {
+  // text can point into the old buffer, copy before freeing it.
+  char *data = g_malloc(len + 1);
+  memcpy(data, text, len);
+  data[len] = '\0';
+  g_free(t->data);
+  t->data = data;
+  t->size = len + 1;
+  t->gap_start = len;
+  t->gap_end = t->size;
+  t->length = g_utf8_strlen(t->data, len);
+  t->gap_chars = t->length;
+}
+
+/**
+ * @param t The text buffer.
+ * @param pos The character offset to move the gap to.
+ *
+ * Only the characters between the old and the new position are walked and
+ * moved.
+ */
+static void tb_text_move_gap(TBText *t, int pos) {
+  pos = MAX(0, MIN(t->length, pos));
+  if (pos < t->gap_chars) {
+    const char *start = t->data + t->gap_start;
+    const char *p = start;
+    for (int i = t->gap_chars; i > pos; i--) {
+      p = g_utf8_prev_char(p);
+    }
+    size_t n = start - p;
+    memmove(t->data + t->gap_end - n, p, n);
+    t->gap_start -= n;
+    t->gap_end -= n;
+  } else if (pos > t->gap_chars) {
+    const char *end = t->data + t->gap_end;
+    const char *p = end;
+    for (int i = t->gap_chars; i < pos; i++) {
+      p = g_utf8_next_char(p);
+    }
+    size_t n = p - end;
+    memmove(t->data + t->gap_start, end, n);
+    t->gap_start += n;
+    t->gap_end += n;
+  }
+  t->gap_chars = pos;
+}
+
+/**
+ * @param t The text buffer.
+ * @param len The number of bytes that are going to be inserted.
+ *
+ * Grow the gap so it fits len bytes, one byte is always kept free for the
+ * terminating '\0' of tb_text_flatten().
+ */
+static void tb_text_reserve(TBText *t, size_t len) {
+  if ((t->gap_end - t->gap_start) > len) {
+    return;
+  }
+  size_t tail = t->size - t->gap_end;
+  size_t used = t->gap_start + tail;
+  size_t size = MAX(t->size * 2, used + len + 1 + TB_TEXT_GAP_MIN);
+  t->data = g_realloc(t->data, size);
+  memmove(t->data + size - tail, t->data + t->gap_end, tail);
+  t->gap_end = size - tail;
+  t->size = size;
+}
+
+/**
+ * @param t The text buffer.
+ * @param pos The character offset to insert at.
+ * @param str The (valid UTF-8) text to insert.
+ * @param len The length of str in bytes.
+ * @param chars The length of str in characters.
+ */
+static void tb_text_insert(TBText *t, int pos, const char *str, size_t len,
+                           int chars) {
+  tb_text_move_gap(t, pos);
+  tb_text_reserve(t, len);
+  memcpy(t->data + t->gap_start, str, len);
+  t->gap_start += len;
+  t->gap_chars += chars;
+  t->length += chars;
+}
+
+/**
+ * @param t The text buffer.
+ * @param pos The character offset to delete from.
+ * @param chars The number of characters to delete.
+ */
+static void tb_text_delete(TBText *t, int pos, int chars) {
+  tb_text_move_gap(t, pos);
+  chars = MAX(0, MIN(t->length - t->gap_chars, chars));
+  const char *p = t->data + t->gap_end;
+  for (int i = 0; i < chars; i++) {
+    p = g_utf8_next_char(p);
+  }
+  t->gap_end = p - t->data;
+  t->length -= chars;
+}
+
+/**
+ * @param t The text buffer.
+ *
+ * Move the gap to the end so the text is one '\0' terminated string.
+ *
+ * @returns the text.
+ */
+static const char *tb_text_flatten(TBText *t) {
+  if (t->data == NULL) {
+    return "";
+  }
+  tb_text_move_gap(t, t->length);
+  t->data[t->gap_start] = '\0';
+  return t->data;
+}
+
 static gboolean textbox_blink(gpointer data) {
   textbox *tb = (textbox *)data;
   if (tb->blink < 2) {
@@ -312,24 +451,26 @@ void textbox_font(textbox *tb, TextBoxFontType tbft) {
  */
 static void __textbox_update_pango_text(textbox *tb) {
   pango_layout_set_attributes(tb->layout, NULL);
-  if (tb->placeholder && (tb->text == NULL || tb->text[0] == 0)) {
+  if (tb->placeholder && tb->text.length == 0) {
     tb->show_placeholder = TRUE;
     pango_layout_set_markup(tb->layout, tb->placeholder, -1);
     return;
   }
   tb->show_placeholder = FALSE;
   if ((tb->flags & TB_PASSWORD) == TB_PASSWORD) {
-    size_t l = g_utf8_strlen(tb->text, -1);
-    char string[l + 1];
-    memset(string, '*', l);
-    string[l] = '\0';
-    pango_layout_set_text(tb->layout, string, l);
+    // Length is in characters, can be large when pasting. Keep it off the
+    // stack.
+    char *string = g_malloc(tb->text.length + 1);
+    memset(string, '*', tb->text.length);
+    string[tb->text.length] = '\0';
+    pango_layout_set_text(tb->layout, string, tb->text.length);
+    g_free(string);
   } else if (tb->flags & TB_MARKUP || tb->tbft & MARKUP) {
-    pango_layout_set_markup(tb->layout, tb->text, -1);
+    pango_layout_set_markup(tb->layout, tb_text_flatten(&(tb->text)), -1);
   } else {
-    pango_layout_set_text(tb->layout, tb->text, -1);
+    pango_layout_set_text(tb->layout, tb_text_flatten(&(tb->text)), -1);
   }
-  if (tb->text) {
+  if (tb->text.data) {
     RofiHighlightColorStyle th = {0, {0.0, 0.0, 0.0, 0.0}};
     th = rofi_theme_get_highlight(WIDGET(tb), "text-transform", th);
     if (th.style != 0) {
@@ -359,10 +500,22 @@ void textbox_set_pango_attributes(textbox *tb, PangoAttrList *list) {
 }
 
 char *textbox_get_text(const textbox *tb) {
-  if (tb->text == NULL) {
+  if (tb->text.data == NULL) {
     return g_strdup("");
   }
-  return g_strdup(tb->text);
+  // Copy both sides of the gap, without moving it.
+  size_t tail = tb->text.size - tb->text.gap_end;
+  char *retv = g_malloc(tb->text.gap_start + tail + 1);
+  memcpy(retv, tb->text.data, tb->text.gap_start);
+  memcpy(retv + tb->text.gap_start, tb->text.data + tb->text.gap_end, tail);
+  retv[tb->text.gap_start + tail] = '\0';
+  return retv;
+}
+const char *textbox_peek_text(textbox *tb) {
+  if (tb == NULL) {
+    return "";
+  }
+  return tb_text_flatten(&(tb->text));
 }
 int textbox_get_cursor(const textbox *tb) {
   if (tb) {
@@ -375,23 +528,18 @@ void textbox_text(textbox *tb, const char *text) {
   if (tb == NULL) {
     return;
   }
-  g_free(tb->text);
   const gchar *last_pointer = NULL;
 
   if (text == NULL) {
-    tb->text = g_strdup("Invalid string.");
-  } else {
-    if (g_utf8_validate(text, -1, &last_pointer)) {
-      tb->text = g_strdup(text);
-    } else {
-      if (last_pointer != NULL) {
-        // Copy string up to invalid character.
-        tb->text = g_strndup(text, (last_pointer - text));
-      } else {
-        tb->text = g_strdup("Invalid UTF-8 string.");
-      }
-    }
-  }
+    text = "Invalid string.";
+    last_pointer = text + strlen(text);
+  } else if (!g_utf8_validate(text, -1, &last_pointer) &&
+             last_pointer == NULL) {
+    text = "Invalid UTF-8 string.";
+    last_pointer = text + strlen(text);
+  }
+  // Copy string up to invalid character.
+  tb_text_set(&(tb->text), text, last_pointer - text);
   __textbox_update_pango_text(tb);
   if (tb->flags & TB_AUTOWIDTH) {
     textbox_moveresize(tb, tb->widget.x, tb->widget.y, tb->widget.w,
@@ -401,7 +549,7 @@ void textbox_text(textbox *tb, const char *text) {
     }
   }
 
-  tb->cursor = MAX(0, MIN((int)g_utf8_strlen(tb->text, -1), tb->cursor));
+  tb->cursor = MAX(0, MIN(tb->text.length, tb->cursor));
   widget_queue_redraw(WIDGET(tb));
 }
 
@@ -456,7 +604,7 @@ static void textbox_free(widget *wid) {
     g_source_remove(tb->blink_timeout);
     tb->blink_timeout = 0;
   }
-  g_free(tb->text);
+  g_free(tb->text.data);
 
   g_free(tb->placeholder);
   if (tb->layout != NULL) {
@@ -466,6 +614,44 @@ static void textbox_free(widget *wid) {
   g_slice_free(textbox, tb);
 }
 
+/**
+ * @param tb The textbox.
+ * @param context The PangoContext of the drawing thread.
+ *
+ * The layout of the textbox belongs to the shared context, that can only be
+ * used from the main thread. Copy it into a layout of @p context.
+ *
+ * @returns a new layout with the content and settings of the textbox layout.
+ */
+static PangoLayout *textbox_thread_layout(const textbox *tb,
+                                          PangoContext *context) {
+  PangoLayout *src = tb->layout;
+  PangoLayout *layout = pango_layout_new(context);
+  const PangoFontDescription *pfd = pango_layout_get_font_description(src);
+  if (pfd != NULL) {
+    pango_layout_set_font_description(layout, pfd);
+  }
+  pango_layout_set_attributes(layout, pango_layout_get_attributes(src));
+  pango_layout_set_text(layout, pango_layout_get_text(src), -1);
+  pango_layout_set_width(layout, pango_layout_get_width(src));
+  pango_layout_set_height(layout, pango_layout_get_height(src));
+  pango_layout_set_wrap(layout, pango_layout_get_wrap(src));
+  pango_layout_set_ellipsize(layout, pango_layout_get_ellipsize(src));
+  pango_layout_set_alignment(layout, pango_layout_get_alignment(src));
+  pango_layout_set_justify(layout, pango_layout_get_justify(src));
+  pango_layout_set_indent(layout, pango_layout_get_indent(src));
+  pango_layout_set_spacing(layout, pango_layout_get_spacing(src));
+  pango_layout_set_auto_dir(layout, pango_layout_get_auto_dir(src));
+  pango_layout_set_single_paragraph_mode(
+      layout, pango_layout_get_single_paragraph_mode(src));
+  PangoTabArray *tabs = pango_layout_get_tabs(src);
+  if (tabs != NULL) {
+    pango_layout_set_tabs(layout, tabs);
+    pango_tab_array_free(tabs);
+  }
+  return layout;
+}
+
 static void textbox_draw(widget *wid, cairo_t *draw) {
   if (wid == NULL) {
     return;
@@ -476,16 +662,21 @@ static void textbox_draw(widget *wid, cairo_t *draw) {
   if (tb->changed) {
     __textbox_update_pango_text(tb);
   }
+  PangoLayout *layout = tb->layout;
+  PangoContext *thread_context = g_private_get(&tb_thread_draw);
+  if (thread_context != NULL) {
+    layout = textbox_thread_layout(tb, thread_context);
+  }
 
   // Skip the side MARGIN on the X axis.
   int x;
   int top = widget_padding_get_top(WIDGET(tb));
   int y = (pango_font_metrics_get_ascent(tb->tbfc->metrics) -
-           pango_layout_get_baseline(tb->layout)) /
+           pango_layout_get_baseline(layout)) /
           PANGO_SCALE;
   int line_width = 0, line_height = 0;
   // Get actual width.
-  pango_layout_get_pixel_size(tb->layout, &line_width, &line_height);
+  pango_layout_get_pixel_size(layout, &line_width, &line_height);
 
   if (tb->yalign > 0.001) {
     int bottom = widget_padding_get_bottom(WIDGET(tb));
@@ -504,7 +695,7 @@ static void textbox_draw(widget *wid, cairo_t *draw) {
   { int rem =
           MAX(0, tb->widget.w - widget_padding_get_padding_width(WIDGET(tb)) -
                      line_width - dot_offset);
-    switch (pango_layout_get_alignment(tb->layout)) {
+    switch (pango_layout_get_alignment(layout)) {
     case PANGO_ALIGN_CENTER:
       x = rem * (tb->xalign - 0.5);
       break;
@@ -521,13 +712,13 @@ static void textbox_draw(widget *wid, cairo_t *draw) {
   // draw the cursor
   if (tb->flags & TB_EDITABLE) {
     // We want to place the cursor based on the text shown.
-    const char *text = pango_layout_get_text(tb->layout);
+    const char *text = pango_layout_get_text(layout);
     // Clamp the position, should not be needed, but we are paranoid.
     int cursor_offset = MIN(tb->cursor, g_utf8_strlen(text, -1));
     PangoRectangle pos;
     // convert to byte location.
     char *offset = g_utf8_offset_to_pointer(text, cursor_offset);
-    pango_layout_get_cursor_pos(tb->layout, offset - text, &pos, NULL);
+    pango_layout_get_cursor_pos(layout, offset - text, &pos, NULL);
     int cursor_x = pos.x / PANGO_SCALE;
     int cursor_y = pos.y / PANGO_SCALE;
     int cursor_height = pos.height / PANGO_SCALE;
@@ -573,18 +764,21 @@ static void textbox_draw(widget *wid, cairo_t *draw) {
     show_outline = rofi_theme_get_boolean(WIDGET(tb), "text-outline", FALSE);
   }
   cairo_move_to(draw, x, top);
-  pango_cairo_show_layout(draw, tb->layout);
+  pango_cairo_show_layout(draw, layout);
 
   if (show_outline) {
     rofi_theme_get_color(WIDGET(tb), "text-outline-color", draw);
     double width = rofi_theme_get_double(WIDGET(tb), "text-outline-width", 0.5);
     cairo_move_to(draw, x, top);
-    pango_cairo_layout_path(draw, tb->layout);
+    pango_cairo_layout_path(draw, layout);
     cairo_set_line_width(draw, width);
     cairo_stroke(draw);
   }
 
   cairo_restore(draw);
+  if (layout != tb->layout) {
+    g_object_unref(layout);
+  }
 }
 
 // cursor handling for edit mode
@@ -592,8 +786,7 @@ void textbox_cursor(textbox *tb, int pos) {
   if (tb == NULL) {
     return;
   }
-  int length = (tb->text == NULL) ? 0 : g_utf8_strlen(tb->text, -1);
-  tb->cursor = MAX(0, MIN(length, pos));
+  tb->cursor = MAX(0, MIN(tb->text.length, pos));
   // Stop blink!
   tb->blink = 3;
   widget_queue_redraw(WIDGET(tb));
@@ -627,11 +820,12 @@ static int textbox_cursor_dec(textbox *tb) {
 
 // Move word right
 static void textbox_cursor_inc_word(textbox *tb) {
-  if (tb->text == NULL) {
+  if (tb->text.data == NULL) {
     return;
   }
+  const char *text = tb_text_flatten(&(tb->text));
   // Find word boundaries, with pango_Break?
-  gchar *c = g_utf8_offset_to_pointer(tb->text, tb->cursor);
+  const gchar *c = g_utf8_offset_to_pointer(text, tb->cursor);
   while ((c = g_utf8_next_char(c))) {
     gunichar uc = g_utf8_get_char(c);
     GUnicodeBreakType bt = g_unichar_break_type(uc);
@@ -653,15 +847,16 @@ static void textbox_cursor_inc_word(textbox *tb) {
       break;
     }
   }
-  int index = g_utf8_pointer_to_offset(tb->text, c);
+  int index = g_utf8_pointer_to_offset(text, c);
   textbox_cursor(tb, index);
 }
 // move word left
 static void textbox_cursor_dec_word(textbox *tb) {
+  const char *text = tb_text_flatten(&(tb->text));
   // Find word boundaries, with pango_Break?
-  gchar *n;
-  gchar *c = g_utf8_offset_to_pointer(tb->text, tb->cursor);
-  while ((c = g_utf8_prev_char(c)) && c != tb->text) {
+  const gchar *n;
+  const gchar *c = g_utf8_offset_to_pointer(text, tb->cursor);
+  while ((c = g_utf8_prev_char(c)) && c != text) {
     gunichar uc = g_utf8_get_char(c);
     GUnicodeBreakType bt = g_unichar_break_type(uc);
     if ((bt == G_UNICODE_BREAK_ALPHABETIC ||
@@ -670,7 +865,7 @@ static void textbox_cursor_dec_word(textbox *tb) {
       break;
     }
   }
-  if (c != tb->text) {
+  if (c != text) {
     while ((n = g_utf8_prev_char(c))) {
       gunichar uc = g_utf8_get_char(n);
       GUnicodeBreakType bt = g_unichar_break_type(uc);
@@ -680,23 +875,18 @@ static void textbox_cursor_dec_word(textbox *tb) {
         break;
       }
       c = n;
-      if (n == tb->text) {
+      if (n == text) {
         break;
       }
     }
   }
-  int index = g_utf8_pointer_to_offset(tb->text, c);
+  int index = g_utf8_pointer_to_offset(text, c);
   textbox_cursor(tb, index);
 }
 
 // end of line
 void textbox_cursor_end(textbox *tb) {
-  if (tb->text == NULL) {
-    tb->cursor = 0;
-    widget_queue_redraw(WIDGET(tb));
-    return;
-  }
-  tb->cursor = (int)g_utf8_strlen(tb->text, -1);
+  tb->cursor = tb->text.length;
   widget_queue_redraw(WIDGET(tb));
   // Stop blink!
   tb->blink = 2;
@@ -708,17 +898,7 @@ void textbox_insert(textbox *tb, const int char_pos, const char *str,
   if (tb == NULL) {
     return;
   }
-  char *c = g_utf8_offset_to_pointer(tb->text, char_pos);
-  int pos = c - tb->text;
-  int len = (int)strlen(tb->text);
-  pos = MAX(0, MIN(len, pos));
-  // expand buffer
-  tb->text = g_realloc(tb->text, len + slen + 1);
-  // move everything after cursor upward
-  char *at = tb->text + pos;
-  memmove(at + slen, at, len - pos + 1);
-  // insert new str
-  memmove(at, str, slen);
+  tb_text_insert(&(tb->text), char_pos, str, slen, g_utf8_strlen(str, slen));
 
   // Set modified, lay out need te be redrawn
   // Stop blink!
@@ -731,19 +911,15 @@ void textbox_delete(textbox *tb, int pos, int dlen) {
   if (tb == NULL) {
     return;
   }
-  int len = g_utf8_strlen(tb->text, -1);
+  int len = tb->text.length;
   if (len == pos) {
     return;
   }
   pos = MAX(0, MIN(len, pos));
   if ((pos + dlen) > len) {
-    dlen = len - dlen;
+    dlen = len - pos;
   }
-  // move everything after pos+dlen down
-  char *start = g_utf8_offset_to_pointer(tb->text, pos);
-  char *end = g_utf8_offset_to_pointer(tb->text, pos + dlen);
-  // Move remainder + closing \0
-  memmove(start, end, (tb->text + strlen(tb->text)) - end + 1);
+  tb_text_delete(&(tb->text), pos, dlen);
   if (tb->cursor >= pos && tb->cursor < (pos + dlen)) {
     tb->cursor = pos;
   } else if (tb->cursor >= (pos + dlen)) {
@@ -761,7 +937,7 @@ void textbox_delete(textbox *tb, int pos, int dlen) {
  * Delete character after cursor.
  */
 static void textbox_cursor_del(textbox *tb) {
-  if (tb == NULL || tb->text == NULL) {
+  if (tb == NULL || tb->text.data == NULL) {
     return;
   }
   textbox_delete(tb, tb->cursor, 1);
@@ -789,7 +965,7 @@ static void textbox_cursor_bkspc_word(textbox *tb) {
 }
 static void textbox_cursor_del_eol(textbox *tb) {
   if (tb && tb->cursor >= 0) {
-    int length = g_utf8_strlen(tb->text, -1) - tb->cursor;
+    int length = tb->text.length - tb->cursor;
     if (length >= 0) {
       textbox_delete(tb, tb->cursor, length);
     }
@@ -888,27 +1064,39 @@ gboolean textbox_append_text(textbox *tb, const char *pad, const int pad_len) {
 
   // Filter When alt/ctrl is pressed do not accept the character.
 
-  gboolean used_something = FALSE;
-  const gchar *w, *n, *e;
-  for (w = pad, n = g_utf8_next_char(w), e = w + pad_len; w < e;
-       w = n, n = g_utf8_next_char(n)) {
+  const gchar *e = NULL;
+  if (!g_utf8_validate(pad, pad_len, &e)) {
+    g_info("Got invalid UTF-8, only inserting the text before it.");
+  }
+  // Sanitize into a copy first, a paste is then inserted as a whole.
+  // Replacing whitespace by a space never makes the text longer.
+  char *clean = g_malloc(e - pad + 1);
+  size_t clean_len = 0;
+  int clean_chars = 0;
+  for (const gchar *w = pad, *n; w < e; w = n) {
+    n = g_utf8_next_char(w);
     gunichar c = g_utf8_get_char(w);
     if (g_unichar_isspace(c)) {
       /** Replace tabs, newlines and others with a normal space. */
-      textbox_insert(tb, tb->cursor, " ", 1);
-      textbox_cursor(tb, tb->cursor + 1);
-      used_something = TRUE;
+      clean[clean_len++] = ' ';
+      clean_chars++;
     } else if (g_unichar_iscntrl(c)) {
       /* skip control characters. */
       g_info("Got an invalid character: %08X", c);
     } else {
       /** Insert the text */
-      textbox_insert(tb, tb->cursor, w, n - w);
-      textbox_cursor(tb, tb->cursor + 1);
-      used_something = TRUE;
+      memcpy(clean + clean_len, w, n - w);
+      clean_len += n - w;
+      clean_chars++;
     }
   }
-  return used_something;
+  if (clean_chars > 0) {
+    tb_text_insert(&(tb->text), tb->cursor, clean, clean_len, clean_chars);
+    tb->changed = TRUE;
+    textbox_cursor(tb, tb->cursor + clean_chars);
+  }
+  g_free(clean);
+  return clean_chars > 0;
 }
 
 static void tbfc_entry_free(TBFontConfig *tbfc) {
@@ -942,10 +1130,59 @@ void textbox_set_pango_context(const char *font, PangoContext *p) {
 
   g_hash_table_insert(tbfc_cache, (gpointer *)(font ? font : default_font_name),
                       tbfc);
+
+  const cairo_font_options_t *fo = pango_cairo_context_get_font_options(p);
+  if (fo != NULL) {
+    p_context_settings.font_options = cairo_font_options_copy(fo);
+  }
+  p_context_settings.resolution = pango_cairo_context_get_resolution(p);
+  PangoFontMap *font_map = pango_context_get_font_map(p);
+  if (p_context_settings.resolution < 0 && PANGO_IS_CAIRO_FONT_MAP(font_map)) {
+    // The resolution is set on the font map of this thread.
+    p_context_settings.resolution =
+        pango_cairo_font_map_get_resolution(PANGO_CAIRO_FONT_MAP(font_map));
+  }
+  const PangoFontDescription *pfd = pango_context_get_font_description(p);
+  if (pfd != NULL) {
+    p_context_settings.pfd = pango_font_description_copy(pfd);
+  }
+  p_context_settings.language = pango_context_get_language(p);
+  // Fill the caches now, rows can be drawn from multiple threads.
+  textbox_get_estimated_char_width();
+  textbox_get_estimated_ch();
 }
 
+void textbox_thread_draw_begin(void) {
+  PangoContext *context = g_private_get(&tb_thread_context);
+  if (context == NULL) {
+    // The default font map is private to the calling thread.
+    context = pango_font_map_create_context(pango_cairo_font_map_get_default());
+    if (p_context_settings.font_options != NULL) {
+      pango_cairo_context_set_font_options(context,
+                                           p_context_settings.font_options);
+    }
+    pango_cairo_context_set_resolution(context, p_context_settings.resolution);
+    if (p_context_settings.pfd != NULL) {
+      pango_context_set_font_description(context, p_context_settings.pfd);
+    }
+    pango_context_set_language(context, p_context_settings.language);
+    g_private_set(&tb_thread_context, context);
+  }
+  g_private_set(&tb_thread_draw, context);
+}
+
+void textbox_thread_draw_end(void) { g_private_set(&tb_thread_draw, NULL); }
+
 void textbox_cleanup(void) {
   g_hash_table_destroy(tbfc_cache);
+  if (p_context_settings.font_options != NULL) {
+    cairo_font_options_destroy(p_context_settings.font_options);
+    p_context_settings.font_options = NULL;
+  }
+  if (p_context_settings.pfd != NULL) {
+    pango_font_description_free(p_context_settings.pfd);
+    p_context_settings.pfd = NULL;
+  }
   if (p_context) {
     g_object_unref(p_context);
     p_context = NULL;
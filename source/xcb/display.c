@@ -42,6 +42,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
+#include <xcb/present.h>
 #include <xcb/randr.h>
 #include <xcb/xcb.h>
 #include <xcb/xcb_aux.h>
@@ -1211,15 +1212,126 @@ static void rofi_key_release_event_handler(xcb_key_release_event_t *xkre,
                               NK_BINDINGS_KEY_STATE_RELEASE);
 }
 
+static void x11_handle_xkb_state_notify(xcb_xkb_state_notify_event_t *ksne) {
+  nk_bindings_seat_update_mask(xcb->bindings_seat, NULL, ksne->baseMods,
+                               ksne->latchedMods, ksne->lockedMods,
+                               ksne->baseGroup, ksne->latchedGroup,
+                               ksne->lockedGroup);
+}
+
+static void x11_handle_key_event(xcb_generic_event_t *event,
+                                 RofiViewState *state) {
+  uint8_t type = event->response_type & ~0x80;
+#ifdef XCB_IMDKIT
+  if (xcb->ic) {
+    g_log("IMDKit", G_LOG_LEVEL_DEBUG, "input xim");
+    xcb_xim_forward_event(xcb->im, xcb->ic, (xcb_key_press_event_t *)event);
+    return;
+  }
+#endif
+  if (type == XCB_KEY_PRESS) {
+    rofi_key_press_event_handler((xcb_key_press_event_t *)event, state);
+  } else {
+    rofi_key_release_event_handler((xcb_key_release_event_t *)event, state);
+  }
+}
+
+/**
+ * @param event The event to keep.
+ *
+ * Keep a copy of a keyboard event that arrived before there was a view, it is
+ * replayed by x11_replay_pending_key_events().
+ */
+static void x11_queue_key_event(xcb_generic_event_t *event) {
+  xcb_generic_event_t *copy = g_malloc(sizeof(xcb_generic_event_t));
+  memcpy(copy, event, sizeof(xcb_generic_event_t));
+  g_queue_push_tail(&(xcb->pending_key_events), copy);
+}
+
+/**
+ * Feed the keyboard events typed before the view existed to the view, in
+ * order. Text ends up in the entry box and is filtered once afterwards.
+ * This runs on the first event the view gets, mapping the window produces
+ * an expose so this happens without further input.
+ */
+static void x11_replay_pending_key_events(void) {
+  RofiViewState *state = rofi_view_get_active();
+  if (state == NULL || g_queue_is_empty(&(xcb->pending_key_events))) {
+    return;
+  }
+  g_debug("Replaying %u key events typed ahead.",
+          g_queue_get_length(&(xcb->pending_key_events)));
+  while (state != NULL && !g_queue_is_empty(&(xcb->pending_key_events))) {
+    xcb_generic_event_t *event = g_queue_pop_head(&(xcb->pending_key_events));
+    if ((event->response_type & ~0x80) == xcb->xkb.first_event) {
+      x11_handle_xkb_state_notify((xcb_xkb_state_notify_event_t *)event);
+    } else {
+      x11_handle_key_event(event, state);
+    }
+    g_free(event);
+    // Accepting an entry ends this view, the rest goes to the next one.
+    if (rofi_view_get_completed(state)) {
+      rofi_view_maybe_update(state);
+      state = rofi_view_get_active();
+    }
+  }
+  if (state != NULL) {
+    rofi_view_maybe_update(state);
+  }
+}
+
+/**
+ * @param event The generic event.
+ *
+ * The Present extension reports when the frame copied to the window was shown,
+ * the view can then draw the next one.
+ */
+static void x11_handle_generic_event(xcb_ge_generic_event_t *event) {
+  if (xcb->present_opcode == 0 || event->extension != xcb->present_opcode ||
+      event->event_type != XCB_PRESENT_COMPLETE_NOTIFY) {
+    return;
+  }
+  xcb_present_complete_notify_event_t *cne =
+      (xcb_present_complete_notify_event_t *)event;
+  if (cne->window == rofi_view_get_window() &&
+      cne->kind == XCB_PRESENT_COMPLETE_KIND_NOTIFY_MSC) {
+    xcb_rofi_view_present_complete(cne->serial);
+  }
+}
+
 /**
  * Process X11 events in the main-loop (gui-thread) of the application.
  */
 static void main_loop_x11_event_handler_view(xcb_generic_event_t *event) {
   RofiViewState *state = rofi_view_get_active();
+  uint8_t type = event->response_type & ~0x80;
+  if (state == NULL) {
+    // Keep what the user types while we start up.
+    if (type == XCB_KEY_PRESS || type == XCB_KEY_RELEASE) {
+      x11_queue_key_event(event);
+    }
+    return;
+  }
+  x11_replay_pending_key_events();
+  state = rofi_view_get_active();
   if (state == NULL) {
+    if (type == XCB_KEY_PRESS || type == XCB_KEY_RELEASE) {
+      x11_queue_key_event(event);
+    }
+    return;
+  }
+
+  // Frame timing, not input.
+  if (type == XCB_GE_GENERIC) {
+    x11_handle_generic_event((xcb_ge_generic_event_t *)event);
     return;
   }
 
+  // Other input should see the pointer position that preceded it.
+  if ((event->response_type & ~0x80) != XCB_MOTION_NOTIFY) {
+    rofi_view_flush_mouse_motion();
+  }
+
   switch (event->response_type & ~0x80) {
   case XCB_CLIENT_MESSAGE: {
     xcb_client_message_event_t *cme = (xcb_client_message_event_t *)event;
@@ -1253,7 +1365,7 @@ static void main_loop_x11_event_handler_view(xcb_generic_event_t *event) {
     break;
   }
   case XCB_EXPOSE:
-    rofi_view_frame_callback();
+    rofi_view_queue_redraw();
     break;
   case XCB_CONFIGURE_NOTIFY: {
     xcb_configure_notify_event_t *xce = (xcb_configure_notify_event_t *)event;
@@ -1266,8 +1378,8 @@ static void main_loop_x11_event_handler_view(xcb_generic_event_t *event) {
     if (button_mask && config.click_to_exit == TRUE) {
       xcb->mouse_seen = TRUE;
     }
-    rofi_view_handle_mouse_motion(state, xme->event_x, xme->event_y,
-                                  !button_mask && config.hover_select);
+    rofi_view_queue_mouse_motion(xme->event_x, xme->event_y,
+                                 !button_mask && config.hover_select);
     break;
   }
   case XCB_BUTTON_PRESS: {
@@ -1368,31 +1480,10 @@ static void main_loop_x11_event_handler_view(xcb_generic_event_t *event) {
     }
     break;
   }
-  case XCB_KEY_PRESS: {
-    xcb_key_press_event_t *xkpe = (xcb_key_press_event_t *)event;
-#ifdef XCB_IMDKIT
-    if (xcb->ic) {
-      g_log("IMDKit", G_LOG_LEVEL_DEBUG, "input xim");
-      xcb_xim_forward_event(xcb->im, xcb->ic, xkpe);
-    } else
-#endif
-    {
-      rofi_key_press_event_handler(xkpe, state);
-    }
+  case XCB_KEY_PRESS:
+  case XCB_KEY_RELEASE:
+    x11_handle_key_event(event, state);
     break;
-  }
-  case XCB_KEY_RELEASE: {
-    xcb_key_release_event_t *xkre = (xcb_key_release_event_t *)event;
-#ifdef XCB_IMDKIT
-    if (xcb->ic) {
-      xcb_xim_forward_event(xcb->im, xcb->ic, xkre);
-    } else
-#endif
-    {
-      rofi_key_release_event_handler(xkre, state);
-    }
-    break;
-  }
   default:
     break;
   }
@@ -1409,6 +1500,7 @@ void x11_event_handler_fowarding(G_GNUC_UNUSED xcb_xim_t *im,
     return;
   }
   uint8_t type = event->response_type & ~0x80;
+  rofi_view_flush_mouse_motion();
   if (type == XCB_KEY_PRESS) {
     rofi_key_press_event_handler(event, state);
   } else if (type == XCB_KEY_RELEASE) {
@@ -1455,11 +1547,13 @@ static gboolean main_loop_x11_event_handler(xcb_generic_event_t *ev,
       break;
     }
     case XCB_XKB_STATE_NOTIFY: {
-      xcb_xkb_state_notify_event_t *ksne = (xcb_xkb_state_notify_event_t *)ev;
-      nk_bindings_seat_update_mask(xcb->bindings_seat, NULL, ksne->baseMods,
-                                   ksne->latchedMods, ksne->lockedMods,
-                                   ksne->baseGroup, ksne->latchedGroup,
-                                   ksne->lockedGroup);
+      // Modifier changes interleave with the queued keys, keep the order.
+      if (rofi_view_get_active() == NULL) {
+        x11_queue_key_event(ev);
+        break;
+      }
+      x11_replay_pending_key_events();
+      x11_handle_xkb_state_notify((xcb_xkb_state_notify_event_t *)ev);
       rofi_view_maybe_update(rofi_view_get_active());
       break;
     }
@@ -1592,6 +1686,30 @@ static void error_trap_pop(G_GNUC_UNUSED SnDisplay *display,
 /**
  * Fill in the list of frequently used X11 Atoms.
  */
+/**
+ * Look up the Present extension. When it is available the view paces its
+ * redraws on the MSC notifications of its window.
+ */
+static void x11_setup_present_extension(void) {
+  xcb->present_opcode = 0;
+  const xcb_query_extension_reply_t *ext =
+      xcb_get_extension_data(xcb->connection, &xcb_present_id);
+  if (ext == NULL || !ext->present) {
+    g_debug("Present extension not available, redraws are not paced.");
+    return;
+  }
+  xcb_present_query_version_cookie_t cookie = xcb_present_query_version(
+      xcb->connection, XCB_PRESENT_MAJOR_VERSION, XCB_PRESENT_MINOR_VERSION);
+  xcb_present_query_version_reply_t *reply =
+      xcb_present_query_version_reply(xcb->connection, cookie, NULL);
+  if (reply == NULL) {
+    g_debug("Present extension version query failed.");
+    return;
+  }
+  free(reply);
+  xcb->present_opcode = ext->major_opcode;
+}
+
 static void x11_create_frequently_used_atoms(void) {
   // X atom values
   for (int i = 0; i < NUM_NETATOMS; i++) {
@@ -1650,6 +1768,26 @@ static void x11_helper_discover_window_manager(void) {
   }
 }
 
+/**
+ * The options that make rofi print something and exit after the display
+ * setup, without showing a window.
+ *
+ * @returns TRUE if one of them is given.
+ */
+static gboolean x11_exits_before_view(void) {
+  const char *const options[] = {
+      "-dump-theme", "-dump-processed-theme", "-dump-config",
+      "-h",          "-help",                 "--help",
+      "-list-keybindings",
+  };
+  for (size_t i = 0; i < G_N_ELEMENTS(options); i++) {
+    if (find_arg(options[i]) >= 0) {
+      return TRUE;
+    }
+  }
+  return FALSE;
+}
+
 static gboolean xcb_display_setup(GMainLoop *main_loop, NkBindings *bindings) {
   // Get DISPLAY, first env, then argument.
   // We never modify display_str content.
@@ -1762,6 +1900,8 @@ static gboolean xcb_display_setup(GMainLoop *main_loop, NkBindings *bindings) {
   // determine numlock mask so we can bind on keys with and without it
   x11_create_frequently_used_atoms();
 
+  x11_setup_present_extension();
+
   if (xcb_connection_has_error(xcb->connection)) {
     g_warning("Connection has error");
     return FALSE;
@@ -1784,6 +1924,14 @@ static gboolean xcb_display_setup(GMainLoop *main_loop, NkBindings *bindings) {
     return FALSE;
   }
 
+  // Try to grab the keyboard as early as possible, so keys typed right after
+  // the launch hotkey are not lost. They are queued until the view exists.
+  // Only one attempt here, retrying is left to the late setup.
+  if (find_arg("-normal-window") < 0 && !x11_exits_before_view()) {
+    xcb->keyboard_grabbed = take_keyboard(xcb_stuff_get_root_window(), 0);
+    xcb->pointer_grabbed = take_pointer(xcb_stuff_get_root_window(), 0);
+  }
+
   return TRUE;
 }
 
@@ -1896,18 +2044,22 @@ static gboolean xcb_display_late_setup(void) {
     return TRUE;
   }
   if (find_arg("-no-lazy-grab") >= 0) {
-    if (!take_keyboard(xcb_stuff_get_root_window(), 500)) {
+    if (!xcb->keyboard_grabbed &&
+        !take_keyboard(xcb_stuff_get_root_window(), 500)) {
       g_warning("Failed to grab keyboard, even after %d uS.", 500 * 1000);
       return FALSE;
     }
-    if (!take_pointer(xcb_stuff_get_root_window(), 100)) {
+    if (!xcb->pointer_grabbed &&
+        !take_pointer(xcb_stuff_get_root_window(), 100)) {
       g_warning("Failed to grab mouse pointer, even after %d uS.", 100 * 1000);
     }
   } else {
-    if (!take_keyboard(xcb_stuff_get_root_window(), 0)) {
+    if (!xcb->keyboard_grabbed &&
+        !take_keyboard(xcb_stuff_get_root_window(), 0)) {
       g_timeout_add(1, lazy_grab_keyboard, NULL);
     }
-    if (!take_pointer(xcb_stuff_get_root_window(), 0)) {
+    if (!xcb->pointer_grabbed &&
+        !take_pointer(xcb_stuff_get_root_window(), 0)) {
       g_timeout_add(1, lazy_grab_pointer, NULL);
     }
   }
@@ -1928,6 +2080,8 @@ static void xcb_display_cleanup(void) {
   }
 
   g_debug("Cleaning up XCB and XKB");
+  g_queue_foreach(&(xcb->pending_key_events), (GFunc)g_free, NULL);
+  g_queue_clear(&(xcb->pending_key_events));
 
   nk_bindings_seat_free(xcb->bindings_seat);
   if (xcb->sncontext != NULL) {
@@ -2028,7 +2182,7 @@ static void xcb_display_revert_input_focus(void) {
   xcb_flush(xcb->connection);
 }
 
-static guint xcb_display_scale(void) { return 1; }
+static double xcb_display_scale(void) { return 1; }
 
 static const struct _view_proxy *xcb_display_view_proxy(void) {
   return xcb_view_proxy;
@@ -41,6 +41,7 @@
 #ifdef XCB_IMDKIT
 #include <xcb-imdkit/encoding.h>
 #endif
+#include <xcb/present.h>
 #include <xcb/xcb_ewmh.h>
 #include <xcb/xcb_icccm.h>
 #include <xcb/xkb.h>
@@ -79,6 +80,14 @@ static void xcb_rofi_view_set_window_title(const char *title);
 
 static void xcb_rofi_view_queue_redraw(void);
 
+static void xcb_rofi_view_frame_callback(void);
+
+/**
+ * Milliseconds to wait for the Present notification of a frame before drawing
+ * the next one anyway.
+ */
+#define XCB_FRAME_TIMEOUT 100
+
 #ifdef XCB_IMDKIT
 static void xim_commit_string(xcb_xim_t *im, G_GNUC_UNUSED xcb_xic_t ic,
                               G_GNUC_UNUSED uint32_t flag, char *str,
@@ -124,6 +133,16 @@ static struct {
   gboolean fullscreen;
   /** Cursor type */
   X11CursorType cursor_type;
+  /** Present event id, 0 when redraws are not paced. */
+  xcb_present_event_t present_eid;
+  /** Serial of the last frame handed to Present. */
+  uint32_t present_serial;
+  /** A frame was copied to the window and not presented yet. */
+  gboolean frame_pending;
+  /** A redraw was requested while a frame was pending. */
+  gboolean redraw_pending;
+  /** Timeout for a lost Present notification. */
+  guint frame_timeout;
 } XcbState = {
     .fake_bg = NULL,
     .edit_surf = NULL,
@@ -133,6 +152,11 @@ static struct {
     .count = 0L,
     .repaint_source = 0,
     .fullscreen = FALSE,
+    .present_eid = 0,
+    .present_serial = 0,
+    .frame_pending = FALSE,
+    .redraw_pending = FALSE,
+    .frame_timeout = 0,
 };
 
 static void xcb_rofi_view_get_current_monitor(int *width, int *height) {
@@ -239,6 +263,28 @@ static gboolean bench_update(void) {
   return TRUE;
 }
 
+static gboolean xcb_rofi_view_frame_timeout(G_GNUC_UNUSED gpointer data) {
+  g_debug("No Present notification for frame %u.", XcbState.present_serial);
+  XcbState.frame_timeout = 0;
+  xcb_rofi_view_frame_callback();
+  return G_SOURCE_REMOVE;
+}
+
+/**
+ * Ask Present to report the next vertical blank of the window, the following
+ * frame is not drawn before that.
+ */
+static void xcb_rofi_view_pace_frame(void) {
+  if (XcbState.present_eid == 0 || config.benchmark_ui) {
+    return;
+  }
+  xcb_present_notify_msc(xcb->connection, CacheState.main_window,
+                         ++XcbState.present_serial, 0, 1, 0);
+  XcbState.frame_pending = TRUE;
+  XcbState.frame_timeout =
+      g_timeout_add(XCB_FRAME_TIMEOUT, xcb_rofi_view_frame_timeout, NULL);
+}
+
 static gboolean xcb_rofi_view_repaint(G_GNUC_UNUSED void *data) {
   RofiViewState *state = rofi_view_get_active();
   if (state) {
@@ -252,6 +298,7 @@ static gboolean xcb_rofi_view_repaint(G_GNUC_UNUSED void *data) {
     TICK_N("Expose");
     xcb_copy_area(xcb->connection, XcbState.edit_pixmap, CacheState.main_window,
                   XcbState.gc, 0, 0, 0, 0, state->width, state->height);
+    xcb_rofi_view_pace_frame();
     xcb_flush(xcb->connection);
     TICK_N("flush");
     XcbState.repaint_source = 0;
@@ -269,6 +316,12 @@ static void xcb_rofi_view_update(RofiViewState *state, gboolean qr) {
   if (!widget_need_redraw(WIDGET(state->main_window))) {
     return;
   }
+  if (qr && XcbState.frame_pending) {
+    // Drawn once the frame in flight is presented, so fast input does not
+    // draw frames that are never shown.
+    XcbState.redraw_pending = TRUE;
+    return;
+  }
   g_debug("Redraw view");
   TICK();
   cairo_t *d = XcbState.edit_draw;
@@ -536,7 +589,9 @@ static void xcb_rofi_view_reload(void) {
 static void xcb_rofi_view_queue_redraw(void) {
   RofiViewState *state = rofi_view_get_active();
 
-  if (state && XcbState.repaint_source == 0) {
+  if (state && XcbState.frame_pending) {
+    XcbState.redraw_pending = TRUE;
+  } else if (state && XcbState.repaint_source == 0) {
     XcbState.count++;
     g_debug("redraw %llu", XcbState.count);
     XcbState.repaint_source = g_idle_add_full(
@@ -747,6 +802,12 @@ static void xcb___create_window(MenuFlags menu_flags) {
 
   CacheState.main_window = box_window;
   CacheState.flags = menu_flags;
+  if (xcb->present_opcode != 0) {
+    XcbState.present_eid = xcb_generate_id(xcb->connection);
+    xcb_present_select_input(xcb->connection, XcbState.present_eid,
+                             CacheState.main_window,
+                             XCB_PRESENT_EVENT_MASK_COMPLETE_NOTIFY);
+  }
   monitor_active(&(XcbState.mon));
   // Setup dpi
   if (config.dpi > 1) {
@@ -925,15 +986,33 @@ static void xcb_rofi_view_temp_click_to_exit(RofiViewState *state,
   }
 }
 
+/**
+ * The frame in flight was presented (or timed out), draw the updates that were
+ * held back meanwhile.
+ */
 static void xcb_rofi_view_frame_callback(void) {
-  if (XcbState.repaint_source == 0) {
-    XcbState.count++;
-    g_debug("redraw %llu", XcbState.count);
-    XcbState.repaint_source = g_idle_add_full(
-        G_PRIORITY_HIGH_IDLE, xcb_rofi_view_repaint, NULL, NULL);
+  if (!XcbState.frame_pending) {
+    return;
+  }
+  XcbState.frame_pending = FALSE;
+  if (XcbState.frame_timeout > 0) {
+    g_source_remove(XcbState.frame_timeout);
+    XcbState.frame_timeout = 0;
+  }
+  if (XcbState.redraw_pending) {
+    XcbState.redraw_pending = FALSE;
+    xcb_rofi_view_queue_redraw();
   }
 }
 
+void xcb_rofi_view_present_complete(uint32_t serial) {
+  if (serial != XcbState.present_serial) {
+    g_debug("Late Present notification for frame %u.", serial);
+    return;
+  }
+  xcb_rofi_view_frame_callback();
+}
+
 static int xcb_rofi_view_calculate_window_height(RofiViewState *state) {
   if (XcbState.fullscreen == TRUE) {
     return XcbState.mon.h;
@@ -979,6 +1058,13 @@ static void xcb_rofi_view_cleanup() {
     g_source_remove(XcbState.repaint_source);
     XcbState.repaint_source = 0;
   }
+  if (XcbState.frame_timeout > 0) {
+    g_source_remove(XcbState.frame_timeout);
+    XcbState.frame_timeout = 0;
+  }
+  XcbState.frame_pending = FALSE;
+  XcbState.redraw_pending = FALSE;
+  XcbState.present_eid = 0;
   if (XcbState.fake_bg) {
     cairo_surface_destroy(XcbState.fake_bg);
     XcbState.fake_bg = NULL;
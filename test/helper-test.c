@@ -38,6 +38,7 @@
 #include <locale.h>
 #include <stdio.h>
 #include <string.h>
+#include <unistd.h>
 
 static int test = 0;
 
@@ -203,6 +204,24 @@ int main(int argc, char **argv) {
              1073741824);
   }
 
+  {
+    int pfd[2];
+    TASSERT(pipe(pfd) == 0);
+    RofiOutputBuffer *ob = rofi_output_buffer_new(pfd[1], 4096);
+    rofi_output_buffer_add_line(ob, "i:s", "aap", 0, "noot");
+    rofi_output_buffer_add_line(ob, "d q", "it's", 1, "noot");
+    rofi_output_buffer_add_line(ob, "F", "mies", 2, "no ot");
+    rofi_output_buffer_free(ob);
+    close(pfd[1]);
+    char buffer[128] = {
+        0,
+    };
+    ssize_t l = read(pfd[0], buffer, sizeof(buffer) - 1);
+    close(pfd[0]);
+    TASSERT(l > 0);
+    TASSERT(g_strcmp0(buffer, "0:aap\n2 'it'\\''s'\n'no ot'\n") == 0);
+  }
+
   char *a;
   a = helper_string_replace_if_exists(
       "{terminal} [-t {title} blub ]-e {cmd}", "{cmd}", "aap", "{title}",
@@ -387,6 +387,80 @@ START_TEST(test_tokenizer_match_regex_single_two_word_till_end) {
 }
 END_TEST
 
+START_TEST(test_prefix_index_lookup) {
+  config.matching_method = MM_PREFIX;
+  config.tokenize = TRUE;
+  config.matching_negate_char = '-';
+  RofiPrefixIndex *index = rofi_prefix_index_new();
+  rofi_prefix_index_add(index, 0, "aap noot mies");
+  rofi_prefix_index_add(index, 1, "Firefox Web Browser");
+  rofi_prefix_index_add(index, 2, "noot");
+  rofi_prefix_index_build(index, 3);
+  ck_assert_int_eq(rofi_prefix_index_get_length(index), 3);
+
+  unsigned int *entries = NULL;
+  unsigned int length = 0;
+  ck_assert_int_eq(rofi_prefix_index_lookup(index, "noo", &entries, &length),
+                   TRUE);
+  ck_assert_int_eq(length, 2);
+  ck_assert_int_eq(entries[0], 0);
+  ck_assert_int_eq(entries[1], 2);
+  g_free(entries);
+
+  ck_assert_int_eq(
+      rofi_prefix_index_lookup(index, "web BRO", &entries, &length), TRUE);
+  ck_assert_int_eq(length, 1);
+  ck_assert_int_eq(entries[0], 1);
+  g_free(entries);
+
+  ck_assert_int_eq(rofi_prefix_index_lookup(index, "oot", &entries, &length),
+                   TRUE);
+  ck_assert_int_eq(length, 0);
+  g_free(entries);
+
+  ck_assert_int_eq(rofi_prefix_index_lookup(index, "-noot", &entries, &length),
+                   FALSE);
+  rofi_prefix_index_free(index);
+}
+END_TEST
+
+START_TEST(test_prefix_index_superset) {
+  config.matching_method = MM_PREFIX;
+  config.tokenize = TRUE;
+  config.matching_negate_char = '-';
+  const char *lines[] = {"aap noot mies", "nootap mies", "aap-noot",
+                         "x_noot",        "Noot",        "mies noo t"};
+  const unsigned int num_lines = G_N_ELEMENTS(lines);
+  RofiPrefixIndex *index = rofi_prefix_index_new();
+  for (unsigned int i = 0; i < num_lines; i++) {
+    rofi_prefix_index_add(index, i, lines[i]);
+  }
+  rofi_prefix_index_build(index, num_lines);
+
+  const char *inputs[] = {"noot", "mi no", "-", "t", "p-n"};
+  for (unsigned int i = 0; i < G_N_ELEMENTS(inputs); i++) {
+    unsigned int *entries = NULL;
+    unsigned int length = 0;
+    if (!rofi_prefix_index_lookup(index, inputs[i], &entries, &length)) {
+      continue;
+    }
+    rofi_int_matcher **tokens = helper_tokenize(inputs[i], FALSE);
+    for (unsigned int j = 0; j < num_lines; j++) {
+      if (helper_token_match(tokens, lines[j])) {
+        gboolean found = FALSE;
+        for (unsigned int k = 0; k < length; k++) {
+          found |= (entries[k] == j);
+        }
+        ck_assert_msg(found, "'%s' missed '%s'", inputs[i], lines[j]);
+      }
+    }
+    helper_tokenize_free(tokens);
+    g_free(entries);
+  }
+  rofi_prefix_index_free(index);
+}
+END_TEST
+
 static Suite *helper_tokenizer_suite(void) {
   Suite *s;
 
@@ -438,6 +512,12 @@ static Suite *helper_tokenizer_suite(void) {
     tcase_add_test(tc_regex, test_tokenizer_match_regex_multiple_ci);
     suite_add_tcase(s, tc_regex);
   }
+  {
+    TCase *tc_prefix = tcase_create("Prefix");
+    tcase_add_test(tc_prefix, test_prefix_index_lookup);
+    tcase_add_test(tc_prefix, test_prefix_index_superset);
+    suite_add_tcase(s, tc_prefix);
+  }
 
   return s;
 }
@@ -0,0 +1,388 @@
+/*
+ * rofi
+ *
+ * MIT/X11 License
+ * Copyright © 2013-2023 Qball Cow <qball@gmpclient.org>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#include <assert.h>
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "rofi-icon-theme-index.h"
+
+static unsigned int test = 0;
+
+#define TASSERT(a)                                                             \
+  {                                                                            \
+    assert(a);                                                                 \
+    printf("Test %u passed (%s)\n", ++test, #a);                               \
+  }
+
+static char *root = NULL;
+
+static void write_file(const char *path, const char *content) {
+  char *dir = g_path_get_dirname(path);
+  g_mkdir_with_parents(dir, 0755);
+  g_free(dir);
+  g_file_set_contents(path, content, -1, NULL);
+}
+
+static void add_icon(const char *theme, const char *dir, const char *file) {
+  char *path = g_build_filename(root, "data", "icons", theme, dir, file, NULL);
+  write_file(path, "");
+  g_free(path);
+}
+
+static char *icon_path(const char *theme, const char *dir, const char *file) {
+  return g_build_filename(root, "data", "icons", theme, dir, file, NULL);
+}
+
+static gboolean lookup_is(const RofiIconThemeIndex *index, const char *name,
+                          int size, char *expected) {
+  char *path = rofi_icon_theme_index_lookup(index, name, size, 1);
+  gboolean retv = g_strcmp0(path, expected) == 0;
+  if (!retv) {
+    printf("%s(%d): %s != %s\n", name, size, path, expected);
+  }
+  g_free(path);
+  g_free(expected);
+  return retv;
+}
+
+static unsigned int count_persisted(const char *dir) {
+  unsigned int count = 0;
+  GDir *gdir = g_dir_open(dir, 0, NULL);
+  const char *file = NULL;
+  while (gdir && (file = g_dir_read_name(gdir)) != NULL) {
+    if (g_str_has_prefix(file, "rofi-icon-theme-")) {
+      count++;
+    }
+  }
+  if (gdir) {
+    g_dir_close(gdir);
+  }
+  return count;
+}
+
+static void put_u16(GByteArray *a, guint16 v) {
+  guint8 b[2] = {v >> 8, v & 0xff};
+  g_byte_array_append(a, b, 2);
+}
+
+static void put_u32(GByteArray *a, guint32 v) {
+  guint8 b[4] = {v >> 24, (v >> 16) & 0xff, (v >> 8) & 0xff, v & 0xff};
+  g_byte_array_append(a, b, 4);
+}
+
+static void set_u32(GByteArray *a, gsize offset, guint32 v) {
+  a->data[offset] = v >> 24;
+  a->data[offset + 1] = (v >> 16) & 0xff;
+  a->data[offset + 2] = (v >> 8) & 0xff;
+  a->data[offset + 3] = v & 0xff;
+}
+
+static guint32 get_u32(const GByteArray *a, gsize offset) {
+  return ((guint32)a->data[offset] << 24) |
+         ((guint32)a->data[offset + 1] << 16) |
+         ((guint32)a->data[offset + 2] << 8) | (guint32)a->data[offset + 3];
+}
+
+static void put_string(GByteArray *a, const char *str) {
+  g_byte_array_append(a, (const guint8 *)str, strlen(str) + 1);
+  while (a->len % 4) {
+    g_byte_array_append(a, (const guint8 *)"", 1);
+  }
+}
+
+/** icon_name_hash() of gtk-update-icon-cache. */
+static guint32 gtk_hash(const char *name) {
+  const signed char *p = (const signed char *)name;
+  guint32 h = *p;
+  if (h) {
+    for (p += 1; *p != '\0'; p++) {
+      h = (h << 5) - h + *p;
+    }
+  }
+  return h;
+}
+
+/** GTK icon-theme.cache flags. */
+enum {
+  GTK_XPM = 1 << 0,
+  GTK_SVG = 1 << 1,
+  GTK_PNG = 1 << 2,
+  GTK_ICON_FILE = 1 << 3,
+  GTK_SYMBOLIC_PNG = 1 << 4,
+};
+
+/**
+ * Write an icon-theme.cache the way gtk-update-icon-cache lays it out, with
+ * one image per icon.
+ */
+static void write_gtk_cache(const char *path, const char *const *dirs,
+                            guint32 n_dirs, const char *const *names,
+                            const guint16 *dir_index, const guint16 *flags,
+                            guint32 n_icons) {
+  const guint32 n_buckets = 7;
+  GByteArray *a = g_byte_array_new();
+  put_u16(a, 1);
+  put_u16(a, 0);
+  put_u32(a, 12);
+  put_u32(a, 0);
+  put_u32(a, n_buckets);
+  for (guint32 i = 0; i < n_buckets; i++) {
+    put_u32(a, 0xffffffff);
+  }
+  for (guint32 i = 0; i < n_icons; i++) {
+    gsize bucket = 16 + 4 * (gtk_hash(names[i]) % n_buckets);
+    guint32 icon = a->len;
+    put_u32(a, get_u32(a, bucket));
+    put_u32(a, icon + 12);
+    put_u32(a, 0);
+    put_string(a, names[i]);
+    set_u32(a, icon + 8, a->len);
+    put_u32(a, 1);
+    put_u16(a, dir_index[i]);
+    put_u16(a, flags[i]);
+    put_u32(a, 0);
+    set_u32(a, bucket, icon);
+  }
+  set_u32(a, 8, a->len);
+  put_u32(a, n_dirs);
+  gsize offsets = a->len;
+  for (guint32 i = 0; i < n_dirs; i++) {
+    put_u32(a, 0);
+  }
+  for (guint32 i = 0; i < n_dirs; i++) {
+    set_u32(a, offsets + 4 * i, a->len);
+    put_string(a, dirs[i]);
+  }
+  g_file_set_contents(path, (const char *)a->data, a->len, NULL);
+  g_byte_array_free(a, TRUE);
+}
+
+static void setup_themes(void) {
+  char *path = g_build_filename(root, "data", "icons", "test", "index.theme",
+                                NULL);
+  write_file(path, "[Icon Theme]\n"
+                   "Name=Test\n"
+                   "Inherits=parent,hicolor\n"
+                   "Directories=16x16/apps,48x48/apps,scalable/apps\n"
+                   "\n"
+                   "[16x16/apps]\n"
+                   "Size=16\n"
+                   "Type=Fixed\n"
+                   "\n"
+                   "[48x48/apps]\n"
+                   "Size=48\n"
+                   "Type=Fixed\n"
+                   "\n"
+                   "[scalable/apps]\n"
+                   "Size=128\n"
+                   "MinSize=64\n"
+                   "MaxSize=256\n"
+                   "Type=Scalable\n");
+  g_free(path);
+  add_icon("test", "16x16/apps", "terminal.png");
+  add_icon("test", "48x48/apps", "terminal.png");
+  add_icon("test", "48x48/apps", "terminal.svg");
+  add_icon("test", "scalable/apps", "terminal.svg");
+  add_icon("test", "16x16/apps", "small.png");
+
+  path = g_build_filename(root, "data", "icons", "parent", "index.theme",
+                          NULL);
+  write_file(path, "[Icon Theme]\n"
+                   "Name=Parent\n"
+                   "Directories=32x32/apps\n"
+                   "\n"
+                   "[32x32/apps]\n"
+                   "Size=32\n");
+  g_free(path);
+  add_icon("parent", "32x32/apps", "browser.png");
+  add_icon("parent", "32x32/apps", "terminal.png");
+
+  path = g_build_filename(root, "data", "icons", "hicolor", "index.theme",
+                          NULL);
+  write_file(path, "[Icon Theme]\n"
+                   "Name=Hicolor\n"
+                   "Directories=48x48/apps\n"
+                   "\n"
+                   "[48x48/apps]\n"
+                   "Size=48\n");
+  g_free(path);
+  add_icon("hicolor", "48x48/apps", "editor.png");
+
+  path = g_build_filename(root, "pixmaps", "loose.xpm", NULL);
+  write_file(path, "");
+  g_free(path);
+}
+
+static void test_lookup(const char *cache) {
+  const char *themes[] = {"test", NULL};
+  RofiIconThemeIndex *index = rofi_icon_theme_index_new(themes, cache);
+  TASSERT(index != NULL);
+
+  // Exact size, png preferred over svg.
+  TASSERT(lookup_is(index, "terminal", 16,
+                    icon_path("test", "16x16/apps", "terminal.png")));
+  TASSERT(lookup_is(index, "terminal", 48,
+                    icon_path("test", "48x48/apps", "terminal.png")));
+  TASSERT(lookup_is(index, "terminal", 100,
+                    icon_path("test", "scalable/apps", "terminal.svg")));
+  // Closest size within the first theme that has the icon.
+  TASSERT(lookup_is(index, "terminal", 24,
+                    icon_path("test", "16x16/apps", "terminal.png")));
+  TASSERT(lookup_is(index, "small", 48,
+                    icon_path("test", "16x16/apps", "small.png")));
+  // Inherited themes, hicolor last.
+  TASSERT(lookup_is(index, "browser", 32,
+                    icon_path("parent", "32x32/apps", "browser.png")));
+  TASSERT(lookup_is(index, "editor", 16,
+                    icon_path("hicolor", "48x48/apps", "editor.png")));
+  // Unthemed.
+  TASSERT(lookup_is(index, "loose", 16,
+                    g_build_filename(root, "pixmaps", "loose.xpm", NULL)));
+  // Misses.
+  TASSERT(lookup_is(index, "missing", 16, NULL));
+  TASSERT(lookup_is(index, "", 16, NULL));
+  rofi_icon_theme_index_free(index);
+}
+
+int main(G_GNUC_UNUSED int argc, G_GNUC_UNUSED char **argv) {
+  root = g_dir_make_tmp("rofi-icon-theme-XXXXXX", NULL);
+  TASSERT(root != NULL);
+  // Must be set before glib caches the directories.
+  char *data = g_build_filename(root, "data", NULL);
+  g_setenv("HOME", root, TRUE);
+  g_setenv("XDG_DATA_HOME", data, TRUE);
+  g_setenv("XDG_DATA_DIRS", root, TRUE);
+  g_free(data);
+
+  setup_themes();
+  char *cache = g_build_filename(root, "cache", NULL);
+  g_mkdir_with_parents(cache, 0755);
+
+  // First run scans the themes and writes an index per theme directory.
+  test_lookup(cache);
+  TASSERT(count_persisted(cache) == 3);
+  // Second run uses the persisted indexes.
+  test_lookup(cache);
+  TASSERT(count_persisted(cache) == 3);
+  // Without persisting.
+  test_lookup(NULL);
+
+  // A corrupt cache is rejected and rebuilt.
+  GPtrArray *files = g_ptr_array_new_with_free_func(g_free);
+  GDir *gdir = g_dir_open(cache, 0, NULL);
+  const char *file = NULL;
+  while ((file = g_dir_read_name(gdir)) != NULL) {
+    g_ptr_array_add(files, g_build_filename(cache, file, NULL));
+  }
+  g_dir_close(gdir);
+  for (guint i = 0; i < files->len; i++) {
+    g_file_set_contents(g_ptr_array_index(files, i),
+                        "\x00\x01\x00\x00\xff\xff", 6, NULL);
+  }
+  g_ptr_array_free(files, TRUE);
+  test_lookup(cache);
+
+  // A GTK icon-theme.cache is used as is, even when it disagrees with the
+  // directory content.
+  char *theme = g_build_filename(root, "data", "icons", "test", NULL);
+  char *path = g_build_filename(theme, "icon-theme.cache", NULL);
+  gchar *sum = g_compute_checksum_for_string(G_CHECKSUM_MD5, theme, -1);
+  char *base = g_strdup_printf("rofi-icon-theme-2-%s.cache", sum);
+  char *persisted = g_build_filename(cache, base, NULL);
+  gchar *content = NULL;
+  gsize length = 0;
+  TASSERT(g_file_get_contents(persisted, &content, &length, NULL));
+  TASSERT(g_file_set_contents(path, content, length, NULL));
+  g_free(content);
+  add_icon("test", "48x48/apps", "late.png");
+  g_utime(path, NULL);
+  const char *themes[] = {"test", NULL};
+  RofiIconThemeIndex *index = rofi_icon_theme_index_new(themes, cache);
+  TASSERT(lookup_is(index, "terminal", 48,
+                    icon_path("test", "48x48/apps", "terminal.png")));
+  TASSERT(lookup_is(index, "late", 48, NULL));
+  rofi_icon_theme_index_free(index);
+
+  // A cache written by gtk-update-icon-cache, with GTK's suffix flags.
+  char *gtk_theme = g_build_filename(root, "data", "icons", "gtk", NULL);
+  char *gtk_index = g_build_filename(gtk_theme, "index.theme", NULL);
+  write_file(gtk_index, "[Icon Theme]\n"
+                        "Name=Gtk\n"
+                        "Directories=16x16/apps,48x48/apps\n"
+                        "\n"
+                        "[16x16/apps]\n"
+                        "Size=16\n"
+                        "\n"
+                        "[48x48/apps]\n"
+                        "Size=48\n");
+  const char *gtk_dirs[] = {"48x48/apps", "16x16/apps"};
+  const char *gtk_names[] = {"only-png", "only-svg", "only-xpm",   "png-xpm",
+                             "symbolic", "icon-file", "png-symbolic"};
+  const guint16 gtk_dir_index[] = {0, 0, 1, 1, 0, 0, 0};
+  const guint16 gtk_flags[] = {GTK_PNG,
+                               GTK_SVG,
+                               GTK_XPM,
+                               GTK_PNG | GTK_XPM,
+                               GTK_SYMBOLIC_PNG,
+                               GTK_ICON_FILE,
+                               GTK_PNG | GTK_SYMBOLIC_PNG};
+  char *gtk_cache = g_build_filename(gtk_theme, "icon-theme.cache", NULL);
+  write_gtk_cache(gtk_cache, gtk_dirs, G_N_ELEMENTS(gtk_dirs), gtk_names,
+                  gtk_dir_index, gtk_flags, G_N_ELEMENTS(gtk_names));
+  g_utime(gtk_cache, NULL);
+  const char *gtk_themes[] = {"gtk", NULL};
+  index = rofi_icon_theme_index_new(gtk_themes, NULL);
+  TASSERT(lookup_is(index, "only-png", 48,
+                    icon_path("gtk", "48x48/apps", "only-png.png")));
+  TASSERT(lookup_is(index, "only-svg", 48,
+                    icon_path("gtk", "48x48/apps", "only-svg.svg")));
+  TASSERT(lookup_is(index, "only-xpm", 16,
+                    icon_path("gtk", "16x16/apps", "only-xpm.xpm")));
+  TASSERT(lookup_is(index, "png-xpm", 16,
+                    icon_path("gtk", "16x16/apps", "png-xpm.png")));
+  TASSERT(lookup_is(index, "png-symbolic", 48,
+                    icon_path("gtk", "48x48/apps", "png-symbolic.png")));
+  TASSERT(lookup_is(index, "symbolic", 48, NULL));
+  TASSERT(lookup_is(index, "icon-file", 48, NULL));
+  rofi_icon_theme_index_free(index);
+  g_free(gtk_cache);
+  g_free(gtk_index);
+  g_free(gtk_theme);
+
+  g_free(persisted);
+  g_free(base);
+  g_free(sum);
+  g_free(path);
+  g_free(theme);
+  g_free(cache);
+  g_free(root);
+  return EXIT_SUCCESS;
+}
@@ -117,7 +117,7 @@ int main(G_GNUC_UNUSED int argc, G_GNUC_UNUSED char **argv) {
   textbox_cursor(box, 2);
   TASSERT(box->cursor == 2);
   textbox_insert(box, 3, "bo", 2);
-  TASSERT(strcmp(box->text, "tesbot") == 0);
+  TASSERT(strcmp(textbox_peek_text(box), "tesbot") == 0);
   textbox_keybinding(box, MOVE_END);
   TASSERT(box->cursor == 6);
 
@@ -130,13 +130,13 @@ int main(G_GNUC_UNUSED int argc, G_GNUC_UNUSED char **argv) {
   TASSERT(textbox_get_estimated_char_width() > 0);
 
   textbox_keybinding(box, REMOVE_CHAR_BACK);
-  TASSERT(strcmp(box->text, "tesbo") == 0);
+  TASSERT(strcmp(textbox_peek_text(box), "tesbo") == 0);
   TASSERT(box->cursor == 5);
 
   textbox_keybinding(box, MOVE_CHAR_BACK);
   TASSERT(box->cursor == 4);
   textbox_keybinding(box, REMOVE_CHAR_FORWARD);
-  TASSERT(strcmp(box->text, "tesb") == 0);
+  TASSERT(strcmp(textbox_peek_text(box), "tesb") == 0);
   textbox_keybinding(box, MOVE_CHAR_BACK);
   TASSERT(box->cursor == 3);
   textbox_keybinding(box, MOVE_CHAR_FORWARD);
@@ -145,50 +145,50 @@ int main(G_GNUC_UNUSED int argc, G_GNUC_UNUSED char **argv) {
   TASSERT(box->cursor == 4);
   // Cursor after delete section.
   textbox_delete(box, 0, 1);
-  TASSERT(strcmp(box->text, "esb") == 0);
+  TASSERT(strcmp(textbox_peek_text(box), "esb") == 0);
   TASSERT(box->cursor == 3);
   // Cursor before delete.
   textbox_text(box, "aap noot mies");
-  TASSERT(strcmp(box->text, "aap noot mies") == 0);
+  TASSERT(strcmp(textbox_peek_text(box), "aap noot mies") == 0);
   textbox_cursor(box, 3);
   TASSERT(box->cursor == 3);
   textbox_delete(box, 3, 6);
-  TASSERT(strcmp(box->text, "aapmies") == 0);
+  TASSERT(strcmp(textbox_peek_text(box), "aapmies") == 0);
   TASSERT(box->cursor == 3);
 
   // Cursor within delete
   textbox_text(box, "aap noot mies");
-  TASSERT(strcmp(box->text, "aap noot mies") == 0);
+  TASSERT(strcmp(textbox_peek_text(box), "aap noot mies") == 0);
   textbox_cursor(box, 5);
   TASSERT(box->cursor == 5);
   textbox_delete(box, 3, 6);
-  TASSERT(strcmp(box->text, "aapmies") == 0);
+  TASSERT(strcmp(textbox_peek_text(box), "aapmies") == 0);
   TASSERT(box->cursor == 3);
   // Cursor after delete.
   textbox_text(box, "aap noot mies");
-  TASSERT(strcmp(box->text, "aap noot mies") == 0);
+  TASSERT(strcmp(textbox_peek_text(box), "aap noot mies") == 0);
   textbox_cursor(box, 11);
   TASSERT(box->cursor == 11);
   textbox_delete(box, 3, 6);
-  TASSERT(strcmp(box->text, "aapmies") == 0);
+  TASSERT(strcmp(textbox_peek_text(box), "aapmies") == 0);
   TASSERT(box->cursor == 5);
 
   textbox_text(box, "aap noot mies");
   textbox_cursor(box, 8);
   textbox_keybinding(box, REMOVE_WORD_BACK);
   TASSERT(box->cursor == 4);
-  TASSERT(strcmp(box->text, "aap  mies") == 0);
+  TASSERT(strcmp(textbox_peek_text(box), "aap  mies") == 0);
   textbox_keybinding(box, REMOVE_TO_EOL);
   TASSERT(box->cursor == 4);
-  TASSERT(strcmp(box->text, "aap ") == 0);
+  TASSERT(strcmp(textbox_peek_text(box), "aap ") == 0);
   textbox_text(box, "aap noot mies");
   textbox_cursor(box, 8);
   textbox_keybinding(box, REMOVE_WORD_FORWARD);
-  TASSERT(strcmp(box->text, "aap noot") == 0);
+  TASSERT(strcmp(textbox_peek_text(box), "aap noot") == 0);
   textbox_keybinding(box, MOVE_FRONT);
   TASSERT(box->cursor == 0);
   textbox_keybinding(box, CLEAR_LINE);
-  TASSERT(strcmp(box->text, "") == 0);
+  TASSERT(strcmp(textbox_peek_text(box), "") == 0);
   textbox_text(box, "aap noot mies");
   textbox_keybinding(box, MOVE_END);
   textbox_keybinding(box, MOVE_WORD_BACK);
@@ -196,9 +196,31 @@ int main(G_GNUC_UNUSED int argc, G_GNUC_UNUSED char **argv) {
   textbox_keybinding(box, MOVE_WORD_BACK);
   TASSERT(box->cursor == 4);
   textbox_keybinding(box, REMOVE_TO_SOL);
-  TASSERT(strcmp(box->text, "noot mies") == 0);
+  TASSERT(strcmp(textbox_peek_text(box), "noot mies") == 0);
   TASSERT(box->cursor == 0);
 
+  // Paste, whitespace becomes a space, control characters are dropped.
+  textbox_cursor(box, 4);
+  TASSERT(textbox_append_text(box, "\xc3\xa9\tb\nc\x01", 7) == TRUE);
+  TASSERT(strcmp(textbox_peek_text(box), "noot\xc3\xa9 b c mies") == 0);
+  TASSERT(box->cursor == 9);
+  TASSERT(textbox_append_text(box, "\x01", 1) == FALSE);
+  textbox_keybinding(box, REMOVE_CHAR_BACK);
+  textbox_keybinding(box, MOVE_FRONT);
+  textbox_keybinding(box, REMOVE_CHAR_FORWARD);
+  char *copy = textbox_get_text(box);
+  TASSERT(strcmp(copy, "oot\xc3\xa9 b  mies") == 0);
+  g_free(copy);
+  // Long paste in the middle of the text.
+  char *paste = g_strnfill(40000, 'x');
+  textbox_cursor(box, 3);
+  TASSERT(textbox_append_text(box, paste, 40000) == TRUE);
+  TASSERT(box->cursor == 40003);
+  TASSERT(strlen(textbox_peek_text(box)) == 40013);
+  TASSERT(strncmp(textbox_peek_text(box) + 40003, "\xc3\xa9 b  mies", 10) ==
+          0);
+  g_free(paste);
+
   textbox_font(box, HIGHLIGHT);
   // textbox_draw ( box, draw );
 